@@ -0,0 +1,272 @@
+/*
+ * G.721 codec benchmark
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * usage: g721-bench [-n SECONDS]
+ *
+ * Measure G.721 encoding and decoding of SECONDS seconds of audio in 10ms
+ * frames, using both the per-sample and the block functions, for each input
+ * and output coding. A call requires encoding and decoding 8000 samples per
+ * second, the number of calls a single core can handle is derived from the
+ * time required for both. The output of the block decoder is first checked
+ * against the per-sample decoder. Results are written to stdout as one JSON
+ * object per line:
+ *
+ * {"type":"meta",...}		benchmark parameters
+ * {"type":"error",...}		first mismatching sample of a coding
+ * {"type":"result",...}	ns per frame for encoding and decoding
+ * {"type":"calls",...}		calls per core
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <utils.h>
+#include "../src/ccitt-adpcm/g72x.h"
+
+#define BENCH_VERSION		2
+#define BENCH_SECONDS		100
+#define BENCH_RATE		8000
+#define BENCH_FRAME		80
+
+static const struct bench_coding {
+	int		coding;
+	const char	*name;
+} bench_codings[] = {
+	{ AUDIO_ENCODING_LINEAR,	"linear" },
+	{ AUDIO_ENCODING_ALAW,		"alaw" },
+	{ AUDIO_ENCODING_ULAW,		"ulaw" },
+};
+
+static short pcm[BENCH_RATE];
+static short samples[BENCH_RATE];
+static unsigned char codes[BENCH_RATE / 2];
+static short out[BENCH_RATE];
+
+static uint64_t bench_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * A chirp with some noise, keeping the predictor and quantizer busy, and
+ * full scale square wave bursts overloading the decoder output.
+ */
+static void bench_signal_init(void)
+{
+	unsigned int i;
+	double t;
+
+	srandom(1);
+	for (i = 0; i < array_size(pcm); i++) {
+		t = (double)i / BENCH_RATE;
+		if (i % 2000 < 200)
+			pcm[i] = i & 8 ? 32767 : -32768;
+		else
+			pcm[i] = 12000 * sin(2 * M_PI * (300 + 1500 * t) * t) +
+				 (random() % 2048) - 1024;
+	}
+}
+
+static void bench_samples_init(int coding)
+{
+	unsigned int i;
+
+	for (i = 0; i < array_size(samples); i++) {
+		switch (coding) {
+		case AUDIO_ENCODING_ALAW:
+			samples[i] = linear2alaw(pcm[i]);
+			break;
+		case AUDIO_ENCODING_ULAW:
+			samples[i] = linear2ulaw(pcm[i]);
+			break;
+		default:
+			samples[i] = pcm[i];
+			break;
+		}
+	}
+}
+
+static void encode_sample(const struct bench_coding *c,
+			  struct g72x_state *state, unsigned int off)
+{
+	unsigned int i;
+
+	for (i = off; i < off + BENCH_FRAME; i += 2) {
+		codes[i / 2]  = g721_encoder(samples[i], c->coding, state) << 4;
+		codes[i / 2] |= g721_encoder(samples[i + 1], c->coding, state);
+	}
+}
+
+static void encode_block(const struct bench_coding *c,
+			 struct g72x_state *state, unsigned int off)
+{
+	g721_encode_block(codes + off / 2, samples + off, BENCH_FRAME,
+			  c->coding, state);
+}
+
+static void decode_sample(const struct bench_coding *c,
+			  struct g72x_state *state, unsigned int off)
+{
+	unsigned int i;
+
+	for (i = off; i < off + BENCH_FRAME; i += 2) {
+		out[i]     = g721_decoder(codes[i / 2] >> 4, c->coding, state);
+		out[i + 1] = g721_decoder(codes[i / 2] & 0x0f, c->coding, state);
+	}
+}
+
+static void decode_block(const struct bench_coding *c,
+			 struct g72x_state *state, unsigned int off)
+{
+	g721_decode_block(out + off, codes + off / 2, BENCH_FRAME,
+			  c->coding, state);
+}
+
+/*
+ * Check the block decoder against the per-sample decoder, whose linear
+ * output is not saturated to 16 bits.
+ */
+static unsigned int bench_verify(const struct bench_coding *c)
+{
+	struct g72x_state state;
+	unsigned int i, errors = 0;
+	int sample;
+
+	g72x_init_state(&state);
+	for (i = 0; i < BENCH_RATE; i += BENCH_FRAME)
+		encode_sample(c, &state, i);
+
+	g72x_init_state(&state);
+	g721_decode_block(out, codes, BENCH_RATE, c->coding, &state);
+
+	g72x_init_state(&state);
+	for (i = 0; i < BENCH_RATE; i++) {
+		sample = g721_decoder(i & 1 ? codes[i / 2] : codes[i / 2] >> 4,
+				      c->coding, &state);
+		if (c->coding == AUDIO_ENCODING_LINEAR)
+			sample = min(max(sample, -32768), 32767);
+		if (out[i] == sample)
+			continue;
+		if (errors++ == 0)
+			printf("{\"type\":\"error\",\"coding\":\"%s\","
+			       "\"op\":\"verify\",\"sample\":%u,"
+			       "\"expected\":%d,\"result\":%d}\n",
+			       c->name, i, sample, out[i]);
+	}
+	return errors;
+}
+
+static const struct bench_api {
+	const char	*name;
+	void		(*encode)(const struct bench_coding *c,
+				  struct g72x_state *state, unsigned int off);
+	void		(*decode)(const struct bench_coding *c,
+				  struct g72x_state *state, unsigned int off);
+} bench_apis[] = {
+	{ "sample",	encode_sample,	decode_sample },
+	{ "block",	encode_block,	decode_block },
+};
+
+/* Run one second of audio through fn for each of the given seconds */
+static uint64_t bench_run(const struct bench_coding *c,
+			  void (*fn)(const struct bench_coding *c,
+				     struct g72x_state *state,
+				     unsigned int off),
+			  unsigned int seconds)
+{
+	struct g72x_state state;
+	unsigned int n, off;
+	uint64_t ns;
+
+	g72x_init_state(&state);
+	ns = bench_clock();
+	for (n = 0; n < seconds; n++) {
+		for (off = 0; off < BENCH_RATE; off += BENCH_FRAME)
+			fn(c, &state, off);
+	}
+	return bench_clock() - ns;
+}
+
+static void bench_result(const struct bench_api *api,
+			 const struct bench_coding *c, const char *op,
+			 unsigned int seconds, uint64_t ns)
+{
+	printf("{\"type\":\"result\",\"api\":\"%s\",\"coding\":\"%s\","
+	       "\"op\":\"%s\",\"seconds\":%u,\"ns_per_frame\":%.1f,"
+	       "\"ns_per_sample\":%.2f}\n",
+	       api->name, c->name, op, seconds,
+	       (double)ns / seconds / (BENCH_RATE / BENCH_FRAME),
+	       (double)ns / seconds / BENCH_RATE);
+}
+
+static void bench_coding(const struct bench_api *api,
+			 const struct bench_coding *c, unsigned int seconds)
+{
+	uint64_t enc, dec;
+
+	bench_samples_init(c->coding);
+
+	/* The decoder runs on the output of the encoder */
+	enc = bench_run(c, api->encode, seconds);
+	dec = bench_run(c, api->decode, seconds);
+
+	bench_result(api, c, "encode", seconds, enc);
+	bench_result(api, c, "decode", seconds, dec);
+	printf("{\"type\":\"calls\",\"api\":\"%s\",\"coding\":\"%s\","
+	       "\"calls_per_core\":%.0f}\n",
+	       api->name, c->name, 1e9 * seconds / (enc + dec));
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-n SECONDS]\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int seconds = BENCH_SECONDS, errors = 0, i, j;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:")) != -1) {
+		switch (opt) {
+		case 'n':
+			seconds = strtoul(optarg, NULL, 0);
+			if (seconds == 0)
+				usage(argv[0]);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	bench_signal_init();
+
+	printf("{\"type\":\"meta\",\"version\":%u,\"seconds\":%u,"
+	       "\"rate\":%u,\"frame\":%u}\n",
+	       BENCH_VERSION, seconds, BENCH_RATE, BENCH_FRAME);
+
+	for (i = 0; i < array_size(bench_codings); i++) {
+		bench_samples_init(bench_codings[i].coding);
+		errors += bench_verify(&bench_codings[i]);
+	}
+
+	for (i = 0; i < array_size(bench_apis); i++) {
+		for (j = 0; j < array_size(bench_codings); j++)
+			bench_coding(&bench_apis[i], &bench_codings[j], seconds);
+	}
+	return errors ? 1 : 0;
+}
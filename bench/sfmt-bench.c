@@ -0,0 +1,512 @@
+/*
+ * S-Format codec microbenchmark
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * usage: sfmt-bench [-a] [-n ITERATIONS] [-c CORPUS]
+ *
+ * Measure dect_build_sfmt_msg() and dect_parse_sfmt_msg() for every S-Format
+ * message description in both directions, using a pair of handles attached
+ * to a simulated cluster. Messages are either synthesized from the message
+ * descriptions or taken from a corpus of recorded messages. Results are
+ * written to stdout as one JSON object per line:
+ *
+ * {"type":"meta",...}		benchmark parameters
+ * {"type":"result",...}	ns, allocations and bytes allocated per message
+ * {"type":"error",...}		messages that couldn't be built or parsed
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libdect.h>
+#include <dect/sim.h>
+#include <utils.h>
+#include <s_fmt.h>
+
+#define BENCH_VERSION		1
+#define BENCH_ITERATIONS	10000
+#define BENCH_REPEAT_IES	2
+
+static struct dect_handle *fp, *pp;
+static unsigned long allocs, bytes;
+
+static void *bench_malloc(size_t size)
+{
+	allocs++;
+	bytes += size;
+	return malloc(size);
+}
+
+static struct dect_ops fp_ops = {
+	.malloc		= bench_malloc,
+	.free		= free,
+	.event_ops	= &dect_loop_event_ops,
+};
+
+static struct dect_ops pp_ops = {
+	.malloc		= bench_malloc,
+	.free		= free,
+	.event_ops	= &dect_loop_event_ops,
+};
+
+/**
+ * struct bench_stats - resource usage of a benchmark run
+ *
+ * @ns:		elapsed time in nanoseconds
+ * @allocs:	number of allocations
+ * @bytes:	number of bytes allocated
+ */
+struct bench_stats {
+	uint64_t	ns;
+	unsigned long	allocs;
+	unsigned long	bytes;
+};
+
+static uint64_t bench_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_start(struct bench_stats *st)
+{
+	st->allocs = allocs;
+	st->bytes  = bytes;
+	st->ns	   = bench_clock();
+}
+
+static void bench_stop(struct bench_stats *st)
+{
+	st->ns	   = bench_clock() - st->ns;
+	st->allocs = allocs - st->allocs;
+	st->bytes  = bytes - st->bytes;
+}
+
+static const char *bench_dir(const struct dect_handle *tx)
+{
+	return tx == fp ? "fp-pp" : "pp-fp";
+}
+
+static void bench_result(const struct dect_sfmt_msg_desc *mdesc,
+			 const struct dect_handle *tx, const char *source,
+			 const char *op, unsigned int len, unsigned int ies,
+			 unsigned int iterations, const struct bench_stats *st)
+{
+	printf("{\"type\":\"result\",\"msg\":\"%s\",\"dir\":\"%s\","
+	       "\"source\":\"%s\",\"op\":\"%s\",\"len\":%u,\"ies\":%u,"
+	       "\"iterations\":%u,\"ns_per_msg\":%.1f,"
+	       "\"allocs_per_msg\":%.2f,\"bytes_per_msg\":%.1f}\n",
+	       mdesc->name, bench_dir(tx), source, op, len, ies, iterations,
+	       (double)st->ns / iterations, (double)st->allocs / iterations,
+	       (double)st->bytes / iterations);
+}
+
+static void bench_error(const struct dect_sfmt_msg_desc *mdesc,
+			const struct dect_handle *tx, const char *source,
+			const char *op, enum dect_sfmt_error err)
+{
+	printf("{\"type\":\"error\",\"msg\":\"%s\",\"dir\":\"%s\","
+	       "\"source\":\"%s\",\"op\":\"%s\",\"err\":%d}\n",
+	       mdesc->name, bench_dir(tx), source, op, err);
+}
+
+static struct dect_msg_common *bench_msg_alloc(const struct dect_sfmt_msg_desc *mdesc)
+{
+	return calloc(1, sizeof(struct dect_msg_common) + mdesc->tbl->size);
+}
+
+static enum dect_sfmt_ie_status bench_tx_status(const struct dect_handle *tx,
+						const struct dect_sfmt_ie_desc *desc)
+{
+	return tx == fp ? desc->fp_pp : desc->pp_fp;
+}
+
+/* Fix up IEs for which an all zero IE structure doesn't encode a valid IE */
+static void bench_ie_fixup(uint8_t type, struct dect_ie_common *ie)
+{
+	struct dect_ie_info_type *info_type;
+
+	switch (type) {
+	case DECT_IE_INFO_TYPE:
+		info_type = dect_ie_container(info_type, ie);
+		info_type->num = 1;
+		break;
+	}
+}
+
+/*
+ * Synthesize an IE from a zeroed IE structure. The IE is only used if it
+ * survives a build/parse round trip, otherwise the message is built without
+ * it.
+ */
+static struct dect_ie_common *bench_ie_alloc(struct dect_handle *tx,
+					     struct dect_handle *rx,
+					     uint8_t type)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	struct dect_ie_common *ie, *rie = NULL;
+	struct dect_sfmt_ie sie;
+
+	if (dect_sfmt_ie_size(type) == 0)
+		return NULL;
+	ie = dect_ie_alloc(tx, dect_sfmt_ie_size(type));
+	if (ie == NULL)
+		return NULL;
+	bench_ie_fixup(type, ie);
+
+	if (dect_build_sfmt_ie(tx, type, mb, ie) != DECT_SFMT_OK ||
+	    dect_parse_sfmt_ie_header(&sie, mb) != DECT_SFMT_OK ||
+	    dect_parse_sfmt_ie(rx, type, &rie, &sie) != DECT_SFMT_OK)
+		goto err;
+	__dect_ie_put(rx, rie);
+	return ie;
+
+err:
+	if (rie != NULL)
+		__dect_ie_put(rx, rie);
+	__dect_ie_put(tx, ie);
+	return NULL;
+}
+
+static void bench_msg_synthesize(const struct dect_sfmt_msg_desc *mdesc,
+				 struct dect_handle *tx, struct dect_handle *rx,
+				 struct dect_msg_common *msg)
+{
+	const struct dect_sfmt_msg_tbl *tbl = mdesc->tbl;
+	const struct dect_sfmt_ie_desc *desc;
+	struct dect_ie_common *ie;
+	unsigned int idx, i;
+	void *slot;
+
+	for (idx = 0; !(mdesc->ie[idx].flags & DECT_SFMT_IE_END); idx++) {
+		desc = &mdesc->ie[idx];
+		slot = (void *)msg->ie + tbl->offset[idx];
+
+		if (desc->type == DECT_IE_REPEAT_INDICATOR) {
+			dect_ie_list_init(slot);
+			((struct dect_ie_list *)slot)->type = DECT_IE_LIST_NORMAL;
+			continue;
+		}
+		if (bench_tx_status(tx, desc) == DECT_SFMT_IE_NONE)
+			continue;
+
+		if (desc->flags & DECT_SFMT_IE_REPEAT) {
+			for (i = 0; i < BENCH_REPEAT_IES; i++) {
+				ie = bench_ie_alloc(tx, rx, desc->type);
+				if (ie == NULL)
+					break;
+				__dect_ie_list_add(ie, slot);
+			}
+		} else {
+			ie = bench_ie_alloc(tx, rx, desc->type);
+			if (ie == NULL)
+				continue;
+			*(struct dect_ie_common **)slot = ie;
+		}
+	}
+}
+
+static unsigned int bench_msg_ies(const struct dect_sfmt_msg_desc *mdesc,
+				  const struct dect_msg_common *msg)
+{
+	const struct dect_sfmt_msg_tbl *tbl = mdesc->tbl;
+	const struct dect_ie_common *ie;
+	struct dect_ie_list *iel;
+	unsigned int idx, ies = 0;
+	void *slot;
+
+	for (idx = 0; !(mdesc->ie[idx].flags & DECT_SFMT_IE_END); idx++) {
+		slot = (void *)msg->ie + tbl->offset[idx];
+
+		if (mdesc->ie[idx].type == DECT_IE_REPEAT_INDICATOR) {
+			iel = slot;
+			dect_foreach_ie(ie, iel)
+				ies++;
+		} else if (!(mdesc->ie[idx].flags & DECT_SFMT_IE_REPEAT) &&
+			   *(struct dect_ie_common **)slot != NULL)
+			ies++;
+	}
+	return ies;
+}
+
+static void bench_build(const struct dect_sfmt_msg_desc *mdesc,
+			struct dect_handle *tx, const char *source,
+			const struct dect_msg_common *msg, unsigned int ies,
+			unsigned int iterations)
+{
+	struct dect_msg_buf *mb;
+	struct bench_stats st;
+	unsigned int len = 0, i;
+
+	bench_start(&st);
+	for (i = 0; i < iterations; i++) {
+		mb = dect_mbuf_alloc(tx);
+		if (mb == NULL)
+			goto err;
+		if (dect_build_sfmt_msg(tx, mdesc, msg, mb) != DECT_SFMT_OK) {
+			dect_mbuf_free(tx, mb);
+			goto err;
+		}
+		len = mb->len;
+		dect_mbuf_free(tx, mb);
+	}
+	bench_stop(&st);
+
+	bench_result(mdesc, tx, source, "build", len, ies, iterations, &st);
+	return;
+
+err:
+	bench_error(mdesc, tx, source, "build", DECT_SFMT_INVALID_IE);
+}
+
+static void bench_parse(const struct dect_sfmt_msg_desc *mdesc,
+			struct dect_handle *tx, struct dect_handle *rx,
+			const char *source, struct dect_msg_buf *mb,
+			unsigned int ies, unsigned int iterations)
+{
+	struct dect_msg_common *msg;
+	uint8_t *data = mb->data;
+	unsigned int len = mb->len, i;
+	enum dect_sfmt_error err;
+	struct bench_stats st;
+
+	msg = bench_msg_alloc(mdesc);
+	if (msg == NULL)
+		return;
+
+	/* Parsing consumes the message buffer, restore it for each run */
+	bench_start(&st);
+	for (i = 0; i < iterations; i++) {
+		mb->data = data;
+		mb->len	 = len;
+		err = dect_parse_sfmt_msg(rx, mdesc, msg, mb);
+		if (err != DECT_SFMT_OK)
+			goto err;
+		dect_msg_free(rx, mdesc, msg);
+	}
+	bench_stop(&st);
+
+	bench_result(mdesc, tx, source, "parse", len, ies, iterations, &st);
+	goto out;
+
+err:
+	bench_error(mdesc, tx, source, "parse", err);
+out:
+	mb->data = data;
+	mb->len	 = len;
+	free(msg);
+}
+
+static void bench_synthetic(const struct dect_sfmt_msg_desc *mdesc,
+			    struct dect_handle *tx, struct dect_handle *rx,
+			    unsigned int iterations)
+{
+	struct dect_msg_common *msg;
+	struct dect_msg_buf *mb;
+	enum dect_sfmt_error err;
+	unsigned int ies;
+
+	msg = bench_msg_alloc(mdesc);
+	if (msg == NULL)
+		return;
+	bench_msg_synthesize(mdesc, tx, rx, msg);
+	ies = bench_msg_ies(mdesc, msg);
+
+	mb = dect_mbuf_alloc(tx);
+	if (mb == NULL)
+		goto out;
+	err = dect_build_sfmt_msg(tx, mdesc, msg, mb);
+	if (err != DECT_SFMT_OK) {
+		bench_error(mdesc, tx, "synthetic", "build", err);
+		goto out_mb;
+	}
+
+	bench_build(mdesc, tx, "synthetic", msg, ies, iterations);
+	bench_parse(mdesc, tx, rx, "synthetic", mb, ies, iterations);
+out_mb:
+	dect_mbuf_free(tx, mb);
+out:
+	dect_msg_free(tx, mdesc, msg);
+	free(msg);
+}
+
+static const struct dect_sfmt_msg_desc *bench_msg_desc_lookup(const char *name)
+{
+	const struct dect_sfmt_msg_desc * const *ref, *mdesc;
+
+	dect_foreach_sfmt_msg_desc(ref, mdesc) {
+		if (!strcmp(mdesc->name, name))
+			return mdesc;
+	}
+	return NULL;
+}
+
+static int bench_hex_decode(struct dect_msg_buf *mb, const char *hex)
+{
+	unsigned int val;
+
+	for (; *hex != '\0' && !isspace(*hex); hex += 2) {
+		if (mb->len == sizeof(mb->head) ||
+		    sscanf(hex, "%2x", &val) != 1 || !isxdigit(hex[1]))
+			return -1;
+		mb->data[mb->len++] = val;
+	}
+	return 0;
+}
+
+/*
+ * The corpus consists of lines of the form "<message> <fp-pp|pp-fp> <hex>",
+ * containing the IEs of recorded messages following the S-Format header.
+ * Each message is parsed by the receiving side and rebuilt from the parsed
+ * message by the sending side.
+ */
+static int bench_corpus(const char *name, unsigned int iterations)
+{
+	const struct dect_sfmt_msg_desc *mdesc;
+	char line[1024], msgname[64], dir[8], hex[sizeof(line)];
+	struct dect_handle *tx, *rx;
+	struct dect_msg_common *msg;
+	unsigned int lineno = 0, len, ies;
+	enum dect_sfmt_error err;
+	uint8_t *data;
+	FILE *f;
+
+	f = fopen(name, "r");
+	if (f == NULL) {
+		perror(name);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+
+		lineno++;
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+
+		if (sscanf(line, "%63s %7s %1023s", msgname, dir, hex) != 3 ||
+		    (mdesc = bench_msg_desc_lookup(msgname)) == NULL ||
+		    (strcmp(dir, "fp-pp") && strcmp(dir, "pp-fp")) ||
+		    bench_hex_decode(mb, hex) < 0) {
+			fprintf(stderr, "%s:%u: invalid corpus entry\n",
+				name, lineno);
+			goto err;
+		}
+
+		tx = strcmp(dir, "fp-pp") ? pp : fp;
+		rx = tx == fp ? pp : fp;
+
+		msg = bench_msg_alloc(mdesc);
+		if (msg == NULL)
+			goto err;
+		data = mb->data;
+		len  = mb->len;
+		err  = dect_parse_sfmt_msg(rx, mdesc, msg, mb);
+		mb->data = data;
+		mb->len	 = len;
+
+		/* Failed parses release the message themselves */
+		if (err == DECT_SFMT_OK) {
+			ies = bench_msg_ies(mdesc, msg);
+			bench_parse(mdesc, tx, rx, "corpus", mb, ies, iterations);
+			bench_build(mdesc, tx, "corpus", msg, ies, iterations);
+			dect_msg_free(rx, mdesc, msg);
+		} else
+			bench_error(mdesc, tx, "corpus", "parse", err);
+		free(msg);
+	}
+
+	fclose(f);
+	return 0;
+
+err:
+	fclose(f);
+	return -1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-a] [-n ITERATIONS] [-c CORPUS]\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct dect_ari pari = { .arc = DECT_ARC_A, .emc = 0x0ba8, .fpn = 0x1 };
+	struct dect_fp_capabilities fpc = {};
+	const struct dect_sfmt_msg_desc * const *ref, *mdesc;
+	unsigned int iterations = BENCH_ITERATIONS, n = 0;
+	const char *corpus = NULL;
+	struct dect_sim *sim;
+	int opt, rc = 0;
+
+	while ((opt = getopt(argc, argv, "an:c:")) != -1) {
+		switch (opt) {
+		case 'a':
+			fp_ops.ie_arena = pp_ops.ie_arena = true;
+			break;
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			if (iterations == 0)
+				usage(argv[0]);
+			break;
+		case 'c':
+			corpus = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	/* Debugging output would dominate the measurements */
+	dect_set_debug_mask(0);
+
+	sim = dect_sim_alloc(&pari, &fpc);
+	if (sim == NULL)
+		goto err1;
+	fp = dect_sim_open_fp(sim, &fp_ops);
+	if (fp == NULL)
+		goto err2;
+	pp = dect_sim_open_pp(sim, &pp_ops);
+	if (pp == NULL)
+		goto err3;
+
+	dect_foreach_sfmt_msg_desc(ref, mdesc)
+		n++;
+
+	printf("{\"type\":\"meta\",\"version\":%u,\"iterations\":%u,"
+	       "\"ie_arena\":%s,\"messages\":%u}\n",
+	       BENCH_VERSION, iterations, fp_ops.ie_arena ? "true" : "false", n);
+
+	dect_foreach_sfmt_msg_desc(ref, mdesc) {
+		bench_synthetic(mdesc, fp, pp, iterations);
+		bench_synthetic(mdesc, pp, fp, iterations);
+	}
+
+	if (corpus != NULL && bench_corpus(corpus, iterations) < 0)
+		rc = 1;
+
+	dect_close_handle(pp);
+	dect_close_handle(fp);
+	dect_sim_free(sim);
+	return rc;
+
+err3:
+	dect_close_handle(fp);
+err2:
+	dect_sim_free(sim);
+err1:
+	perror("sfmt-bench");
+	return 1;
+}
@@ -2,25 +2,29 @@
 #include <SDL/SDL_audio.h>
 #include "common.h"
 
-void dect_audio_queue(struct dect_audio_handle *ah, struct dect_msg_buf *mb)
+void dect_audio_queue(struct dect_handle *dh, struct dect_audio_handle *ah,
+		      struct dect_msg_buf *mb)
 {
+	struct dect_msg_buf *played;
+	bool queued;
+
 	SDL_LockAudio();
-	ptrlist_add_tail(mb, &ah->queue);
+	/* The message buffer pool isn't thread safe, buffers played by the
+	 * audio thread are returned to it from here. */
+	while ((played = ptrqueue_dequeue(&ah->played)) != NULL)
+		dect_mbuf_free(dh, played);
+	queued = ptrqueue_enqueue(&ah->queue, mb);
 	SDL_UnlockAudio();
+
+	if (!queued)
+		dect_mbuf_free(dh, mb);
 }
 
 static void dect_decode_g721(struct g72x_state *codec,
 			     int16_t *dst, const uint8_t *src,
 			     unsigned int len)
 {
-	unsigned int i;
-
-	for (i = 0; i < len * 2; i += 2) {
-		dst[i + 0] = g721_decoder(src[i / 2] >> 4,
-					  AUDIO_ENCODING_LINEAR, codec);
-		dst[i + 1] = g721_decoder(src[i / 2] & 0x0f,
-					  AUDIO_ENCODING_LINEAR, codec);
-	}
+	g721_decode_block(dst, src, len * 2, AUDIO_ENCODING_LINEAR, codec);
 }
 
 static void dect_audio_dequeue(void *data, uint8_t *stream, int len)
@@ -31,9 +35,9 @@ static void dect_audio_dequeue(void *data, uint8_t *stream, int len)
 
 	len /= 4;
 	while (1) {
-		if (ah->queue == NULL)
+		mb = ptrqueue_peek(&ah->queue);
+		if (mb == NULL)
 			goto underrun;
-		mb = ah->queue;
 		copy = mb->len;
 		if (copy > len)
 			copy = len;
@@ -41,8 +45,8 @@ static void dect_audio_dequeue(void *data, uint8_t *stream, int len)
 		dect_decode_g721(&ah->codec, (int16_t *)stream, mb->data, copy);
 		dect_mbuf_pull(mb, copy);
 		if (mb->len == 0) {
-			ah->queue = mb->next;
-			free(mb);
+			ptrqueue_dequeue(&ah->queue);
+			ptrqueue_enqueue(&ah->played, mb);
 		}
 
 		len -= copy;
@@ -70,7 +74,8 @@ struct dect_audio_handle *dect_audio_open(void)
 	ah = malloc(sizeof(*ah));
 	if (ah == NULL)
 		goto err1;
-	ptrlist_init(&ah->queue);
+	ptrqueue_init(&ah->queue, DECT_AUDIO_QUEUE_MAX);
+	ptrqueue_init(&ah->played, 0);
 	g72x_init_state(&ah->codec);
 
 	spec.userdata = ah;
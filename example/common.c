@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <dect/libdect.h>
 #include "common.h"
@@ -32,21 +34,90 @@ void pexit(const char *str)
 	exit(1);
 }
 
+static int capture_fd = -1;
+
+/* Capture packets to DECT_CAPTURE_FILE in pcapng format if it is set */
+static void dect_capture_init(struct dect_handle *dh)
+{
+	const char *name;
+
+	name = getenv("DECT_CAPTURE_FILE");
+	if (name == NULL)
+		return;
+
+	capture_fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (capture_fd < 0)
+		pexit(name);
+	if (dect_capture_start(dh, capture_fd) < 0)
+		pexit("dect_capture_start");
+}
+
+/* Size the trace ring from DECT_TRACE_RECORDS, defaulting to 4096 records */
+static void dect_trace_records_init(struct dect_ops *ops)
+{
+	const char *records;
+	unsigned long n;
+	char *end;
+
+	if (ops->trace_records != 0)
+		return;
+
+	records = getenv("DECT_TRACE_RECORDS");
+	if (records == NULL) {
+		ops->trace_records = 4096;
+		return;
+	}
+
+	errno = 0;
+	n = strtoul(records, &end, 0);
+	if (errno != 0 || end == records || *end != '\0' ||
+	    n > DECT_TRACE_MAX_RECORDS) {
+		fprintf(stderr, "invalid DECT_TRACE_RECORDS '%s'\n", records);
+		exit(1);
+	}
+	ops->trace_records = n;
+}
+
 void dect_common_init(struct dect_ops *ops, const char *cluster)
 {
 	dect_debug_init();
 	dect_dummy_ops_init(ops);
 
+	dect_trace_records_init(ops);
+
 	if (dect_event_ops_init(ops))
 		pexit("dect_event_ops_init");
 
 	dh = dect_open_handle(ops, cluster);
 	if (dh == NULL)
 		pexit("dect_init");
+
+	dect_capture_init(dh);
+}
+
+/* Save the trace ring for trace-decode if DECT_TRACE_FILE is set */
+static void dect_trace_save(const struct dect_handle *dh)
+{
+	const char *name;
+	int fd;
+
+	name = getenv("DECT_TRACE_FILE");
+	if (name == NULL)
+		return;
+
+	fd = open(name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return perror(name);
+	if (dect_trace_write(dh, fd) < 0)
+		perror("dect_trace_write");
+	close(fd);
 }
 
 void dect_common_cleanup(struct dect_handle *dh)
 {
+	dect_trace_save(dh);
 	dect_close_handle(dh);
 	dect_event_ops_cleanup();
+	if (capture_fd >= 0)
+		close(capture_fd);
 }
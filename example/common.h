@@ -45,10 +45,14 @@ extern void pexit(const char *str);
 
 struct dect_audio_handle {
 	struct g72x_state	codec;
-	struct dect_msg_buf	*queue;
+	struct dect_mbuf_queue	queue;
+	struct dect_mbuf_queue	played;
 };
 
+#define DECT_AUDIO_QUEUE_MAX	64
+
 extern struct dect_audio_handle *dect_audio_open(void);
-extern void dect_audio_queue(struct dect_audio_handle *ah, struct dect_msg_buf *mb);
+extern void dect_audio_queue(struct dect_handle *dh, struct dect_audio_handle *ah,
+			     struct dect_msg_buf *mb);
 
 #endif /* _DECT_TEST_COMMON_H */
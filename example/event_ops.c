@@ -79,6 +79,7 @@ static const struct dect_event_ops dect_event_ops = {
 
 static struct event_base *ev_base;
 static struct event sig_event;
+static struct event trace_event;
 static bool sigint;
 static bool endloop;
 
@@ -87,6 +88,17 @@ static void sig_callback(int fd, short event, void *data)
 	sigint = true;
 }
 
+static void trace_callback(int fd, short event, void *data)
+{
+	const struct dect_trace_ring *ring;
+
+	ring = dect_trace_ring(dh);
+	if (ring == NULL)
+		return;
+	dect_trace_print(stdout, ring, sizeof(*ring) +
+			 ring->size * sizeof(ring->records[0]));
+}
+
 int dect_event_ops_init(struct dect_ops *ops)
 {
 
@@ -97,6 +109,9 @@ int dect_event_ops_init(struct dect_ops *ops)
 
 	signal_set(&sig_event, SIGINT, sig_callback, NULL);
 	signal_add(&sig_event, NULL);
+
+	signal_set(&trace_event, SIGUSR1, trace_callback, NULL);
+	signal_add(&trace_event, NULL);
 	return 0;
 }
 
@@ -115,6 +130,7 @@ void dect_event_loop(void)
 
 void dect_event_ops_cleanup(void)
 {
+	signal_del(&trace_event);
 	signal_del(&sig_event);
 	event_base_free(ev_base);
 }
@@ -196,7 +196,7 @@ static void dect_dl_u_data_ind(struct dect_handle *dh, struct dect_call *call,
 
 	dect_dl_u_data_req(dh, call, mb);
 	if (priv->audio != NULL)
-		dect_audio_queue(priv->audio, mb);
+		dect_audio_queue(dh, priv->audio, mb);
 }
 
 static struct dect_cc_ops cc_ops = {
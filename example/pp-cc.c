@@ -63,7 +63,7 @@ static void dect_dl_u_data_ind(struct dect_handle *dh, struct dect_call *call,
 	struct call *priv = dect_call_priv(call);
 
 	dect_dl_u_data_req(dh, call, mb);
-	dect_audio_queue(priv->audio, mb);
+	dect_audio_queue(dh, priv->audio, mb);
 }
 
 static struct dect_cc_ops cc_ops = {
@@ -0,0 +1,50 @@
+/*
+ * Render a libdect trace ring saved using dect_trace_write() to text
+ *
+ * usage: trace-decode [FILE]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <dect/libdect.h>
+
+int main(int argc, char **argv)
+{
+	const char *name = argc > 1 ? argv[1] : "-";
+	size_t size = 0, alloc = 0, len;
+	uint8_t *buf = NULL;
+	FILE *f = stdin;
+
+	if (strcmp(name, "-") && (f = fopen(name, "r")) == NULL) {
+		perror(name);
+		exit(1);
+	}
+
+	do {
+		if (size == alloc) {
+			alloc = alloc ? 2 * alloc : 65536;
+			buf = realloc(buf, alloc);
+			if (buf == NULL) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		len = fread(buf + size, 1, alloc - size, f);
+		size += len;
+	} while (len > 0);
+
+	if (ferror(f)) {
+		perror(name);
+		exit(1);
+	}
+
+	if (dect_trace_print(stdout, (struct dect_trace_ring *)buf, size) < 0) {
+		fprintf(stderr, "%s: invalid trace ring\n", name);
+		exit(1);
+	}
+
+	free(buf);
+	return 0;
+}
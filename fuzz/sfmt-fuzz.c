@@ -0,0 +1,339 @@
+/*
+ * S-Format parser fuzzing harness
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * usage: sfmt-fuzz [FILE...]
+ *
+ * Entry point for libFuzzer (configure --enable-libfuzzer) or, when built
+ * without libFuzzer, a driver running each FILE or stdin through the same
+ * code, suitable for AFL.
+ *
+ * Inputs consist of a two byte header followed by S-Format encoded IEs:
+ *
+ * byte 0:	flags (enum fuzz_flags)
+ * byte 1:	message description index, modulo the number of descriptions
+ *
+ * In message mode the IEs are parsed as message using the selected message
+ * description, indexed as zero-copy view and rebuilt by the sending side. In
+ * IE mode they are parsed one by one using the IE handler selected by the
+ * wire identifier. Inputs whose processing time exceeds a budget linear in
+ * their length are reported as findings. The budget can be adjusted using
+ * the environment variables SFMT_FUZZ_NS_BASE and SFMT_FUZZ_NS_PER_BYTE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+
+#include <libdect.h>
+#include <dect/sim.h>
+#include <utils.h>
+#include <s_fmt.h>
+
+#define FUZZ_MAX_LEN		4096
+#define FUZZ_NS_BASE		1000000
+#define FUZZ_NS_PER_BYTE	2000
+#define FUZZ_RETRIES		3
+
+enum fuzz_flags {
+	FUZZ_RX_PP		= 0x1,	/* message was sent by the FP */
+	FUZZ_IE_ARENA		= 0x2,	/* parse into a per-message IE arena */
+	FUZZ_IE_MODE		= 0x4,	/* parse individual IEs */
+};
+
+/**
+ * struct fuzz_input - decoded fuzzer input
+ *
+ * @tx:		sending handle
+ * @rx:		receiving handle
+ * @mdesc:	message description
+ * @flags:	input flags
+ * @data:	IE data
+ * @len:	length of IE data
+ */
+struct fuzz_input {
+	struct dect_handle			*tx;
+	struct dect_handle			*rx;
+	const struct dect_sfmt_msg_desc		*mdesc;
+	uint8_t					flags;
+	uint8_t					*data;
+	unsigned int				len;
+};
+
+static struct dect_ops fp_ops[2] = {
+	{ .event_ops = &dect_loop_event_ops, },
+	{ .event_ops = &dect_loop_event_ops, .ie_arena = true, },
+};
+
+static struct dect_ops pp_ops[2] = {
+	{ .event_ops = &dect_loop_event_ops, },
+	{ .event_ops = &dect_loop_event_ops, .ie_arena = true, },
+};
+
+static struct dect_handle *fp[2], *pp[2];
+static const struct dect_sfmt_msg_desc *mdescs[256];
+static unsigned int nmdescs;
+static uint64_t ns_base = FUZZ_NS_BASE, ns_per_byte = FUZZ_NS_PER_BYTE;
+
+static uint64_t fuzz_clock(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * Message buffers refer to an exactly sized copy of the input, so the
+ * sanitizers catch reads beyond the end of the message.
+ */
+static void fuzz_mbuf_init(struct dect_msg_buf *mb, uint8_t *data,
+			   unsigned int len)
+{
+	memset(mb, 0, sizeof(*mb));
+	mb->ext	 = data;
+	mb->size = len;
+	mb->data = data;
+	mb->len	 = len;
+}
+
+static void fuzz_msg_view(const struct fuzz_input *in,
+			  const struct dect_msg_buf *mb)
+{
+	const struct dect_sfmt_ie_desc *desc;
+	struct dect_msg_view view;
+	struct dect_ie_common *ie;
+
+	if (dect_msg_view_init(in->rx, &view, in->mdesc, mb) != DECT_SFMT_OK)
+		return;
+
+	for (desc = in->mdesc->ie; !(desc->flags & DECT_SFMT_IE_END); desc++) {
+		if (dect_sfmt_ie_size(desc->type) == 0)
+			continue;
+		ie = dect_msg_view_copy(in->rx, &view, desc->type);
+		if (ie != NULL)
+			__dect_ie_put(in->rx, ie);
+	}
+}
+
+static void fuzz_msg(const struct fuzz_input *in)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	struct dect_msg_common *msg;
+	struct dect_msg_buf *tmb;
+
+	msg = malloc(sizeof(*msg) + in->mdesc->tbl->size);
+	if (msg == NULL)
+		return;
+
+	fuzz_mbuf_init(mb, in->data, in->len);
+	fuzz_msg_view(in, mb);
+
+	if (dect_parse_sfmt_msg(in->rx, in->mdesc, msg, mb) != DECT_SFMT_OK)
+		goto out;
+
+	tmb = dect_mbuf_alloc(in->tx);
+	if (tmb != NULL) {
+		dect_build_sfmt_msg(in->tx, in->mdesc, msg, tmb);
+		dect_mbuf_free(in->tx, tmb);
+	}
+	dect_msg_free(in->rx, in->mdesc, msg);
+out:
+	free(msg);
+}
+
+static void fuzz_ie(const struct fuzz_input *in)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
+	DECT_DEFINE_MSG_BUF_ONSTACK(tmb);
+	struct dect_ie_common *ie;
+	struct dect_ie_list iel;
+	struct dect_sfmt_ie sie;
+
+	fuzz_mbuf_init(mb, in->data, in->len);
+	while (mb->len > 0) {
+		if (dect_parse_sfmt_ie_header(&sie, mb) != DECT_SFMT_OK)
+			break;
+
+		/* IEs without storage of their own are parsed into an IE list */
+		if (dect_sfmt_ie_size(sie.id) == 0) {
+			dect_ie_list_init(&iel);
+			dect_parse_sfmt_ie(in->rx, sie.id,
+					   (struct dect_ie_common **)&iel, &sie);
+		} else if (dect_parse_sfmt_ie(in->rx, sie.id, &ie, &sie) ==
+			   DECT_SFMT_OK) {
+			/* A previous build may have expanded the buffer */
+			dect_mbuf_release_ext(in->tx, &tmb);
+			tmb.data = tmb.head;
+			tmb.len	 = 0;
+			dect_build_sfmt_ie(in->tx, sie.id, &tmb, ie);
+			__dect_ie_put(in->rx, ie);
+		}
+
+		dect_mbuf_pull(mb, sie.len);
+	}
+	dect_mbuf_release_ext(in->tx, &tmb);
+}
+
+static void fuzz_one(const struct fuzz_input *in)
+{
+	if (in->flags & FUZZ_IE_MODE)
+		fuzz_ie(in);
+	else
+		fuzz_msg(in);
+}
+
+static int fuzz_input_init(struct fuzz_input *in, const uint8_t *data,
+			   size_t size)
+{
+	unsigned int arena;
+
+	if (size < 2 || size > FUZZ_MAX_LEN)
+		return -1;
+
+	in->flags = data[0];
+	arena	  = in->flags & FUZZ_IE_ARENA ? 1 : 0;
+	if (in->flags & FUZZ_RX_PP) {
+		in->tx = fp[arena];
+		in->rx = pp[arena];
+	} else {
+		in->tx = pp[arena];
+		in->rx = fp[arena];
+	}
+	in->mdesc = mdescs[data[1] % nmdescs];
+
+	in->len	 = size - 2;
+	in->data = malloc(max(in->len, 1U));
+	if (in->data == NULL)
+		return -1;
+	memcpy(in->data, data + 2, in->len);
+	return 0;
+}
+
+int LLVMFuzzerInitialize(int *argc, char ***argv);
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerInitialize(int *argc, char ***argv)
+{
+	struct dect_ari pari = { .arc = DECT_ARC_A, .emc = 0x0ba8, .fpn = 0x1 };
+	const struct dect_sfmt_msg_desc * const *ref, *mdesc;
+	struct dect_fp_capabilities fpc = {};
+	struct dect_sim *sim;
+	const char *env;
+	unsigned int i;
+
+	dect_set_debug_mask(0);
+
+	if ((env = getenv("SFMT_FUZZ_NS_BASE")) != NULL)
+		ns_base = strtoull(env, NULL, 0);
+	if ((env = getenv("SFMT_FUZZ_NS_PER_BYTE")) != NULL)
+		ns_per_byte = strtoull(env, NULL, 0);
+
+	dect_foreach_sfmt_msg_desc(ref, mdesc) {
+		if (nmdescs < array_size(mdescs))
+			mdescs[nmdescs++] = mdesc;
+	}
+
+	for (i = 0; i < array_size(fp); i++) {
+		sim = dect_sim_alloc(&pari, &fpc);
+		if (sim == NULL)
+			goto err;
+		fp[i] = dect_sim_open_fp(sim, &fp_ops[i]);
+		pp[i] = dect_sim_open_pp(sim, &pp_ops[i]);
+		if (fp[i] == NULL || pp[i] == NULL)
+			goto err;
+	}
+	return 0;
+
+err:
+	perror("sfmt-fuzz: open handles");
+	exit(1);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	struct fuzz_input in;
+	uint64_t ns, min = UINT64_MAX, budget;
+	unsigned int i;
+
+	if (fuzz_input_init(&in, data, size) < 0)
+		return 0;
+
+	/* Only report slow inputs that are slow on each of a few attempts,
+	 * to tolerate scheduling noise. */
+	budget = ns_base + ns_per_byte * in.len;
+	for (i = 0; i < FUZZ_RETRIES && min > budget; i++) {
+		ns = fuzz_clock();
+		fuzz_one(&in);
+		ns = fuzz_clock() - ns;
+		min = ns < min ? ns : min;
+	}
+
+	if (min > budget) {
+		fprintf(stderr, "sfmt-fuzz: super-linear processing time: "
+			"%s mode, message %s, flags %#x, length %u: "
+			"%" PRIu64 " ns, budget %" PRIu64 " ns\n",
+			in.flags & FUZZ_IE_MODE ? "IE" : "message",
+			in.mdesc->name, in.flags, in.len, min, budget);
+		abort();
+	}
+
+	free(in.data);
+	return 0;
+}
+
+#ifndef CONFIG_LIBFUZZER
+static int fuzz_file(const char *name)
+{
+	size_t size = 0, alloc = 0, len;
+	uint8_t *buf = NULL;
+	FILE *f = stdin;
+
+	if (strcmp(name, "-") && (f = fopen(name, "r")) == NULL) {
+		perror(name);
+		return -1;
+	}
+
+	do {
+		if (size == alloc) {
+			alloc = alloc ? 2 * alloc : FUZZ_MAX_LEN;
+			buf = realloc(buf, alloc);
+			if (buf == NULL) {
+				perror("realloc");
+				exit(1);
+			}
+		}
+		len = fread(buf + size, 1, alloc - size, f);
+		size += len;
+	} while (len > 0);
+
+	if (f != stdin)
+		fclose(f);
+
+	LLVMFuzzerTestOneInput(buf, size);
+	free(buf);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int i, rc = 0;
+
+	LLVMFuzzerInitialize(&argc, &argv);
+
+	if (argc < 2)
+		return fuzz_file("-") < 0;
+	for (i = 1; i < argc; i++) {
+		if (fuzz_file(argv[i]) < 0)
+			rc = 1;
+	}
+	return rc;
+}
+#endif
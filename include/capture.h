@@ -0,0 +1,49 @@
+/*
+ * libdect pcapng packet capture
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ */
+
+#ifndef _LIBDECT_CAPTURE_H
+#define _LIBDECT_CAPTURE_H
+
+#include <sys/uio.h>
+#include <linux/dect.h>
+#include <dect/capture.h>
+
+struct dect_handle;
+struct dect_msg_buf;
+
+extern void __dect_capture(const struct dect_handle *dh,
+			   enum dect_capture_saps sap,
+			   enum dect_capture_directions dir, uint8_t flags,
+			   const struct sockaddr_dect_ssap *dlei,
+			   const struct dect_raw_auxdata *aux,
+			   const struct iovec *iov, unsigned int iovcnt);
+extern void dect_capture_complete(const struct dect_handle *dh);
+
+/*
+ * Capture a packet consisting of @iovcnt segments. The arguments are only
+ * evaluated if capturing is active.
+ */
+#define dect_capture_iov(dh, sap, dir, flags, dlei, aux, iov, iovcnt)	\
+	({								\
+		if (__builtin_expect((dh)->capture != NULL, 0))		\
+			__dect_capture(dh, sap, dir, flags, dlei, aux,	\
+				       iov, iovcnt);			\
+	})
+
+/* Capture a packet contained in a message buffer */
+#define dect_capture_mbuf(dh, sap, dir, flags, dlei, aux, mb)		\
+	({								\
+		if (__builtin_expect((dh)->capture != NULL, 0)) {	\
+			struct iovec __iov = {				\
+				.iov_base = (mb)->data,			\
+				.iov_len  = (mb)->len,			\
+			};						\
+			__dect_capture(dh, sap, dir, flags, dlei, aux,	\
+				       &__iov, 1);			\
+		}							\
+	})
+
+#endif /* _LIBDECT_CAPTURE_H */
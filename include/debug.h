@@ -8,12 +8,23 @@ extern void __dect_debug(enum dect_debug_subsys subsys, const char *fmt, ...) __
 extern void __dect_hexdump(enum dect_debug_subsys subsys, const char *prefix,
 			   const uint8_t *buf, size_t size);
 
+extern uint32_t dect_debug_mask;
+
+/*
+ * The debugging mask is checked before evaluating the arguments, messages of
+ * disabled subsystems cost a single, predictable branch.
+ */
 #ifdef DEBUG
+#define dect_debug_enabled(subsys) \
+	__builtin_expect(!!(dect_debug_mask & DECT_DEBUG_MASK(subsys)), 0)
 #define dect_debug(subsys, fmt, ...) \
-	__dect_debug(subsys, fmt, ## __VA_ARGS__)
+	({ if (dect_debug_enabled(subsys)) \
+		__dect_debug(subsys, fmt, ## __VA_ARGS__); })
 #define dect_hexdump(subsys, pfx, buf, size) \
-	__dect_hexdump(subsys, pfx, buf, size)
+	({ if (dect_debug_enabled(subsys)) \
+		__dect_hexdump(subsys, pfx, buf, size); })
 #else
+#define dect_debug_enabled(subsys)	0
 #define dect_debug(subsys, fmt, ...) \
 	({ if (0) __dect_debug(subsys, fmt, ## __VA_ARGS__); })
 #define dect_hexdump(subsys, pfx, buf, size) \
@@ -0,0 +1,92 @@
+#ifndef _LIBDECT_DECT_CAPTURE_H
+#define _LIBDECT_DECT_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @addtogroup capture
+ * @{
+ */
+
+/** pcapng link type of captured packets (LINKTYPE_USER0) */
+#define DECT_CAPTURE_LINKTYPE		147
+
+/** Capture header version */
+#define DECT_CAPTURE_VERSION		1
+
+/**
+ * Service access point a packet was captured on
+ */
+enum dect_capture_saps {
+	DECT_CAPTURE_S_SAP,		/**< S-SAP (NWK layer messages) */
+	DECT_CAPTURE_B_SAP,		/**< B-SAP (broadcast messages) */
+	DECT_CAPTURE_LU1,		/**< LU1-SAP (U-plane data) */
+	DECT_CAPTURE_RAW,		/**< Raw MAC frames */
+};
+
+/**
+ * Packet direction
+ */
+enum dect_capture_directions {
+	DECT_CAPTURE_RX,		/**< Received packet */
+	DECT_CAPTURE_TX,		/**< Transmitted packet */
+};
+
+/**
+ * Capture header flags
+ */
+enum dect_capture_flags {
+	DECT_CAPTURE_LONG_PAGE	= 0x1,	/**< B-SAP long page */
+	DECT_CAPTURE_FAST_PAGE	= 0x2,	/**< B-SAP fast page */
+};
+
+/**
+ * Capture header
+ *
+ * @arg version		#DECT_CAPTURE_VERSION
+ * @arg sap		service access point (#dect_capture_saps)
+ * @arg direction	packet direction (#dect_capture_directions)
+ * @arg flags		capture header flags (#dect_capture_flags)
+ * @arg pmid		PMID of the data link
+ * @arg ari		ARI of the data link
+ * @arg lln		logical link number of the data link
+ * @arg sapi		SAPI of the data link
+ * @arg lcn		logical connection number of the data link
+ * @arg slot		slot number of raw frames
+ * @arg mfn		multiframe number of raw frames
+ * @arg frame		frame number of raw frames
+ *
+ * Each captured packet starts with a capture header, followed by the
+ * packet data. All fields are in network byte order, fields not applying
+ * to a packet are zero.
+ */
+struct dect_capture_hdr {
+	uint8_t		version;
+	uint8_t		sap;
+	uint8_t		direction;
+	uint8_t		flags;
+	uint32_t	pmid;
+	uint64_t	ari;
+	uint8_t		lln;
+	uint8_t		sapi;
+	uint8_t		lcn;
+	uint8_t		slot;
+	uint32_t	mfn;
+	uint8_t		frame;
+	uint8_t		reserved[7];
+};
+
+struct dect_handle;
+extern int dect_capture_start(struct dect_handle *dh, int fd);
+extern void dect_capture_stop(struct dect_handle *dh);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_CAPTURE_H */
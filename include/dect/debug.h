@@ -6,6 +6,7 @@ extern "C" {
 #endif
 
 #include <stdarg.h>
+#include <stdint.h>
 #include <dect/utils.h>
 
 /**
@@ -27,9 +28,16 @@ enum dect_debug_subsys {
 	DECT_DEBUG_NL,		/**< Netlink communication */
 };
 
+/** Debugging mask bit of subsystem @a subsys */
+#define DECT_DEBUG_MASK(subsys)		(1U << (subsys))
+/** Debugging mask enabling all subsystems */
+#define DECT_DEBUG_MASK_ALL		(~0U)
+
 extern void dect_set_debug_hook(void (*fn)(enum dect_debug_subsys subsys,
 					   const char *fmt, va_list ap)
 				__fmtstring(2, 0));
+extern void dect_set_debug_mask(uint32_t mask);
+extern uint32_t dect_get_debug_mask(void);
 
 /** @} */
 
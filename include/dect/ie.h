@@ -70,9 +70,12 @@ extern void __dect_ie_collection_put(const struct dect_handle *dh, struct dect_i
  * The members of this structure may only be manipulated through the appropriate
  * helper functions.
  */
+struct dect_ie_arena;
+
 struct dect_ie_common {
 	struct dect_ie_common		*next;	/**< IE list list node */
 	unsigned int			refcnt;	/**< Reference count */
+	struct dect_ie_arena		*arena;	/**< Arena the IE was allocated from */
 };
 
 /**
@@ -87,6 +90,7 @@ static inline struct dect_ie_common *__dect_ie_init(struct dect_ie_common *ie)
 {
 	ie->refcnt = 1;
 	ie->next   = NULL;
+	ie->arena  = NULL;
 	return ie;
 }
 
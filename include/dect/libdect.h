@@ -24,6 +24,8 @@ extern "C" {
 #include <dect/ss.h>
 #include <dect/clms.h>
 #include <dect/debug.h>
+#include <dect/trace.h>
+#include <dect/capture.h>
 
 struct dect_handle;
 
@@ -33,9 +35,16 @@ struct dect_handle;
  * @arg next	Data link TX queue node
  * @arg refcnt	Reference count
  * @arg type	Message type
+ * @arg flags	Internal transmit flags
  * @arg len	Data length
+ * @arg size	Size of the external storage area
  * @arg data	Data pointer
- * @arg head	Storage area for on-stack buffers
+ * @arg ext	External storage area for large messages, NULL if unused
+ * @arg head	Storage area for small messages
+ *
+ * Messages fitting into the head are stored inline. Larger messages are moved
+ * to an external storage area by dect_mbuf_expand(), which is released when
+ * the buffer is freed.
  */
 struct dect_msg_buf {
 	struct dect_msg_buf	*next;
@@ -44,23 +53,44 @@ struct dect_msg_buf {
 	uint8_t			slot;
 	uint8_t			refcnt;
 	uint8_t			type;
-	uint8_t			len;
+	uint8_t			flags;
+	uint16_t		len;
+	uint16_t		size;
 	uint8_t			*data;
+	uint8_t			*ext;
 	uint8_t			head[128];
 };
 
+/** Maximum size of a message buffer's storage area */
+#define DECT_MSG_BUF_MAX_SIZE	UINT16_MAX
+
 /** Define a dect_msg_buf on the stack and initialize it approriately. */
 #define DECT_DEFINE_MSG_BUF_ONSTACK(name)	\
 	struct dect_msg_buf name = {		\
 		.data = name.head,		\
 	}
 
+/**
+ * DECT message buffer pool statistics
+ */
+struct dect_mbuf_pool_stats {
+	uint32_t		hits;		/**< allocations satisfied from the pool */
+	uint32_t		misses;		/**< allocations passed to the allocator */
+	uint32_t		releases;	/**< buffers freed above the high-water mark */
+	uint32_t		cached;		/**< buffers currently cached in the pool */
+};
+
 extern struct dect_msg_buf *dect_mbuf_alloc(const struct dect_handle *dh);
 extern void dect_mbuf_free(const struct dect_handle *dh, struct dect_msg_buf *mb);
 extern void *dect_mbuf_pull(struct dect_msg_buf *mb, unsigned int len);
 extern void *dect_mbuf_push(struct dect_msg_buf *mb, unsigned int len);
 extern void dect_mbuf_reserve(struct dect_msg_buf *mb, unsigned int len);
 extern void *dect_mbuf_put(struct dect_msg_buf *mb, unsigned int len);
+extern unsigned int dect_mbuf_tailroom(const struct dect_msg_buf *mb);
+extern int dect_mbuf_expand(const struct dect_handle *dh,
+			    struct dect_msg_buf *mb, unsigned int len);
+extern void dect_mbuf_pool_stats(const struct dect_handle *dh,
+				 struct dect_mbuf_pool_stats *stats);
 
 /**
  * @addtogroup io
@@ -119,6 +149,13 @@ struct dect_event_ops {
 				      struct dect_timer *timer);
 };
 
+extern const struct dect_event_ops dect_loop_event_ops;
+extern const struct dect_event_ops dect_loop_et_event_ops;
+
+extern int dect_loop_run(struct dect_handle *dh);
+extern void dect_loop_stop(const struct dect_handle *dh);
+extern int dect_loop_handle_signals(const struct dect_handle *dh);
+
 /** @} */
 
 /**
@@ -132,6 +169,19 @@ struct dect_ops {
 	void				*(*malloc)(size_t size);
 	void				(*free)(void *ptr);
 
+	unsigned int			mbuf_pool_size;
+	/**< number of message buffers to preallocate */
+	unsigned int			mbuf_pool_max;
+	/**< maximum number of cached message buffers (high-water mark) */
+	unsigned int			rx_budget;
+	/**< maximum number of messages received per socket readiness event */
+	bool				timer_wheel;
+	/**< drive internal timers from a single application timer */
+	bool				ie_arena;
+	/**< allocate the IEs of each received message from a single block */
+	unsigned int			trace_records;
+	/**< number of records of the binary trace ring, 0 disables tracing */
+
 	const struct dect_event_ops	*event_ops;
 	const struct dect_llme_ops_	*llme_ops;
 	const struct dect_lce_ops	*lce_ops;
@@ -120,7 +120,7 @@ enum dect_sfmt_variable_length_ies {
 struct dect_sfmt_ie {
 	uint8_t			*data;
 	uint8_t			id;
-	uint8_t			len;
+	uint16_t		len;
 };
 
 /**
@@ -131,6 +131,7 @@ enum dect_sfmt_error {
 	DECT_SFMT_MANDATORY_IE_MISSING	= -1,	/**< A mandatory IE was missing */
 	DECT_SFMT_MANDATORY_IE_ERROR	= -2,	/**< A mandatory IE had an internal structural error */
 	DECT_SFMT_INVALID_IE		= -3,	/**< An invalid IE was passed to message construction */
+	DECT_SFMT_NO_BUFFER_SPACE	= -4,	/**< The message buffer could not be expanded */
 };
 
 extern enum dect_sfmt_error dect_build_sfmt_ie(const struct dect_handle *dh, uint8_t type,
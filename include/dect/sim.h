@@ -0,0 +1,35 @@
+/*
+ * libdect simulated DECT transport
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ */
+
+#ifndef _LIBDECT_DECT_SIM_H
+#define _LIBDECT_DECT_SIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @addtogroup sim
+ * @{
+ */
+
+struct dect_sim;
+
+extern struct dect_sim *dect_sim_alloc(const struct dect_ari *pari,
+				       const struct dect_fp_capabilities *fpc);
+extern void dect_sim_free(struct dect_sim *sim);
+
+extern struct dect_handle *dect_sim_open_fp(struct dect_sim *sim,
+					    struct dect_ops *ops);
+extern struct dect_handle *dect_sim_open_pp(struct dect_sim *sim,
+					    struct dect_ops *ops);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_SIM_H */
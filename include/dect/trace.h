@@ -0,0 +1,116 @@
+#ifndef _LIBDECT_DECT_TRACE_H
+#define _LIBDECT_DECT_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/**
+ * @addtogroup trace
+ * @{
+ */
+
+/**
+ * Trace events
+ */
+enum dect_trace_events {
+	DECT_TRACE_LCE_LINK_ALLOC,	/**< Data link allocated */
+	DECT_TRACE_LCE_LINK_STATE,	/**< Data link state change */
+	DECT_TRACE_LCE_LINK_DESTROY,	/**< Data link destroyed */
+	DECT_TRACE_LCE_TX,		/**< Message transmitted on a data link */
+	DECT_TRACE_LCE_RX,		/**< Message received on a data link */
+	DECT_TRACE_LCE_TA_OPEN,		/**< Transaction opened */
+	DECT_TRACE_LCE_TA_CONFIRM,	/**< Transaction confirmed */
+	DECT_TRACE_LCE_TA_CLOSE,	/**< Transaction closed */
+	DECT_TRACE_CC_TX,		/**< CC message transmitted */
+	DECT_TRACE_CC_RX,		/**< CC message received */
+	DECT_TRACE_MM_PROC_INITIATE,	/**< MM procedure initiated */
+	DECT_TRACE_MM_PROC_RESPOND,	/**< MM procedure responded to */
+	DECT_TRACE_MM_PROC_COMPLETE,	/**< MM procedure completed */
+	DECT_TRACE_MM_PROC_TIMEOUT,	/**< MM procedure timed out */
+	DECT_TRACE_SFMT_PARSE,		/**< S-Format message parsed */
+	DECT_TRACE_SFMT_BUILD,		/**< S-Format message constructed */
+	__DECT_TRACE_MAX
+};
+#define DECT_TRACE_MAX			(__DECT_TRACE_MAX - 1)
+
+/** Maximum amount of raw message data stored in a trace record */
+#define DECT_TRACE_DATA_SIZE		22
+
+/** Link or transaction value of records not associated with one */
+#define DECT_TRACE_NONE			0xff
+
+/**
+ * Trace record
+ *
+ * @arg seq	Sequence number plus one, zero while the record is written
+ * @arg time	CLOCK_MONOTONIC timestamp in nanoseconds
+ * @arg event	Trace event
+ * @arg subsys	Debugging subsystem of the event
+ * @arg pd	Protocol discriminator of the transaction or #DECT_TRACE_NONE
+ * @arg link	Data link socket or -1
+ * @arg tv	Transaction value of the transaction
+ * @arg arg	Event specific arguments
+ * @arg len	Amount of raw message data
+ * @arg data	Raw message data
+ */
+struct dect_trace_record {
+	uint64_t		seq;
+	uint64_t		time;
+	uint16_t		event;
+	uint8_t			subsys;
+	uint8_t			pd;
+	int16_t			link;
+	uint16_t		tv;
+	uint32_t		arg[4];
+	uint16_t		len;
+	uint8_t			data[DECT_TRACE_DATA_SIZE];
+};
+
+/** Trace ring magic value */
+#define DECT_TRACE_MAGIC		0x44545243
+/** Trace ring format version */
+#define DECT_TRACE_VERSION		1
+/** Maximum number of records of a trace ring */
+#define DECT_TRACE_MAX_RECORDS		(1U << 20)
+
+/**
+ * Trace ring
+ *
+ * @arg magic		#DECT_TRACE_MAGIC
+ * @arg version		#DECT_TRACE_VERSION
+ * @arg record_size	size of a trace record
+ * @arg size		number of records, a power of two
+ * @arg head		sequence number of the next record
+ * @arg records		trace records, indexed by sequence number modulo size
+ *
+ * The ring is written by the thread running the libdect handle without
+ * locking. Readers validate each record by comparing its sequence number
+ * before and after copying it.
+ */
+struct dect_trace_ring {
+	uint32_t			magic;
+	uint16_t			version;
+	uint16_t			record_size;
+	uint32_t			size;
+	uint32_t			reserved;
+	uint64_t			head;
+	struct dect_trace_record	records[];
+};
+
+struct dect_handle;
+extern const struct dect_trace_ring *dect_trace_ring(const struct dect_handle *dh);
+extern ssize_t dect_trace_write(const struct dect_handle *dh, int fd);
+extern int dect_trace_print(FILE *f, const struct dect_trace_ring *ring,
+			    size_t size);
+
+/** @} */
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _LIBDECT_DECT_TRACE_H */
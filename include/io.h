@@ -15,12 +15,29 @@ enum dect_fd_state {
 	DECT_FD_REGISTERED,
 };
 
+/**
+ * enum dect_fd_flags - libdect file descriptor flags
+ *
+ * @DECT_FD_DRAIN:	callback receives until the socket is drained or the
+ *			receive budget is exhausted
+ * @DECT_FD_PENDING:	receive budget was exhausted, more data may be queued
+ * @DECT_FD_BUSY:	callback is running, freeing is deferred until it returns
+ * @DECT_FD_DESTROYED:	descriptor was closed while busy
+ */
+enum dect_fd_flags {
+	DECT_FD_DRAIN		= 0x1,
+	DECT_FD_PENDING		= 0x2,
+	DECT_FD_BUSY		= 0x4,
+	DECT_FD_DESTROYED	= 0x8,
+};
+
 /**
  * struct dect_fd - libdect file descriptor
  *
  * @callback:		callback to invoke for events
  * @fd:			file descriptor numer
  * @state:		file descriptor registration state (debugging)
+ * @flags:		file descriptor flags (enum dect_fd_flags)
  * @data:		libdect internal data
  * @priv:		libdect user private file-descriptor storage
  */
@@ -29,6 +46,7 @@ struct dect_fd {
 					    struct dect_fd *, uint32_t);
 	int			fd;
 	enum dect_fd_state	state;
+	uint32_t		flags;
 	void			*data;
 	uint8_t			priv[] __aligned(__alignof__(uint64_t));
 };
@@ -45,6 +63,107 @@ extern struct dect_fd *dect_socket(const struct dect_handle *dh,
 extern struct dect_fd *dect_accept(const struct dect_handle *dh,
 				   const struct dect_fd *dfd,
 				   struct sockaddr *addr, socklen_t len);
+extern int dect_bind(const struct dect_handle *dh, struct dect_fd *dfd,
+		     const struct sockaddr *addr, socklen_t len);
+extern int dect_connect(const struct dect_handle *dh, struct dect_fd *dfd,
+			const struct sockaddr *addr, socklen_t len);
+extern int dect_listen(const struct dect_handle *dh, struct dect_fd *dfd,
+		       int backlog);
+extern int dect_getsockopt(const struct dect_handle *dh,
+			   const struct dect_fd *dfd, int level, int optname,
+			   void *optval, socklen_t *optlen);
+extern int dect_setsockopt(const struct dect_handle *dh,
+			   const struct dect_fd *dfd, int level, int optname,
+			   const void *optval, socklen_t optlen);
+
+/*
+ * Batched message reception
+ */
+#ifndef HAVE_STRUCT_MMSGHDR
+struct mmsghdr {
+	struct msghdr		msg_hdr;
+	unsigned int		msg_len;
+};
+#endif
+
+#define DECT_RX_BATCH_SIZE	16
+#define DECT_RX_CMSG_SIZE	(4 * CMSG_SPACE(16))
+#define DECT_RX_BUF_SIZE	1024
+
+#define DECT_RX_OVERFLOW_SIZE	(DECT_RX_BUF_SIZE - \
+				 sizeof(((struct dect_msg_buf *)0)->head))
+
+/**
+ * struct dect_rx_batch - batch of received messages
+ *
+ * @msg:	message headers
+ * @iov:	message data vectors, the inline storage area of the message
+ *		buffer followed by the overflow area
+ * @mb:		message buffers
+ * @cmsg:	control message buffers
+ * @overflow:	receive area for data exceeding the inline storage area, copied
+ *		to an allocated external storage area after reception
+ *
+ * A single batch is allocated per handle and shared by all receive paths, the
+ * message buffers are only valid until the next call to dect_rx_batch_rcv().
+ */
+struct dect_rx_batch {
+	struct mmsghdr		msg[DECT_RX_BATCH_SIZE];
+	struct iovec		iov[DECT_RX_BATCH_SIZE][2];
+	struct dect_msg_buf	mb[DECT_RX_BATCH_SIZE];
+	char			cmsg[DECT_RX_BATCH_SIZE][DECT_RX_CMSG_SIZE];
+	uint8_t			overflow[DECT_RX_BATCH_SIZE][DECT_RX_OVERFLOW_SIZE];
+};
+
+extern int dect_rx_batch_init(struct dect_handle *dh);
+extern void dect_rx_batch_exit(struct dect_handle *dh);
+extern int dect_rx_batch_rcv(const struct dect_handle *dh,
+			     const struct dect_fd *dfd, unsigned int n);
+
+extern unsigned int dect_rx_budget(const struct dect_handle *dh);
+
+/*
+ * Batched message transmission
+ */
+#define DECT_TX_BATCH_SIZE	16
+#define DECT_TX_CMSG_SIZE	CMSG_SPACE(16)
+
+/**
+ * struct dect_tx_batch - batch of messages to transmit
+ *
+ * @msg:	message headers
+ * @iov:	message data vectors
+ * @mb:		message buffers
+ * @cmsg:	control message buffers
+ * @cnt:	number of messages in batch
+ */
+struct dect_tx_batch {
+	struct mmsghdr		msg[DECT_TX_BATCH_SIZE];
+	struct iovec		iov[DECT_TX_BATCH_SIZE];
+	struct dect_msg_buf	*mb[DECT_TX_BATCH_SIZE];
+	char			cmsg[DECT_TX_BATCH_SIZE][DECT_TX_CMSG_SIZE];
+	unsigned int		cnt;
+};
+
+static inline bool dect_tx_batch_full(const struct dect_tx_batch *txb)
+{
+	return txb->cnt == DECT_TX_BATCH_SIZE;
+}
+
+extern void dect_tx_batch_init(struct dect_tx_batch *txb);
+extern struct msghdr *dect_tx_batch_add(struct dect_tx_batch *txb,
+					struct dect_msg_buf *mb);
+extern int dect_tx_batch_send(const struct dect_handle *dh,
+			      struct dect_tx_batch *txb,
+			      const struct dect_fd *dfd);
+
+/*
+ * Event processing: work deferred while processing an event, like batched
+ * transmissions and capture writes, is completed once the outermost event
+ * callback has returned.
+ */
+extern void dect_event_enter(struct dect_handle *dh);
+extern void dect_event_exit(struct dect_handle *dh);
 
 extern int dect_fd_register(const struct dect_handle *dh, struct dect_fd *dfd,
 			    uint32_t events);
@@ -13,6 +13,67 @@
 #include <s_fmt.h>
 #include <utils.h>
 
+/**
+ * struct dect_mbuf_pool - message buffer free list
+ *
+ * @free:	list of cached message buffers
+ * @count:	number of cached message buffers
+ * @max:	maximum number of cached message buffers (high-water mark)
+ * @stats:	pool statistics
+ */
+struct dect_mbuf_pool {
+	struct dect_msg_buf		*free;
+	unsigned int			count;
+	unsigned int			max;
+	struct dect_mbuf_pool_stats	stats;
+};
+
+#define DECT_MBUF_POOL_MAX_DEFAULT	32
+
+PTRQUEUE_HEAD(dect_mbuf_queue, struct dect_msg_buf);
+
+/**
+ * struct dect_bcast_queue - B-SAP broadcast transmit queue
+ *
+ * @queue:	broadcast messages waiting for transmission
+ * @blocked:	waiting for the B-SAP socket to become writable
+ */
+struct dect_bcast_queue {
+	struct dect_mbuf_queue		queue;
+	bool				blocked;
+};
+
+static inline uint8_t *dect_mbuf_start(const struct dect_msg_buf *mb)
+{
+	return mb->ext != NULL ? mb->ext : (uint8_t *)mb->head;
+}
+
+static inline uint8_t *dect_mbuf_end(const struct dect_msg_buf *mb)
+{
+	if (mb->ext != NULL)
+		return mb->ext + mb->size;
+	return (uint8_t *)mb->head + sizeof(mb->head);
+}
+
+/**
+ * dect_mbuf_release_ext - release the external storage area of a message buffer
+ *
+ * @dh:		libdect DECT handle
+ * @mb:		libdect message buffer
+ *
+ * Return the buffer to inline storage. Used by dect_mbuf_free() and for
+ * on-stack buffers that might have been expanded.
+ */
+static inline void dect_mbuf_release_ext(const struct dect_handle *dh,
+					 struct dect_msg_buf *mb)
+{
+	if (mb->ext == NULL)
+		return;
+	dect_free(dh, mb->ext);
+	mb->ext  = NULL;
+	mb->size = 0;
+}
+
 static inline void dect_mbuf_dump(enum dect_debug_subsys subsys,
 				  const struct dect_msg_buf *mb,
 				  const char *prefix)
@@ -41,6 +102,9 @@ enum dect_transaction_state {
 /* Connectionless NWK layer transaction value */
 #define DECT_TV_CONNECTIONLESS		6
 
+/* Number of transaction values representable in the S-Format header */
+#define DECT_TV_MAX			8
+
 enum dect_release_modes {
 	DECT_DDL_RELEASE_NORMAL,
 	DECT_DDL_RELEASE_PARTIAL,
@@ -92,17 +156,45 @@ extern int dect_lce_send(const struct dect_handle *dh,
 			 struct dect_transaction *ta,
 			 const struct dect_sfmt_msg_desc *desc,
 			 const struct dect_msg_common *msg, uint8_t type);
+extern int dect_lce_send_iov(const struct dect_handle *dh,
+			     struct dect_transaction *ta,
+			     const struct dect_sfmt_msg_desc *desc,
+			     const struct dect_msg_common *msg, uint8_t type);
 extern int dect_lce_retransmit(const struct dect_handle *dh,
 			       struct dect_transaction *ta);
 
+/**
+ * enum dect_lce_msg_tmpls - templates of frequently sent messages
+ *
+ * @DECT_TMPL_LCE_PAGE_REJECT:	{LCE-PAGE-REJECT}
+ * @DECT_TMPL_CC_RELEASE_COM:	{CC-RELEASE-COM}
+ * @DECT_TMPL_MM_LOCATE_ACCEPT:	{MM-LOCATE-ACCEPT}
+ * @DECT_TMPL_MM_INFO_ACCEPT:	{MM-INFO-ACCEPT}
+ */
+enum dect_lce_msg_tmpls {
+	DECT_TMPL_LCE_PAGE_REJECT,
+	DECT_TMPL_CC_RELEASE_COM,
+	DECT_TMPL_MM_LOCATE_ACCEPT,
+	DECT_TMPL_MM_INFO_ACCEPT,
+	__DECT_TMPL_MAX
+};
+#define DECT_TMPL_MAX			(__DECT_TMPL_MAX - 1)
+
+extern int dect_lce_send_tmpl(const struct dect_handle *dh,
+			      struct dect_transaction *ta,
+			      enum dect_lce_msg_tmpls tmpl,
+			      const struct dect_sfmt_msg_desc *desc,
+			      const struct dect_msg_common *msg, uint8_t type);
+
 extern int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui,
 			    const struct dect_sfmt_msg_desc *desc,
 			    const struct dect_msg_common *msg,
 			    enum dect_pds pd, uint8_t type);
 
 extern ssize_t dect_lce_broadcast(const struct dect_handle *dh,
-				  const struct dect_msg_buf *mb,
+				  struct dect_msg_buf *mb,
 				  bool long_page, bool fast_page);
+extern void dect_lce_bcast_complete(const struct dect_handle *dh);
 
 /**
  * struct dect_nwk_protocol - NWK layer protocol
@@ -139,7 +231,8 @@ extern void dect_lce_register_protocol(const struct dect_nwk_protocol *protocol)
 /**
  * struct dect_lte - Location Table Entry
  *
- * @list:			Location table list node
+ * @hnode:			Location table IPUI hash node
+ * @tpui_hnode:			Location table TPUI hash node
  * @ipui:			International Portable User ID
  * @tpui:			Assigned Temporary Portable User ID
  * @tpui_valid:			TPUI is valid
@@ -147,7 +240,8 @@ extern void dect_lce_register_protocol(const struct dect_nwk_protocol *protocol)
  * @terminal_capability:	PT's terminal capabilities
  */
 struct dect_lte {
-	struct list_head			list;
+	struct hlist_node			hnode;
+	struct hlist_node			tpui_hnode;
 	struct dect_ipui			ipui;
 	struct dect_tpui			tpui;
 	bool					tpui_valid;
@@ -155,11 +249,18 @@ struct dect_lte {
 	struct dect_ie_terminal_capability	*terminal_capability;
 };
 
+#define DECT_LTE_HASH_SIZE		256
+
+extern struct dect_lte *dect_lte_get_by_ipui(const struct dect_handle *dh,
+					     const struct dect_ipui *ipui);
+extern struct dect_lte *dect_lte_get_by_tpui(const struct dect_handle *dh,
+					     const struct dect_tpui *tpui);
+
 extern void dect_lte_update(struct dect_handle *dh, const struct dect_ipui *ipui,
 			    struct dect_ie_setup_capability *setup_capability,
 			    struct dect_ie_terminal_capability *terminal_capability);
 
-extern void dect_lte_update_tpui(const struct dect_handle *dh,
+extern void dect_lte_update_tpui(struct dect_handle *dh,
 				 const struct dect_ipui *ipui,
 				 const struct dect_tpui *tpui);
 
@@ -177,12 +278,17 @@ enum dect_data_link_states {
 
 enum dect_data_link_flags {
 	DECT_DATA_LINK_IPUI_VALID	= 0x1,
+	DECT_DATA_LINK_BUSY		= 0x2,
+	DECT_DATA_LINK_DESTROYED	= 0x4,
+	DECT_DATA_LINK_TX_BLOCKED	= 0x8,
 };
 
 /**
  * struct dect_data_link
  *
  * @list:		DECT handle link list node
+ * @hnode:		DECT handle link IPUI hash node
+ * @page_hnode:		DECT handle pending indirect establishment hash node
  * @dlei:		Data Link Endpoint identifier
  * @ipui:		International Portable User ID
  * @dfd:		Associated socket file descriptor
@@ -192,10 +298,16 @@ enum dect_data_link_flags {
  * @release_timer:	Normal link release timer (LCE.01)
  * @page_timer:		Indirect establish timer (LCE.03)
  * @page_count:		Number of page messages sent
- * @msg_queue:		Message queue used during ESTABLISH_PENDING state
+ * @msg_queue:		Message queue used during ESTABLISH_PENDING state and
+ *			while waiting for the socket to become writable
+ * @transactions:	List of active transactions in shutdown order
+ * @tv_map:		Bitmap of transaction values in use per PD and role
+ * @ta_table:		Active transactions indexed by PD, role and TV
  */
 struct dect_data_link {
 	struct list_head		list;
+	struct hlist_node		hnode;
+	struct hlist_node		page_hnode;
 	struct sockaddr_dect_ssap	dlei;
 	struct dect_ipui		ipui;
 	struct dect_fd			*dfd;
@@ -207,19 +319,26 @@ struct dect_data_link {
 	struct dect_timer		*page_timer;
 	uint8_t				page_count;
 	uint8_t				flags;
-	struct dect_msg_buf		*msg_queue;
+	struct dect_mbuf_queue		msg_queue;
 	struct list_head		transactions;
+	uint8_t				tv_map[DECT_PD_MAX + 1][DECT_TRANSACTION_MAX + 1];
+	struct dect_transaction		*ta_table[DECT_PD_MAX + 1][DECT_TRANSACTION_MAX + 1][DECT_TV_MAX];
 };
 
+#define DECT_DDL_HASH_SIZE		64
+#define DECT_DDL_MSG_QUEUE_MAX		32
+
 #define DECT_DDL_RELEASE_TIMEOUT	5	/* LCE.01: 5 seconds */
 #define DECT_DDL_LINK_MAINTAIN_TIMEOUT	5	/* LCE.02: 5 seconds */
 #define DECT_DDL_PAGE_TIMEOUT		5	/* LCE.03: 5 seconds */
 #define DECT_DDL_ESTABLISH_SDU_TIMEOUT	5	/* LCE.05: 5 seconds */
 #define DECT_DDL_PAGE_RETRANS_MAX	3	/* N.300 */
 
-extern int dect_ddl_set_cipher_key(const struct dect_data_link *ddl,
+extern int dect_ddl_set_cipher_key(const struct dect_handle *dh,
+				   const struct dect_data_link *ddl,
 				   const uint8_t ck[]);
-extern int dect_ddl_encrypt_req(const struct dect_data_link *ddl,
+extern int dect_ddl_encrypt_req(const struct dect_handle *dh,
+				const struct dect_data_link *ddl,
 				enum dect_cipher_states status);
 
 /* LCE message types */
@@ -6,6 +6,7 @@
 #include <debug.h>
 #include <list.h>
 #include <lce.h>
+#include <timer.h>
 
 enum dect_pp_identities {
 	DECT_PP_IPUI		= 0x1,
@@ -16,6 +17,9 @@ enum dect_pp_identities {
  * struct dect_handle - libdect handle
  *
  * @ops:	user ops
+ * @loop:	built-in event loop context, NULL if application event ops are used
+ * @transport:	transport ops
+ * @transport_priv: transport private data
  * @nlsock:	netlink socket
  * @nlfd:	netlink file descriptor
  * @index:	cluster index
@@ -26,14 +30,28 @@ enum dect_pp_identities {
  * @tpui:	PP's TPUI
  * @pmid:	PP's PMID
  * @flags:	PP identity validity flags
- * @ldb:	LCE location table data base
+ * @event_depth: nesting depth of the event callbacks being processed
+ * @mbuf_pool:	message buffer pool
+ * @msg_tmpl:	templates of frequently sent messages
+ * @wheel:	timer wheel, NULL if application timers are used directly
+ * @trace:	binary trace ring, NULL if tracing is disabled
+ * @capture:	packet capture state, NULL if not capturing
+ * @rxb:	receive batch shared by all sockets
+ * @ldb:	LCE location table data base, hashed by IPUI
+ * @ldb_tpui:	LCE location table data base, hashed by assigned TPUI
  * @b_sap:	B-SAP socket
+ * @bcast:	B-SAP broadcast transmit queue
  * @s_sap:	S-SAP listener socket
  * @links:	list of data links
+ * @links_ipui:	data links hashed by IPUI
+ * @links_page:	pending indirectly established data links hashed by IPUI
  * @mme_list:	MM endpoint list
  */
 struct dect_handle {
 	const struct dect_ops		*ops;
+	struct dect_loop_ctx		*loop;
+	const struct dect_transport_ops	*transport;
+	void				*transport_priv;
 
 	struct nl_sock			*nlsock;
 	struct dect_fd			*nlfd;
@@ -48,12 +66,24 @@ struct dect_handle {
 	struct dect_tpui		tpui;
 	uint32_t			pmid;
 	uint32_t			flags;
+	unsigned int			event_depth;
 
-	struct list_head		ldb;
+	struct dect_mbuf_pool		*mbuf_pool;
+	struct dect_sfmt_msg_tmpl	*msg_tmpl;
+	struct dect_timer_wheel		*wheel;
+	struct dect_trace_ring		*trace;
+	struct dect_capture		*capture;
+	struct dect_rx_batch		*rxb;
+
+	struct hlist_head		ldb[DECT_LTE_HASH_SIZE];
+	struct hlist_head		ldb_tpui[DECT_LTE_HASH_SIZE];
 
 	struct dect_fd			*b_sap;
+	struct dect_bcast_queue		*bcast;
 	struct dect_fd			*s_sap;
 	struct list_head		links;
+	struct hlist_head		links_ipui[DECT_DDL_HASH_SIZE];
+	struct hlist_head		links_page[DECT_DDL_HASH_SIZE];
 
 	struct list_head		mme_list;
 
@@ -0,0 +1,70 @@
+/*
+ * libdect built-in event loop
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ */
+
+#ifndef _LIBDECT_LOOP_H
+#define _LIBDECT_LOOP_H
+
+#include <stdbool.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <list.h>
+
+struct dect_handle;
+
+#define DECT_LOOP_EVENTS	32
+
+/**
+ * struct dect_loop - built-in event loop state
+ *
+ * @users:		number of handles using the loop
+ * @epfd:		epoll file descriptor
+ * @tfd:		timerfd armed to the earliest timer expiry
+ * @sfd:		signalfd for SIGINT and SIGTERM, -1 unless enabled through
+ *			dect_loop_handle_signals()
+ * @sigmask:		signal mask to restore on exit
+ * @stop:		loop termination request
+ * @timers:		running timers sorted by expiry
+ * @ready:		edge-triggered file descriptors with pending input
+ * @current:		file descriptor whose callback is being invoked
+ * @nevents:		number of events returned by epoll_wait()
+ * @cur:		index of the event being processed
+ * @events:		events returned by epoll_wait()
+ *
+ * The loop is shared by all handles of a process using the built-in event
+ * ops.
+ */
+struct dect_loop {
+	unsigned int		users;
+	int			epfd;
+	int			tfd;
+	int			sfd;
+	sigset_t		sigmask;
+	bool			stop;
+	struct list_head	timers;
+	struct list_head	ready;
+	struct dect_fd		*current;
+	unsigned int		nevents;
+	unsigned int		cur;
+	struct epoll_event	events[DECT_LOOP_EVENTS];
+};
+
+/**
+ * struct dect_loop_ctx - per handle event loop context
+ *
+ * @loop:		event loop
+ * @dh:			libdect DECT handle
+ * @edge_triggered:	register draining file descriptors edge-triggered
+ */
+struct dect_loop_ctx {
+	struct dect_loop	*loop;
+	struct dect_handle	*dh;
+	bool			edge_triggered;
+};
+
+extern int dect_loop_init(struct dect_handle *dh);
+extern void dect_loop_exit(struct dect_handle *dh);
+
+#endif /* _LIBDECT_LOOP_H */
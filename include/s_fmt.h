@@ -7,6 +7,7 @@
 #ifndef _LIBDECT_S_FMT_H
 #define _LIBDECT_S_FMT_H
 
+#include <sys/uio.h>
 #include <dect/ie.h>
 #include <dect/s_fmt.h>
 
@@ -60,6 +61,11 @@ enum dect_pds {
 #define DECT_SFMT_IE_FIXED_ID_MASK		0x70
 #define DECT_SFMT_IE_FIXED_VAL_MASK		0x0f
 
+/* Maximum size of a variable length IE: identifier, length and contents */
+#define DECT_SFMT_IE_MAX_SIZE			(2 + 255)
+/* Maximum size of the fixed part of IEs carrying a payload */
+#define DECT_SFMT_IE_PREFIX_MAX_SIZE		5
+
 #define DECT_OCTET_GROUP_END			0x80
 
 /* Repeat indicator */
@@ -111,7 +117,7 @@ enum dect_pds {
 
 /* Fixed identity IE */
 
-#define DECT_IE_FIXED_IDENTITY_MIN_SIZE		2
+#define DECT_IE_FIXED_IDENTITY_MIN_SIZE		4
 
 #define DECT_IE_FIXED_IDENTITY_TYPE_MASK	0x7f
 #define DECT_IE_FIXED_IDENTITY_LENGTH_MASK	0x7f
@@ -145,7 +151,7 @@ enum dect_pds {
 
 /* Portable identity IE */
 
-#define DECT_IE_PORTABLE_IDENTITY_MIN_SIZE		2
+#define DECT_IE_PORTABLE_IDENTITY_MIN_SIZE		4
 
 /* IPUI */
 
@@ -178,6 +184,9 @@ enum dect_pds {
 
 /* Terminal capability IE */
 
+/* Octet groups 3 to 6 span at most 22 octets including the IE header */
+#define DECT_IE_TERMINAL_CAPABILITY_MAX_SIZE	24
+
 #define DECT_TERMINAL_CAPABILITY_DISPLAY_MASK	0x0f
 
 #define DECT_TERMINAL_CAPABILITY_TONE_MASK	0x70
@@ -264,18 +273,65 @@ struct dect_sfmt_ie_desc {
 	.flags	= DECT_SFMT_IE_END,			\
 }
 
+#define DECT_SFMT_MSG_MAX_IES		64
+#define DECT_SFMT_IE_INDEX_NONE		0xff
+
+/**
+ * struct dect_sfmt_msg_tbl - compiled S-Format message description
+ *
+ * @slot:	index of the first IE description matching an IE identifier
+ * @next:	index of the next IE description matching the same identifier
+ * @offset:	offset of the IE storage of an IE description
+ * @size:	size of the IE storage of the message
+ * @arena_size:	worst case IE arena size
+ * @lists:	bitmask of IE descriptions of IE lists
+ * @mode:	per mode (FP/PP) bitmasks of mandatory and optional IEs
+ */
+struct dect_sfmt_msg_tbl {
+	uint8_t				slot[256];
+	uint8_t				next[DECT_SFMT_MSG_MAX_IES];
+	uint16_t			offset[DECT_SFMT_MSG_MAX_IES];
+	uint16_t			size;
+	unsigned int			arena_size;
+	uint64_t			lists;
+	struct {
+		uint64_t		mandatory;
+		uint64_t		optional;
+	}				mode[2];
+};
+
 struct dect_sfmt_msg_desc {
 	const char			*name;
+	struct dect_sfmt_msg_tbl	*tbl;
 	struct dect_sfmt_ie_desc	ie[];
 };
 
-#define DECT_SFMT_MSG_DESC(_name, _init...)			\
-	const struct dect_sfmt_msg_desc _name ## _msg_desc = {	\
-		.name	= # _name,				\
-		.ie	= {					\
-			_init,					\
-		},						\
-	}
+extern size_t dect_sfmt_ie_size(uint8_t type);
+
+/*
+ * References to all message descriptions are collected in the
+ * dect_sfmt_msg_descs section, the descriptions are compiled into their
+ * lookup tables when the library is loaded.
+ */
+extern const struct dect_sfmt_msg_desc * const __start_dect_sfmt_msg_descs[];
+extern const struct dect_sfmt_msg_desc * const __stop_dect_sfmt_msg_descs[];
+
+#define dect_foreach_sfmt_msg_desc(ref, mdesc)				\
+	for (ref = __start_dect_sfmt_msg_descs;				\
+	     ref < __stop_dect_sfmt_msg_descs && (mdesc = *ref, true);	\
+	     ref++)
+
+#define DECT_SFMT_MSG_DESC(_name, _init...)				\
+	static struct dect_sfmt_msg_tbl _name ## _msg_tbl;		\
+	static const struct dect_sfmt_msg_desc _name ## _msg_desc = {	\
+		.name	= # _name,					\
+		.tbl	= &_name ## _msg_tbl,				\
+		.ie	= {						\
+			_init,						\
+		},							\
+	};								\
+	static const struct dect_sfmt_msg_desc * const _name ## _msg_desc_ref \
+		__used __section("dect_sfmt_msg_descs") = &_name ## _msg_desc
 
 static inline enum dect_reject_reasons dect_sfmt_reject_reason(enum dect_sfmt_error err)
 {
@@ -292,12 +348,40 @@ static inline enum dect_reject_reasons dect_sfmt_reject_reason(enum dect_sfmt_er
 /**
  * struct dect_msg_common - Common dummy msg structure to avoid casts
  *
+ * @arena:	IE arena of a received message
  * @ie:		First IE
  */
 struct dect_msg_common {
+	struct dect_ie_arena		*arena;
 	struct dect_ie_common		*ie[0];
 };
 
+/**
+ * struct dect_ie_arena - per-message IE arena
+ *
+ * @refcnt:	reference count: owner and IEs allocated from the arena
+ * @size:	size of the data area
+ * @used:	amount of data area in use
+ * @data:	data area
+ */
+struct dect_ie_arena {
+	unsigned int			refcnt;
+	unsigned int			size;
+	unsigned int			used;
+	uint8_t				data[] __aligned(__alignof__(uint64_t));
+};
+
+#define DECT_IE_ARENA_ALIGN(size) \
+	(((size) + __alignof__(uint64_t) - 1) & ~(__alignof__(uint64_t) - 1))
+
+extern struct dect_ie_arena *dect_ie_arena_alloc(const struct dect_handle *dh,
+						 unsigned int size);
+extern struct dect_ie_common *dect_ie_arena_ie_alloc(const struct dect_handle *dh,
+						     struct dect_ie_arena *arena,
+						     size_t size);
+extern void dect_ie_arena_put(const struct dect_handle *dh,
+			      struct dect_ie_arena *arena);
+
 struct dect_msg_buf;
 extern enum dect_sfmt_error dect_parse_sfmt_msg(const struct dect_handle *dh,
 						const struct dect_sfmt_msg_desc *desc,
@@ -312,4 +396,109 @@ extern void dect_msg_free(const struct dect_handle *dh,
 			  const struct dect_sfmt_msg_desc *desc,
 			  struct dect_msg_common *msg);
 
+#define DECT_SFMT_IOV_MAX			8
+#define DECT_SFMT_IOV_MIN_LEN			32
+
+/**
+ * struct dect_sfmt_iov - S-Format message as scatter/gather list
+ *
+ * @mb:		message buffer holding the data not referenced directly
+ * @off:	offset of the first message buffer byte not yet in @iov
+ * @cnt:	number of segments
+ * @len:	total message length
+ * @iov:	segments
+ *
+ * Payloads of at least %DECT_SFMT_IOV_MIN_LEN bytes are referenced directly,
+ * everything else is encoded into the message buffer.
+ */
+struct dect_sfmt_iov {
+	struct dect_msg_buf		*mb;
+	unsigned int			off;
+	unsigned int			cnt;
+	unsigned int			len;
+	struct iovec			iov[DECT_SFMT_IOV_MAX];
+};
+
+extern void dect_sfmt_iov_init(struct dect_sfmt_iov *iov, struct dect_msg_buf *mb);
+extern enum dect_sfmt_error dect_build_sfmt_msg_iov(const struct dect_handle *dh,
+						    const struct dect_sfmt_msg_desc *desc,
+						    const struct dect_msg_common *src,
+						    struct dect_sfmt_iov *iov);
+
+#define DECT_SFMT_MSG_TMPL_MAX_IES		8
+#define DECT_SFMT_MSG_TMPL_SIZE			128
+
+/**
+ * struct dect_sfmt_msg_tmpl - pre-serialised S-Format message
+ *
+ * @mdesc:	message description of the serialised message
+ * @present:	bitmask of IE descriptions present in the serialised message
+ * @len:	length of the serialised message
+ * @num:	number of IEs in the serialised message
+ * @ie:		description index, offset and length of each serialised IE and
+ *		a copy of the IE it was built from
+ * @data:	serialised message
+ *
+ * A template caches the encoding of a message containing a given set of
+ * IEs. Messages containing the same set of IEs are constructed by copying
+ * the template and re-encoding only the IEs that differ from the ones the
+ * template was built from.
+ */
+struct dect_sfmt_msg_tmpl {
+	const struct dect_sfmt_msg_desc	*mdesc;
+	uint64_t			present;
+	uint8_t				len;
+	uint8_t				num;
+	struct {
+		uint8_t			index;
+		uint8_t			offset;
+		uint8_t			len;
+		struct dect_ie_common	*ie;
+	}				ie[DECT_SFMT_MSG_TMPL_MAX_IES];
+	uint8_t				data[DECT_SFMT_MSG_TMPL_SIZE];
+};
+
+extern enum dect_sfmt_error dect_build_sfmt_msg_tmpl(const struct dect_handle *dh,
+						     struct dect_sfmt_msg_tmpl *tmpl,
+						     const struct dect_sfmt_msg_desc *desc,
+						     const struct dect_msg_common *src,
+						     struct dect_msg_buf *mb);
+extern void dect_sfmt_msg_tmpl_flush(const struct dect_handle *dh,
+				     struct dect_sfmt_msg_tmpl *tmpl);
+
+/**
+ * struct dect_msg_view - zero-copy view of a received message
+ *
+ * @mdesc:	message description
+ * @data:	message data
+ * @len:	message length
+ * @present:	bitmask of IE descriptions present in the message
+ * @offset:	offset of the IE of each present IE description
+ */
+struct dect_msg_view {
+	const struct dect_sfmt_msg_desc	*mdesc;
+	uint8_t				*data;
+	uint16_t			len;
+	uint64_t			present;
+	uint16_t			offset[DECT_SFMT_MSG_MAX_IES];
+};
+
+extern enum dect_sfmt_error dect_msg_view_init(const struct dect_handle *dh,
+					       struct dect_msg_view *view,
+					       const struct dect_sfmt_msg_desc *mdesc,
+					       const struct dect_msg_buf *mb);
+extern int dect_msg_view_find(const struct dect_msg_view *view, uint8_t type,
+			      struct dect_sfmt_ie *ie);
+extern enum dect_sfmt_error __dect_msg_view_get(const struct dect_handle *dh,
+						const struct dect_msg_view *view,
+						uint8_t type,
+						struct dect_ie_common *dst,
+						size_t size);
+extern struct dect_ie_common *dect_msg_view_copy(const struct dect_handle *dh,
+						 const struct dect_msg_view *view,
+						 uint8_t type);
+
+#define dect_msg_view_get(dh, view, type, ie) \
+	__dect_msg_view_get(dh, view, type, &(ie)->common, sizeof(*(ie)))
+
 #endif /* _LIBDECT_S_FMT_H */
@@ -8,6 +8,7 @@
 #define _LIBDECT_TIMER_H
 
 #include <utils.h>
+#include <list.h>
 #include <dect/timer.h>
 
 struct dect_handle;
@@ -20,12 +21,16 @@ enum dect_timer_state {
 /**
  * struct dect_timer - libdect timer
  *
+ * @list:		timer wheel slot list node
+ * @expires:		timer wheel expiry tick
  * @callback:		callback to invoke on timer expiry
  * @data:		libdect internal data
  * @state:		libdect internal state
  * @priv:		libdect user private timer storage
  */
 struct dect_timer {
+	struct list_head	list;
+	uint32_t		expires;
 	void			(*callback)(struct dect_handle *,
 					    struct dect_timer *);
 	void			*data;
@@ -33,4 +38,24 @@ struct dect_timer {
 	uint8_t			priv[] __aligned(__alignof__(uint64_t));
 };
 
+#define DECT_TIMER_WHEEL_SIZE	64
+
+/**
+ * struct dect_timer_wheel - hashed timer wheel with second granularity
+ *
+ * @tick:		application timer driving the wheel
+ * @now:		current tick
+ * @pending:		number of timers on the wheel
+ * @slots:		timers hashed by expiry tick
+ */
+struct dect_timer_wheel {
+	struct dect_timer	*tick;
+	uint32_t		now;
+	unsigned int		pending;
+	struct list_head	slots[DECT_TIMER_WHEEL_SIZE];
+};
+
+extern int dect_timer_wheel_init(struct dect_handle *dh);
+extern void dect_timer_wheel_exit(struct dect_handle *dh);
+
 #endif /* _LIBDECT_TIMER_H */
@@ -0,0 +1,47 @@
+/*
+ * libdect binary trace ring
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ */
+
+#ifndef _LIBDECT_TRACE_H
+#define _LIBDECT_TRACE_H
+
+#include <utils.h>
+#include <dect/trace.h>
+
+struct dect_handle;
+struct dect_data_link;
+struct dect_transaction;
+
+extern int dect_trace_init(struct dect_handle *dh);
+extern void dect_trace_exit(struct dect_handle *dh);
+
+extern void __dect_trace(const struct dect_handle *dh,
+			 enum dect_trace_events event,
+			 const struct dect_data_link *ddl,
+			 const struct dect_transaction *ta,
+			 uint32_t arg0, uint32_t arg1,
+			 uint32_t arg2, uint32_t arg3,
+			 const void *data, unsigned int len);
+
+/*
+ * Trace an event, the arguments are only evaluated if tracing is enabled.
+ * If @ddl is NULL, the data link of the transaction @ta is used.
+ */
+#define dect_trace(dh, event, ddl, ta, arg0, arg1, arg2, arg3)		\
+	({								\
+		if (__builtin_expect((dh)->trace != NULL, 0))		\
+			__dect_trace(dh, event, ddl, ta, arg0, arg1,	\
+				     arg2, arg3, NULL, 0);		\
+	})
+
+/* Trace an event including the start of a message */
+#define dect_trace_msg(dh, event, ddl, ta, arg0, arg1, data, len)	\
+	({								\
+		if (__builtin_expect((dh)->trace != NULL, 0))		\
+			__dect_trace(dh, event, ddl, ta, arg0, arg1,	\
+				     0, 0, data, len);			\
+	})
+
+#endif /* _LIBDECT_TRACE_H */
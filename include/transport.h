@@ -0,0 +1,73 @@
+/*
+ * libdect transport layer
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ */
+
+#ifndef _LIBDECT_TRANSPORT_H
+#define _LIBDECT_TRANSPORT_H
+
+#include <sys/socket.h>
+#include <io.h>
+
+struct dect_handle;
+
+/**
+ * struct dect_transport_ops - DECT transport operations
+ *
+ * @init:		bind the handle to a cluster and query its parameters
+ * @exit:		unbind the handle from the cluster
+ * @socket:		create a non-blocking socket of the given type and SAP
+ * @bind:		bind a socket to a DECT address
+ * @connect:		connect a socket to a DECT address
+ * @listen:		listen for connections on a socket
+ * @accept:		accept a connection and return the peer's DECT address
+ * @getsockopt:		get a socket option
+ * @setsockopt:		set a socket option
+ * @sendmmsg:		transmit multiple messages, returns the number of
+ *			messages transmitted
+ *
+ * Data is received from and transmitted to the sockets returned by
+ * socket() and accept() using the regular socket functions, only
+ * operations involving DECT addressing or multiple messages go through
+ * the transport.
+ */
+struct dect_transport_ops {
+	int	(*init)(struct dect_handle *dh, const char *cluster);
+	void	(*exit)(struct dect_handle *dh);
+
+	int	(*socket)(const struct dect_handle *dh, int type, int protocol);
+	int	(*bind)(const struct dect_handle *dh, struct dect_fd *dfd,
+			const struct sockaddr *addr, socklen_t len);
+	int	(*connect)(const struct dect_handle *dh, struct dect_fd *dfd,
+			   const struct sockaddr *addr, socklen_t len);
+	int	(*listen)(const struct dect_handle *dh, struct dect_fd *dfd,
+			  int backlog);
+	int	(*accept)(const struct dect_handle *dh,
+			  const struct dect_fd *dfd,
+			  struct sockaddr *addr, socklen_t *len);
+	int	(*getsockopt)(const struct dect_handle *dh,
+			      const struct dect_fd *dfd, int level,
+			      int optname, void *optval, socklen_t *optlen);
+	int	(*setsockopt)(const struct dect_handle *dh,
+			      const struct dect_fd *dfd, int level,
+			      int optname, const void *optval,
+			      socklen_t optlen);
+	int	(*sendmmsg)(const struct dect_handle *dh,
+			    const struct dect_fd *dfd,
+			    struct mmsghdr *msg, unsigned int vlen);
+};
+
+extern const struct dect_transport_ops dect_kernel_transport;
+extern const struct dect_transport_ops dect_sim_fp_transport;
+extern const struct dect_transport_ops dect_sim_pp_transport;
+
+extern int dect_kernel_sendmmsg(const struct dect_handle *dh,
+				const struct dect_fd *dfd,
+				struct mmsghdr *msg, unsigned int vlen);
+
+extern struct dect_handle *__dect_open_handle(struct dect_ops *ops,
+					      const struct dect_transport_ops *transport,
+					      void *priv, const char *cluster);
+
+#endif /* _LIBDECT_TRANSPORT_H */
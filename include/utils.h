@@ -4,6 +4,7 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifndef AF_DECT
 #define AF_DECT 40
@@ -23,6 +24,11 @@
 #define __aligned(x)		__attribute__((aligned(x)))
 #define __packed		__attribute__((packed))
 #define __visible		__attribute__((visibility("default")))
+#define __used			__attribute__((used))
+#define __section(s)		__attribute__((section(s)))
+#ifndef __always_inline
+#define __always_inline		inline __attribute__((always_inline))
+#endif
 
 struct dect_handle;
 extern void *dect_malloc(const struct dect_handle *dh, size_t size);
@@ -88,4 +94,58 @@ static inline unsigned int fls(uint64_t v)
 		elem;					\
 	})
 
+/*
+ * Pointer queues: singly linked FIFO queues with constant time insertion
+ * at the tail and an optional length limit. Elements are linked through
+ * their next member.
+ */
+#define PTRQUEUE_HEAD(name, type)			\
+	struct name {					\
+		type		*head;			\
+		type		**tail;			\
+		unsigned int	len;			\
+		unsigned int	limit;			\
+		unsigned int	drops;			\
+	}
+
+#define ptrqueue_init(queue, max)			\
+	do {						\
+		(queue)->head  = NULL;			\
+		(queue)->tail  = &(queue)->head;	\
+		(queue)->len   = 0;			\
+		(queue)->limit = (max);			\
+		(queue)->drops = 0;			\
+	} while (0)
+
+#define ptrqueue_empty(queue)	((queue)->head == NULL)
+#define ptrqueue_peek(queue)	((queue)->head)
+
+/* Returns false and accounts a drop if the queue limit is exceeded */
+#define ptrqueue_enqueue(queue, elem)			\
+	({						\
+		typeof((queue)->head) _elem = (elem);	\
+		bool _ok = (queue)->limit == 0 ||	\
+			   (queue)->len < (queue)->limit;	\
+		if (_ok) {				\
+			_elem->next = NULL;		\
+			*(queue)->tail = _elem;		\
+			(queue)->tail = &_elem->next;	\
+			(queue)->len++;			\
+		} else					\
+			(queue)->drops++;		\
+		_ok;					\
+	})
+
+#define ptrqueue_dequeue(queue)				\
+	({						\
+		typeof((queue)->head) _elem = (queue)->head;	\
+		if (_elem != NULL) {			\
+			(queue)->head = _elem->next;	\
+			if ((queue)->head == NULL)	\
+				(queue)->tail = &(queue)->head;	\
+			(queue)->len--;			\
+		}					\
+		_elem;					\
+	})
+
 #endif /* _LIBDECT_UTILS_H */
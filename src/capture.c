@@ -0,0 +1,503 @@
+/*
+ * libdect pcapng packet capture
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup capture Packet capture
+ * @{
+ *
+ * libdect can capture the messages passed over the S-SAP, B-SAP and LU1-SAP
+ * sockets and raw MAC frames in pcapng format. Each packet is prefixed by a
+ * struct dect_capture_hdr carrying the direction, data link identity and the
+ * slot, frame and multiframe number of raw frames, the pcapng link type is
+ * #DECT_CAPTURE_LINKTYPE.
+ *
+ * Packets are timestamped when they are passed to or received from the
+ * kernel and appended to a buffer, which is written to the capture file
+ * descriptor from the event loop without blocking. Regular files can't be
+ * waited on for writability, the data is written to them once the current
+ * event has been processed. In both cases, data is written right away once
+ * the buffer is half full. Packets are dropped
+ * if the buffer is full, the number of dropped packets is recorded in the
+ * interface statistics written when stopping the capture.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <asm/byteorder.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <io.h>
+#include <capture.h>
+
+#define capture_debug(fmt, args...) \
+	dect_debug(DECT_DEBUG_UNKNOWN, "capture: " fmt "\n", ## args)
+
+#define DECT_CAPTURE_BUF_SIZE		(128 * 1024)
+#define DECT_CAPTURE_SNAPLEN		65535
+
+/*
+ * pcapng blocks
+ */
+#define PCAPNG_BLOCK_SHB		0x0a0d0d0a
+#define PCAPNG_BLOCK_IDB		0x00000001
+#define PCAPNG_BLOCK_ISB		0x00000005
+#define PCAPNG_BLOCK_EPB		0x00000006
+
+#define PCAPNG_BYTE_ORDER_MAGIC		0x1a2b3c4d
+
+#define PCAPNG_OPT_ENDOFOPT		0
+#define PCAPNG_OPT_IF_NAME		2
+#define PCAPNG_OPT_IF_TSRESOL		9
+#define PCAPNG_OPT_EPB_FLAGS		2
+#define PCAPNG_OPT_ISB_IFRECV		4
+#define PCAPNG_OPT_ISB_IFDROP		5
+
+#define PCAPNG_EPB_FLAGS_INBOUND	0x1
+#define PCAPNG_EPB_FLAGS_OUTBOUND	0x2
+
+#define PCAPNG_ALIGN(len)		(((len) + 3) & ~3U)
+#define PCAPNG_OPT_SIZE(len)		(4 + PCAPNG_ALIGN(len))
+
+struct pcapng_block {
+	uint32_t	type;
+	uint32_t	len;
+};
+
+struct pcapng_shb {
+	struct pcapng_block	block;
+	uint32_t		magic;
+	uint16_t		major;
+	uint16_t		minor;
+	int64_t			section_len;
+};
+
+struct pcapng_idb {
+	struct pcapng_block	block;
+	uint16_t		linktype;
+	uint16_t		reserved;
+	uint32_t		snaplen;
+};
+
+struct pcapng_epb {
+	struct pcapng_block	block;
+	uint32_t		interface;
+	uint32_t		ts_high;
+	uint32_t		ts_low;
+	uint32_t		caplen;
+	uint32_t		len;
+};
+
+struct pcapng_isb {
+	struct pcapng_block	block;
+	uint32_t		interface;
+	uint32_t		ts_high;
+	uint32_t		ts_low;
+};
+
+static const char dect_capture_if_name[] = "libdect";
+
+/**
+ * struct dect_capture - packet capture state
+ *
+ * @dfd:	capture file descriptor
+ * @fd_flags:	original file status flags of the capture file descriptor
+ * @direct:	write pending data after processing the current event, the
+ *		capture file descriptor can't be registered with the event
+ *		handler
+ * @packets:	number of packets captured
+ * @drops:	number of packets dropped
+ * @off:	offset of the pending data in @buf
+ * @len:	amount of pending data in @buf
+ * @buf:	write buffer
+ */
+struct dect_capture {
+	struct dect_fd		*dfd;
+	int			fd_flags;
+	bool			direct;
+	uint64_t		packets;
+	uint64_t		drops;
+	unsigned int		off;
+	unsigned int		len;
+	uint8_t			buf[DECT_CAPTURE_BUF_SIZE];
+};
+
+/* The buffer may be misaligned after partial writes, so data is copied in */
+static void dect_capture_add(struct dect_capture *cap, const void *data,
+			     unsigned int len)
+{
+	memcpy(cap->buf + cap->off + cap->len, data, len);
+	cap->len += len;
+}
+
+static void dect_capture_pad(struct dect_capture *cap, unsigned int len)
+{
+	static const uint8_t pad[3];
+
+	dect_capture_add(cap, pad, PCAPNG_ALIGN(len) - len);
+}
+
+static void dect_capture_add_opt(struct dect_capture *cap, uint16_t code,
+				 const void *data, uint16_t len)
+{
+	dect_capture_add(cap, &code, sizeof(code));
+	dect_capture_add(cap, &len, sizeof(len));
+	dect_capture_add(cap, data, len);
+	dect_capture_pad(cap, len);
+}
+
+static void dect_capture_add_trailer(struct dect_capture *cap, uint32_t len)
+{
+	static const uint16_t endofopt[2] = { PCAPNG_OPT_ENDOFOPT, 0 };
+
+	dect_capture_add(cap, endofopt, sizeof(endofopt));
+	dect_capture_add(cap, &len, sizeof(len));
+}
+
+static void dect_capture_timestamp(uint32_t *high, uint32_t *low)
+{
+	struct timespec ts;
+	uint64_t t;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	t = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	*high = t >> 32;
+	*low  = t;
+}
+
+/*
+ * Write the pending data without blocking. Returns -1 if the capture file
+ * descriptor is not writable anymore, in which case the data is discarded.
+ */
+static int dect_capture_write(struct dect_capture *cap)
+{
+	ssize_t len;
+
+	while (cap->len > 0) {
+		len = write(cap->dfd->fd, cap->buf + cap->off, cap->len);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return 0;
+			capture_debug("write: %s", strerror(errno));
+			cap->len = 0;
+			return -1;
+		}
+		cap->off += len;
+		cap->len -= len;
+	}
+	cap->off = 0;
+	return 0;
+}
+
+/*
+ * Wait for the capture file descriptor to become writable. If it can't be
+ * registered with the event handler, pending data is written after each
+ * event from now on.
+ */
+static void dect_capture_wait(const struct dect_handle *dh,
+			      struct dect_capture *cap)
+{
+	if (cap->dfd->state == DECT_FD_REGISTERED)
+		return;
+	if (dect_fd_register(dh, cap->dfd, DECT_FD_WRITE) == 0)
+		return;
+
+	capture_debug("register: %s", strerror(errno));
+	cap->direct = true;
+	dect_capture_write(cap);
+}
+
+/* Write pending data and wait for writability if the write was incomplete */
+static void dect_capture_flush(const struct dect_handle *dh,
+			       struct dect_capture *cap)
+{
+	dect_capture_write(cap);
+	if (cap->direct)
+		return;
+
+	if (cap->len > 0)
+		dect_capture_wait(dh, cap);
+	else if (cap->dfd->state == DECT_FD_REGISTERED)
+		dect_fd_unregister(dh, cap->dfd);
+}
+
+static void dect_capture_event(struct dect_handle *dh, struct dect_fd *dfd,
+			       uint32_t events)
+{
+	dect_capture_flush(dh, dfd->data);
+}
+
+/*
+ * Make room for @len bytes. Space is reclaimed by writing pending data,
+ * if that isn't possible without blocking the packet is dropped.
+ */
+static int dect_capture_reserve(const struct dect_handle *dh,
+				struct dect_capture *cap, unsigned int len)
+{
+	if (cap->off + cap->len + len <= sizeof(cap->buf))
+		return 0;
+
+	dect_capture_flush(dh, cap);
+	if (cap->off > 0) {
+		memmove(cap->buf, cap->buf + cap->off, cap->len);
+		cap->off = 0;
+	}
+	return cap->len + len <= sizeof(cap->buf) ? 0 : -1;
+}
+
+/*
+ * Pending data is written once the current event has been processed,
+ * batching all packets captured while processing it, or immediately once
+ * the buffer is half full. Packets captured outside of event processing
+ * are written immediately when writing directly.
+ */
+static void dect_capture_schedule(const struct dect_handle *dh,
+				  struct dect_capture *cap)
+{
+	if (cap->len >= sizeof(cap->buf) / 2)
+		dect_capture_flush(dh, cap);
+	else if (!cap->direct)
+		dect_capture_wait(dh, cap);
+	else if (dh->event_depth == 0)
+		dect_capture_write(cap);
+}
+
+/**
+ * dect_capture_complete - write the packets captured while processing an event
+ *
+ * @dh:		libdect DECT handle
+ *
+ * Packets are only written here when writing directly, otherwise the event
+ * handler reports when the capture file descriptor has become writable.
+ */
+void dect_capture_complete(const struct dect_handle *dh)
+{
+	struct dect_capture *cap = dh->capture;
+
+	if (cap != NULL && cap->direct && cap->len > 0)
+		dect_capture_write(cap);
+}
+
+static void dect_capture_add_headers(struct dect_capture *cap)
+{
+	struct pcapng_shb shb = {
+		.block.type	= PCAPNG_BLOCK_SHB,
+		.block.len	= sizeof(shb) + 4,
+		.magic		= PCAPNG_BYTE_ORDER_MAGIC,
+		.major		= 1,
+		.minor		= 0,
+		.section_len	= -1,
+	};
+	struct pcapng_idb idb = {
+		.block.type	= PCAPNG_BLOCK_IDB,
+		.block.len	= sizeof(idb) +
+				  PCAPNG_OPT_SIZE(strlen(dect_capture_if_name)) +
+				  PCAPNG_OPT_SIZE(1) + PCAPNG_OPT_SIZE(0) + 4,
+		.linktype	= DECT_CAPTURE_LINKTYPE,
+		.snaplen	= DECT_CAPTURE_SNAPLEN,
+	};
+	uint8_t tsresol = 9;
+
+	dect_capture_add(cap, &shb, sizeof(shb));
+	dect_capture_add(cap, &shb.block.len, sizeof(shb.block.len));
+
+	dect_capture_add(cap, &idb, sizeof(idb));
+	dect_capture_add_opt(cap, PCAPNG_OPT_IF_NAME, dect_capture_if_name,
+			     strlen(dect_capture_if_name));
+	dect_capture_add_opt(cap, PCAPNG_OPT_IF_TSRESOL, &tsresol,
+			     sizeof(tsresol));
+	dect_capture_add_trailer(cap, idb.block.len);
+}
+
+static int dect_capture_add_stats(const struct dect_handle *dh,
+				  struct dect_capture *cap)
+{
+	struct pcapng_isb isb = {
+		.block.type	= PCAPNG_BLOCK_ISB,
+		.block.len	= sizeof(isb) + 2 * PCAPNG_OPT_SIZE(8) +
+				  PCAPNG_OPT_SIZE(0) + 4,
+	};
+
+	if (dect_capture_reserve(dh, cap, isb.block.len) < 0)
+		return -1;
+
+	dect_capture_timestamp(&isb.ts_high, &isb.ts_low);
+	dect_capture_add(cap, &isb, sizeof(isb));
+	dect_capture_add_opt(cap, PCAPNG_OPT_ISB_IFRECV, &cap->packets,
+			     sizeof(cap->packets));
+	dect_capture_add_opt(cap, PCAPNG_OPT_ISB_IFDROP, &cap->drops,
+			     sizeof(cap->drops));
+	dect_capture_add_trailer(cap, isb.block.len);
+	return 0;
+}
+
+void __dect_capture(const struct dect_handle *dh,
+		    enum dect_capture_saps sap,
+		    enum dect_capture_directions dir, uint8_t flags,
+		    const struct sockaddr_dect_ssap *dlei,
+		    const struct dect_raw_auxdata *aux,
+		    const struct iovec *iov, unsigned int iovcnt)
+{
+	struct dect_capture *cap = dh->capture;
+	struct dect_capture_hdr hdr;
+	struct pcapng_epb epb;
+	unsigned int len = 0, caplen, i, n;
+	uint32_t epb_flags;
+
+	for (i = 0; i < iovcnt; i++)
+		len += iov[i].iov_len;
+	caplen = min(len, DECT_CAPTURE_SNAPLEN - (unsigned int)sizeof(hdr));
+
+	epb.block.type = PCAPNG_BLOCK_EPB;
+	epb.block.len  = sizeof(epb) + PCAPNG_ALIGN(sizeof(hdr) + caplen) +
+			 PCAPNG_OPT_SIZE(sizeof(epb_flags)) +
+			 PCAPNG_OPT_SIZE(0) + 4;
+	if (dect_capture_reserve(dh, cap, epb.block.len) < 0) {
+		cap->drops++;
+		return;
+	}
+	cap->packets++;
+
+	epb.interface = 0;
+	epb.caplen    = sizeof(hdr) + caplen;
+	epb.len	      = sizeof(hdr) + len;
+	dect_capture_timestamp(&epb.ts_high, &epb.ts_low);
+	dect_capture_add(cap, &epb, sizeof(epb));
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.version   = DECT_CAPTURE_VERSION;
+	hdr.sap       = sap;
+	hdr.direction = dir;
+	hdr.flags     = flags;
+	if (dlei != NULL) {
+		hdr.pmid  = __cpu_to_be32(dlei->dect_pmid);
+		hdr.ari   = __cpu_to_be64(dlei->dect_ari);
+		hdr.lln   = dlei->dect_lln;
+		hdr.sapi  = dlei->dect_sapi;
+		hdr.lcn   = dlei->dect_lcn;
+	}
+	if (aux != NULL) {
+		hdr.slot  = aux->slot;
+		hdr.mfn   = __cpu_to_be32(aux->mfn);
+		hdr.frame = aux->frame;
+	}
+	dect_capture_add(cap, &hdr, sizeof(hdr));
+
+	for (i = 0, len = caplen; i < iovcnt && len > 0; i++, len -= n) {
+		n = min((unsigned int)iov[i].iov_len, len);
+		dect_capture_add(cap, iov[i].iov_base, n);
+	}
+	dect_capture_pad(cap, sizeof(hdr) + caplen);
+
+	epb_flags = dir == DECT_CAPTURE_TX ? PCAPNG_EPB_FLAGS_OUTBOUND :
+					     PCAPNG_EPB_FLAGS_INBOUND;
+	dect_capture_add_opt(cap, PCAPNG_OPT_EPB_FLAGS, &epb_flags,
+			     sizeof(epb_flags));
+	dect_capture_add_trailer(cap, epb.block.len);
+
+	dect_capture_schedule(dh, cap);
+}
+
+/**
+ * Start capturing packets
+ *
+ * @param dh	libdect DECT handle
+ * @param fd	file descriptor to write the capture to
+ *
+ * Start capturing the packets sent and received by the handle in pcapng
+ * format. The file descriptor is switched to non-blocking mode while
+ * capturing and remains owned by the caller. When capturing to a pipe,
+ * SIGPIPE should be ignored.
+ *
+ * @return 0 on success or -1 on error.
+ */
+int dect_capture_start(struct dect_handle *dh, int fd)
+{
+	struct dect_capture *cap;
+	struct stat st;
+
+	if (dh->capture != NULL) {
+		errno = EBUSY;
+		goto err1;
+	}
+
+	cap = dect_zalloc(dh, sizeof(*cap));
+	if (cap == NULL)
+		goto err1;
+
+	cap->dfd = dect_fd_alloc(dh);
+	if (cap->dfd == NULL)
+		goto err2;
+	dect_fd_setup(cap->dfd, dect_capture_event, cap);
+	cap->dfd->fd = fd;
+
+	if (fstat(fd, &st) < 0)
+		goto err3;
+	cap->direct = S_ISREG(st.st_mode);
+
+	cap->fd_flags = fcntl(fd, F_GETFL);
+	if (cap->fd_flags < 0)
+		goto err3;
+	if (fcntl(fd, F_SETFL, cap->fd_flags | O_NONBLOCK) < 0)
+		goto err3;
+
+	dect_capture_add_headers(cap);
+	dect_capture_flush(dh, cap);
+	dh->capture = cap;
+	return 0;
+
+err3:
+	dect_free(dh, cap->dfd);
+err2:
+	dect_free(dh, cap);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_capture_start);
+
+/**
+ * Stop capturing packets
+ *
+ * @param dh	libdect DECT handle
+ *
+ * Write the pending packets and the capture statistics without blocking and
+ * restore the original mode of the capture file descriptor.
+ */
+void dect_capture_stop(struct dect_handle *dh)
+{
+	struct dect_capture *cap = dh->capture;
+
+	if (cap == NULL)
+		return;
+
+	dect_capture_add_stats(dh, cap);
+	if (cap->dfd->state == DECT_FD_REGISTERED)
+		dect_fd_unregister(dh, cap->dfd);
+
+	/* Don't block on a stalled reader, whatever can't be written is lost */
+	if (dect_capture_write(cap) == 0 && cap->len > 0)
+		capture_debug("lost %u bytes", cap->len);
+	fcntl(cap->dfd->fd, F_SETFL, cap->fd_flags);
+
+	dect_free(dh, cap->dfd);
+	dect_free(dh, cap);
+	dh->capture = NULL;
+}
+EXPORT_SYMBOL(dect_capture_stop);
+
+/** @} */
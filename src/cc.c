@@ -32,8 +32,10 @@
 #include <lce.h>
 #include <cc.h>
 #include <ss.h>
+#include <trace.h>
+#include <capture.h>
 
-static DECT_SFMT_MSG_DESC(cc_setup,
+DECT_SFMT_MSG_DESC(cc_setup,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
@@ -77,7 +79,7 @@ static DECT_SFMT_MSG_DESC(cc_setup,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_info,
+DECT_SFMT_MSG_DESC(cc_info,
 	DECT_SFMT_IE(DECT_IE_LOCATION_AREA,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -106,7 +108,7 @@ static DECT_SFMT_MSG_DESC(cc_info,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_setup_ack,
+DECT_SFMT_MSG_DESC(cc_setup_ack,
 	DECT_SFMT_IE(DECT_IE_INFO_TYPE,			IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
@@ -135,7 +137,7 @@ static DECT_SFMT_MSG_DESC(cc_setup_ack,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_call_proc,
+DECT_SFMT_MSG_DESC(cc_call_proc,
 	DECT_SFMT_IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_CALL_ATTRIBUTES,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_CONNECTION_ATTRIBUTES,	IE_OPTIONAL,  IE_NONE,      0),
@@ -157,7 +159,7 @@ static DECT_SFMT_MSG_DESC(cc_call_proc,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_alerting,
+DECT_SFMT_MSG_DESC(cc_alerting,
 	DECT_SFMT_IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CALL_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CONNECTION_ATTRIBUTES,	IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -180,7 +182,7 @@ static DECT_SFMT_MSG_DESC(cc_alerting,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_connect,
+DECT_SFMT_MSG_DESC(cc_connect,
 	DECT_SFMT_IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CALL_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CONNECTION_ATTRIBUTES,	IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -206,7 +208,7 @@ static DECT_SFMT_MSG_DESC(cc_connect,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_connect_ack,
+DECT_SFMT_MSG_DESC(cc_connect_ack,
 	DECT_SFMT_IE(DECT_IE_SINGLE_DISPLAY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_FEATURE_INDICATE,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -216,7 +218,7 @@ static DECT_SFMT_MSG_DESC(cc_connect_ack,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_release,
+DECT_SFMT_MSG_DESC(cc_release,
 	DECT_SFMT_IE(DECT_IE_RELEASE_REASON,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
@@ -232,7 +234,7 @@ static DECT_SFMT_MSG_DESC(cc_release,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_release_com,
+DECT_SFMT_MSG_DESC(cc_release_com,
 	DECT_SFMT_IE(DECT_IE_RELEASE_REASON,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_IDENTITY_TYPE,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_LOCATION_AREA,		IE_OPTIONAL,  IE_NONE,      0),
@@ -251,7 +253,7 @@ static DECT_SFMT_MSG_DESC(cc_release_com,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_service_change,
+DECT_SFMT_MSG_DESC(cc_service_change,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_SERVICE_CHANGE_INFO,	IE_MANDATORY, IE_MANDATORY, 0),
@@ -267,7 +269,7 @@ static DECT_SFMT_MSG_DESC(cc_service_change,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_service_accept,
+DECT_SFMT_MSG_DESC(cc_service_accept,
 	DECT_SFMT_IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CONNECTION_IDENTITY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -277,7 +279,7 @@ static DECT_SFMT_MSG_DESC(cc_service_accept,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_service_reject,
+DECT_SFMT_MSG_DESC(cc_service_reject,
 	DECT_SFMT_IE(DECT_IE_RELEASE_REASON,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_IWU_ATTRIBUTES,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CONNECTION_ATTRIBUTES,	IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -288,13 +290,13 @@ static DECT_SFMT_MSG_DESC(cc_service_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_notify,
+DECT_SFMT_MSG_DESC(cc_notify,
 	DECT_SFMT_IE(DECT_IE_TIMER_RESTART,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(cc_iwu_info,
+DECT_SFMT_MSG_DESC(cc_iwu_info,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_MMS_GENERIC_HEADER,	IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_MMS_OBJECT_HEADER,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -320,7 +322,7 @@ static DECT_SFMT_MSG_DESC(cc_iwu_info,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(crss_hold,
+DECT_SFMT_MSG_DESC(crss_hold,
 	DECT_SFMT_IE(DECT_IE_SINGLE_DISPLAY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE_END_MSG
@@ -391,6 +393,8 @@ int dect_dl_u_data_req(const struct dect_handle *dh, struct dect_call *call,
 	if (size != ((ssize_t)mb->len))
 		cc_debug(call, "sending %u bytes failed: %s",
 			 mb->len, strerror(errno));
+	dect_capture_mbuf(dh, DECT_CAPTURE_LU1, DECT_CAPTURE_TX, 0,
+			  &call->transaction.link->dlei, NULL, mb);
 	return 0;
 }
 EXPORT_SYMBOL(dect_dl_u_data_req);
@@ -408,22 +412,27 @@ static void dect_cc_lu_event(struct dect_handle *dh, struct dect_fd *fd,
 		return;
 
 	len = recv(call->lu_sap->fd, mb->data, 40, 0);
-	if (len < 0)
+	if (len < 0) {
+		dect_mbuf_free(dh, mb);
 		return;
+	}
 	mb->len = len;
 
 	//dect_mbuf_dump(mb, "LU1");
+	dect_capture_mbuf(dh, DECT_CAPTURE_LU1, DECT_CAPTURE_RX, 0,
+			  &call->transaction.link->dlei, NULL, mb);
 	dh->ops->cc_ops->dl_u_data_ind(dh, call, mb);
 }
 
-static void dect_cc_get_queue_stats(const struct dect_call *call)
+static void dect_cc_get_queue_stats(const struct dect_handle *dh,
+				    const struct dect_call *call)
 {
 	struct dect_lu1_queue_stats qstats;
 	socklen_t optlen;
 
 	optlen = sizeof(qstats);
-	if (getsockopt(call->lu_sap->fd, SOL_DECT, DECT_LU1_QUEUE_STATS,
-		       &qstats, &optlen) < 0) {
+	if (dect_getsockopt(dh, call->lu_sap, SOL_DECT, DECT_LU1_QUEUE_STATS,
+			    &qstats, &optlen) < 0) {
 		cc_debug(call, "Failed to get queue statistics: %s", strerror(errno));
 		return;
 	}
@@ -440,7 +449,8 @@ static void dect_cc_qstats_timer(struct dect_handle *dh, struct dect_timer *time
 {
 	struct dect_call *call = timer->data;
 
-	dect_cc_get_queue_stats(call);
+	if (dect_debug_enabled(DECT_DEBUG_CC))
+		dect_cc_get_queue_stats(dh, call);
 	dect_timer_start(dh, call->qstats_timer, DECT_CC_QUEUE_STATS_TIMER);
 }
 #endif
@@ -458,7 +468,8 @@ static int dect_call_connect_uplane(const struct dect_handle *dh,
 		goto err1;
 
 	dect_transaction_get_ulei(&addr, &call->transaction);
-	if (connect(call->lu_sap->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	if (dect_connect(dh, call->lu_sap, (struct sockaddr *)&addr,
+			 sizeof(addr)) < 0)
 		goto err2;
 
 	dect_fd_setup(call->lu_sap, dect_cc_lu_event, call);
@@ -497,7 +508,8 @@ static void dect_call_disconnect_uplane(const struct dect_handle *dh,
 	dect_timer_free(dh, call->qstats_timer);
 	call->qstats_timer = NULL;
 #endif
-	dect_cc_get_queue_stats(call);
+	if (dect_debug_enabled(DECT_DEBUG_CC))
+		dect_cc_get_queue_stats(dh, call);
 
 	dect_fd_unregister(dh, call->lu_sap);
 	dect_close(dh, call->lu_sap);
@@ -630,7 +642,12 @@ static int dect_cc_send_msg(struct dect_handle *dh, struct dect_call *call,
 			    const struct dect_msg_common *msg,
 			    enum dect_cc_msg_types type)
 {
-	return dect_lce_send(dh, &call->transaction, desc, msg, type);
+	int err;
+
+	err = dect_lce_send_iov(dh, &call->transaction, desc, msg, type);
+	dect_trace(dh, DECT_TRACE_CC_TX, NULL, &call->transaction,
+		   type, call->state, err < 0, 0);
+	return err;
 }
 
 static void dect_cc_send_release_com(struct dect_handle *dh,
@@ -643,8 +660,9 @@ static void dect_cc_send_release_com(struct dect_handle *dh,
 	};
 
 	release_reason.reason = reason;
-	dect_lce_send(dh, ta, &cc_release_com_msg_desc,
-		      &msg.common, DECT_CC_RELEASE_COM);
+	dect_lce_send_tmpl(dh, ta, DECT_TMPL_CC_RELEASE_COM,
+			   &cc_release_com_msg_desc,
+			   &msg.common, DECT_CC_RELEASE_COM);
 }
 
 static void dect_cc_send_release(struct dect_handle *dh, struct dect_call *call,
@@ -1127,8 +1145,9 @@ void dect_mncc_release_res(struct dect_handle *dh, struct dect_call *call,
 	};
 
 	cc_debug_entry(call, "MNCC_RELEASE-res");
-	dect_cc_send_msg(dh, call, &cc_release_com_msg_desc,
-			 &msg.common, DECT_CC_RELEASE_COM);
+	dect_lce_send_tmpl(dh, &call->transaction, DECT_TMPL_CC_RELEASE_COM,
+			   &cc_release_com_msg_desc,
+			   &msg.common, DECT_CC_RELEASE_COM);
 
 	dect_cc_stop_timers(dh, call);
 	dect_call_shutdown(dh, call);
@@ -1790,6 +1809,7 @@ static void dect_cc_rcv(struct dect_handle *dh, struct dect_transaction *ta,
 	struct dect_call *call = container_of(ta, struct dect_call, transaction);
 
 	cc_debug(call, "receive msg type %x", mb->type);
+	dect_trace(dh, DECT_TRACE_CC_RX, NULL, ta, mb->type, call->state, 0, 0);
 	switch (mb->type) {
 	case DECT_CC_ALERTING:
 		return dect_cc_rcv_alerting(dh, call, mb);
@@ -1911,6 +1931,7 @@ static void dect_cc_open(struct dect_handle *dh,
 {
 	dect_debug(DECT_DEBUG_CC, "CC: unknown transaction: msg type: %x\n",
 		   mb->type);
+	dect_trace(dh, DECT_TRACE_CC_RX, NULL, req, mb->type, DECT_CC_NULL, 0, 0);
 
 	switch (mb->type) {
 	case DECT_CC_SETUP:
@@ -24,8 +24,14 @@
  * Mountain View, California  94043
  */
 
+#include <utils.h>
 #include "g72x.h"
 
+#if defined(__x86_64__) || defined(__i386__)
+#define G711_X86
+#include <immintrin.h>
+#endif
+
 /*
  * g711.c
  *
@@ -283,3 +289,387 @@ ulaw2alaw(
 	return ((uval & 0x80) ? (0xD5 ^ (_u2a[0xFF ^ uval] - 1)) :
 	    (0x55 ^ (_u2a[0x7F ^ uval] - 1)));
 }
+
+/*
+ * Block conversions
+ *
+ * The decoders and the A-law/u-law transcoders use 256 entry tables built
+ * from the per-sample functions above. The encoders compute the segment
+ * using comparisons against seg_end and the quantization bits using a
+ * multiplication by a power of two depending on the segment, which allows
+ * to process 8 (SSE2) or 16 (AVX2) samples at once. The results are
+ * identical to those of linear2alaw() and linear2ulaw() for all 16-bit
+ * input values.
+ */
+static short		_alaw2linear[256];
+static short		_ulaw2linear[256];
+static unsigned char	_alaw2ulaw[256];
+static unsigned char	_ulaw2alaw[256];
+
+static inline unsigned char
+linear2alaw_one(
+	short		pcm_val)
+{
+	int		sign = pcm_val >> 15;
+	int		val, seg;
+
+	/* -pcm_val - 8 for negative values, see linear2alaw() */
+	val = (pcm_val ^ sign) + (sign & -7);
+	seg = val > seg_end[0] ? 24 - __builtin_clz(val) : 0;
+
+	return (((seg << SEG_SHIFT) | ((val >> (seg < 2 ? 4 : seg + 3)) &
+		 QUANT_MASK)) ^ (0xD5 ^ (sign & SIGN_BIT)));
+}
+
+static inline unsigned char
+linear2ulaw_one(
+	short		pcm_val)
+{
+	int		sign = pcm_val >> 15;
+	int		val, seg;
+
+	/* Biased magnitude, clamped to the last segment */
+	val = min((pcm_val ^ sign) + BIAS - sign, 0x7FFF);
+	seg = 24 - __builtin_clz(val);
+
+	return (((seg << 4) | ((val >> (seg + 3)) & 0xF)) ^
+		(0xFF ^ (sign & SIGN_BIT)));
+}
+
+static void
+linear2alaw_scalar(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	unsigned int	i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = linear2alaw_one(src[i]);
+}
+
+static void
+linear2ulaw_scalar(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	unsigned int	i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = linear2ulaw_one(src[i]);
+}
+
+#ifdef G711_X86
+/*
+ * The segment is the number of segment ends below the magnitude. The
+ * quantization bits are extracted using an unsigned high multiplication
+ * by 2^(16 - shift), the multiplier is halved for each segment above the
+ * lowest one using a right shift of (shift - 3) bits.
+ */
+static inline __m128i __attribute__((target("sse2")))
+linear2alaw_sse2_8(
+	__m128i		pcm)
+{
+	__m128i		sign, val, seg, mul, gt;
+	int		i;
+
+	sign = _mm_srai_epi16(pcm, 15);
+	val  = _mm_add_epi16(_mm_xor_si128(pcm, sign),
+			     _mm_and_si128(sign, _mm_set1_epi16(-7)));
+	seg  = _mm_setzero_si128();
+	mul  = _mm_set1_epi16(1 << 12);
+
+	for (i = 0; i < NSEGS - 1; i++) {
+		gt  = _mm_cmpgt_epi16(val, _mm_set1_epi16(seg_end[i]));
+		seg = _mm_sub_epi16(seg, gt);
+		if (i > 0)
+			mul = _mm_sub_epi16(mul, _mm_and_si128(gt,
+					    _mm_srli_epi16(mul, 1)));
+	}
+
+	val = _mm_and_si128(_mm_mulhi_epu16(val, mul),
+			    _mm_set1_epi16(QUANT_MASK));
+	val = _mm_or_si128(_mm_slli_epi16(seg, SEG_SHIFT), val);
+	return _mm_xor_si128(val, _mm_xor_si128(_mm_set1_epi16(0xD5),
+			     _mm_and_si128(sign, _mm_set1_epi16(SIGN_BIT))));
+}
+
+static inline __m128i __attribute__((target("sse2")))
+linear2ulaw_sse2_8(
+	__m128i		pcm)
+{
+	__m128i		sign, val, seg, mul, gt;
+	int		i;
+
+	sign = _mm_srai_epi16(pcm, 15);
+	val  = _mm_adds_epi16(_mm_xor_si128(pcm, sign),
+			      _mm_sub_epi16(_mm_set1_epi16(BIAS), sign));
+	seg  = _mm_setzero_si128();
+	mul  = _mm_set1_epi16(1 << 13);
+
+	for (i = 0; i < NSEGS - 1; i++) {
+		gt  = _mm_cmpgt_epi16(val, _mm_set1_epi16(seg_end[i]));
+		seg = _mm_sub_epi16(seg, gt);
+		mul = _mm_sub_epi16(mul, _mm_and_si128(gt,
+				    _mm_srli_epi16(mul, 1)));
+	}
+
+	val = _mm_and_si128(_mm_mulhi_epu16(val, mul), _mm_set1_epi16(0xF));
+	val = _mm_or_si128(_mm_slli_epi16(seg, 4), val);
+	return _mm_xor_si128(val, _mm_xor_si128(_mm_set1_epi16(0xFF),
+			     _mm_and_si128(sign, _mm_set1_epi16(SIGN_BIT))));
+}
+
+static void __attribute__((target("sse2")))
+linear2alaw_sse2(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	unsigned int	i;
+	__m128i		v;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		v = linear2alaw_sse2_8(_mm_loadu_si128((const __m128i *)&src[i]));
+		_mm_storel_epi64((__m128i *)&dst[i], _mm_packus_epi16(v, v));
+	}
+	linear2alaw_scalar(dst + i, src + i, len - i);
+}
+
+static void __attribute__((target("sse2")))
+linear2ulaw_sse2(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	unsigned int	i;
+	__m128i		v;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		v = linear2ulaw_sse2_8(_mm_loadu_si128((const __m128i *)&src[i]));
+		_mm_storel_epi64((__m128i *)&dst[i], _mm_packus_epi16(v, v));
+	}
+	linear2ulaw_scalar(dst + i, src + i, len - i);
+}
+
+static inline __m256i __attribute__((target("avx2")))
+linear2alaw_avx2_16(
+	__m256i		pcm)
+{
+	__m256i		sign, val, seg, mul, gt;
+	int		i;
+
+	sign = _mm256_srai_epi16(pcm, 15);
+	val  = _mm256_add_epi16(_mm256_xor_si256(pcm, sign),
+				_mm256_and_si256(sign, _mm256_set1_epi16(-7)));
+	seg  = _mm256_setzero_si256();
+	mul  = _mm256_set1_epi16(1 << 12);
+
+	for (i = 0; i < NSEGS - 1; i++) {
+		gt  = _mm256_cmpgt_epi16(val, _mm256_set1_epi16(seg_end[i]));
+		seg = _mm256_sub_epi16(seg, gt);
+		if (i > 0)
+			mul = _mm256_sub_epi16(mul, _mm256_and_si256(gt,
+					       _mm256_srli_epi16(mul, 1)));
+	}
+
+	val = _mm256_and_si256(_mm256_mulhi_epu16(val, mul),
+			       _mm256_set1_epi16(QUANT_MASK));
+	val = _mm256_or_si256(_mm256_slli_epi16(seg, SEG_SHIFT), val);
+	return _mm256_xor_si256(val, _mm256_xor_si256(_mm256_set1_epi16(0xD5),
+				_mm256_and_si256(sign, _mm256_set1_epi16(SIGN_BIT))));
+}
+
+static inline __m256i __attribute__((target("avx2")))
+linear2ulaw_avx2_16(
+	__m256i		pcm)
+{
+	__m256i		sign, val, seg, mul, gt;
+	int		i;
+
+	sign = _mm256_srai_epi16(pcm, 15);
+	val  = _mm256_adds_epi16(_mm256_xor_si256(pcm, sign),
+				 _mm256_sub_epi16(_mm256_set1_epi16(BIAS), sign));
+	seg  = _mm256_setzero_si256();
+	mul  = _mm256_set1_epi16(1 << 13);
+
+	for (i = 0; i < NSEGS - 1; i++) {
+		gt  = _mm256_cmpgt_epi16(val, _mm256_set1_epi16(seg_end[i]));
+		seg = _mm256_sub_epi16(seg, gt);
+		mul = _mm256_sub_epi16(mul, _mm256_and_si256(gt,
+				       _mm256_srli_epi16(mul, 1)));
+	}
+
+	val = _mm256_and_si256(_mm256_mulhi_epu16(val, mul),
+			       _mm256_set1_epi16(0xF));
+	val = _mm256_or_si256(_mm256_slli_epi16(seg, 4), val);
+	return _mm256_xor_si256(val, _mm256_xor_si256(_mm256_set1_epi16(0xFF),
+				_mm256_and_si256(sign, _mm256_set1_epi16(SIGN_BIT))));
+}
+
+/* Pack the 16 results and restore their order across the 128-bit lanes */
+static inline void __attribute__((target("avx2")))
+g711_store_avx2_16(
+	unsigned char	*dst,
+	__m256i		v)
+{
+	v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+	_mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(v));
+}
+
+static void __attribute__((target("avx2")))
+linear2alaw_avx2(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	unsigned int	i;
+	__m256i		v;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		v = _mm256_loadu_si256((const __m256i *)&src[i]);
+		g711_store_avx2_16(&dst[i], linear2alaw_avx2_16(v));
+	}
+	linear2alaw_scalar(dst + i, src + i, len - i);
+}
+
+static void __attribute__((target("avx2")))
+linear2ulaw_avx2(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	unsigned int	i;
+	__m256i		v;
+
+	for (i = 0; i + 16 <= len; i += 16) {
+		v = _mm256_loadu_si256((const __m256i *)&src[i]);
+		g711_store_avx2_16(&dst[i], linear2ulaw_avx2_16(v));
+	}
+	linear2ulaw_scalar(dst + i, src + i, len - i);
+}
+#endif /* G711_X86 */
+
+static void (*linear2alaw_impl)(unsigned char *dst, const short *src,
+				unsigned int len) = linear2alaw_scalar;
+static void (*linear2ulaw_impl)(unsigned char *dst, const short *src,
+				unsigned int len) = linear2ulaw_scalar;
+
+static void __init
+g711_init(void)
+{
+	int		i;
+
+	for (i = 0; i < 256; i++) {
+		_alaw2linear[i] = alaw2linear(i);
+		_ulaw2linear[i] = ulaw2linear(i);
+		_alaw2ulaw[i]	= alaw2ulaw(i);
+		_ulaw2alaw[i]	= ulaw2alaw(i);
+	}
+
+#ifdef G711_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		linear2alaw_impl = linear2alaw_avx2;
+		linear2ulaw_impl = linear2ulaw_avx2;
+	} else if (__builtin_cpu_supports("sse2")) {
+		linear2alaw_impl = linear2alaw_sse2;
+		linear2ulaw_impl = linear2ulaw_sse2;
+	}
+#endif
+}
+
+/*
+ * linear2alaw_block() - Convert a block of 16-bit linear PCM values to A-law
+ *
+ * Equivalent to calling linear2alaw() for each of the len samples in src.
+ */
+void
+linear2alaw_block(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	linear2alaw_impl(dst, src, len);
+}
+EXPORT_SYMBOL(linear2alaw_block);
+
+/*
+ * linear2ulaw_block() - Convert a block of 16-bit linear PCM values to u-law
+ *
+ * Equivalent to calling linear2ulaw() for each of the len samples in src.
+ */
+void
+linear2ulaw_block(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len)
+{
+	linear2ulaw_impl(dst, src, len);
+}
+EXPORT_SYMBOL(linear2ulaw_block);
+
+/*
+ * alaw2linear_block() - Convert a block of A-law values to 16-bit linear PCM
+ */
+void
+alaw2linear_block(
+	short		*dst,
+	const unsigned char *src,
+	unsigned int	len)
+{
+	unsigned int	i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = _alaw2linear[src[i]];
+}
+EXPORT_SYMBOL(alaw2linear_block);
+
+/*
+ * ulaw2linear_block() - Convert a block of u-law values to 16-bit linear PCM
+ */
+void
+ulaw2linear_block(
+	short		*dst,
+	const unsigned char *src,
+	unsigned int	len)
+{
+	unsigned int	i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = _ulaw2linear[src[i]];
+}
+EXPORT_SYMBOL(ulaw2linear_block);
+
+/*
+ * alaw2ulaw_block() - Convert a block of A-law values to u-law
+ */
+void
+alaw2ulaw_block(
+	unsigned char	*dst,
+	const unsigned char *src,
+	unsigned int	len)
+{
+	unsigned int	i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = _alaw2ulaw[src[i]];
+}
+EXPORT_SYMBOL(alaw2ulaw_block);
+
+/*
+ * ulaw2alaw_block() - Convert a block of u-law values to A-law
+ */
+void
+ulaw2alaw_block(
+	unsigned char	*dst,
+	const unsigned char *src,
+	unsigned int	len)
+{
+	unsigned int	i;
+
+	for (i = 0; i < len; i++)
+		dst[i] = _ulaw2alaw[src[i]];
+}
+EXPORT_SYMBOL(ulaw2alaw_block);
@@ -49,7 +49,7 @@
  *
  */
 #include <utils.h>
-#include "g72x.h"
+#include "g72x_inline.h"
 
 static short qtab_721[7] = {-124, 80, 178, 246, 300, 349, 400};
 /*
@@ -76,8 +76,8 @@ static short	_fitab[16] = {0, 0, 0, 0x200, 0x200, 0x200, 0x600, 0xE00,
  * Encodes the input vale of linear PCM, A-law or u-law data sl and returns
  * the resulting code. -1 is returned for unknown input coding value.
  */
-int
-g721_encoder(
+static __always_inline int
+__g721_encoder(
 	int		sl,
 	int		in_coding,
 	struct g72x_state *state_ptr)
@@ -103,26 +103,34 @@ g721_encoder(
 		return (-1);
 	}
 
-	sezi = predictor_zero(state_ptr);
+	se = __predictor(state_ptr, &sezi) >> 1;	/* estimated signal */
 	sez = sezi >> 1;
-	se = (sezi + predictor_pole(state_ptr)) >> 1;	/* estimated signal */
 
 	d = sl - se;				/* estimation difference */
 
 	/* quantize the prediction difference */
-	y = step_size(state_ptr);		/* quantizer step size */
-	i = quantize(d, y, qtab_721, 7);	/* i = ADPCM code */
+	y = __step_size(state_ptr);		/* quantizer step size */
+	i = __quantize(d, y, qtab_721, 7);	/* i = ADPCM code */
 
-	dq = reconstruct(i & 8, _dqlntab[i], y);	/* quantized est diff */
+	dq = __reconstruct(i & 8, _dqlntab[i], y);	/* quantized est diff */
 
 	sr = (dq < 0) ? se - (dq & 0x3FFF) : se + dq;	/* reconst. signal */
 
 	dqsez = sr + sez - se;			/* pole prediction diff. */
 
-	update(4, y, _witab[i] << 5, _fitab[i], dq, sr, dqsez, state_ptr);
+	__update(4, y, _witab[i] << 5, _fitab[i], dq, sr, dqsez, state_ptr);
 
 	return (i);
 }
+
+int
+g721_encoder(
+	int		sl,
+	int		in_coding,
+	struct g72x_state *state_ptr)
+{
+	return (__g721_encoder(sl, in_coding, state_ptr));
+}
 EXPORT_SYMBOL(g721_encoder);
 
 /*
@@ -134,8 +142,8 @@ EXPORT_SYMBOL(g721_encoder);
  * returns the resulting linear PCM, A-law or u-law value.
  * return -1 for unknown out_coding value.
  */
-int
-g721_decoder(
+static __always_inline int
+__g721_decoder(
 	int		i,
 	int		out_coding,
 	struct g72x_state *state_ptr)
@@ -147,20 +155,19 @@ g721_decoder(
 	short		dqsez;
 
 	i &= 0x0f;			/* mask to get proper bits */
-	sezi = predictor_zero(state_ptr);
+	sei = __predictor(state_ptr, &sezi);
 	sez = sezi >> 1;
-	sei = sezi + predictor_pole(state_ptr);
 	se = sei >> 1;			/* se = estimated signal */
 
-	y = step_size(state_ptr);	/* dynamic quantizer step size */
+	y = __step_size(state_ptr);	/* dynamic quantizer step size */
 
-	dq = reconstruct(i & 0x08, _dqlntab[i], y); /* quantized diff. */
+	dq = __reconstruct(i & 0x08, _dqlntab[i], y); /* quantized diff. */
 
 	sr = (dq < 0) ? (se - (dq & 0x3FFF)) : se + dq;	/* reconst. signal */
 
 	dqsez = sr - se + sez;			/* pole prediction diff. */
 
-	update(4, y, _witab[i] << 5, _fitab[i], dq, sr, dqsez, state_ptr);
+	__update(4, y, _witab[i] << 5, _fitab[i], dq, sr, dqsez, state_ptr);
 
 	switch (out_coding) {
 	case AUDIO_ENCODING_ALAW:
@@ -173,4 +180,139 @@ g721_decoder(
 		return (-1);
 	}
 }
+
+int
+g721_decoder(
+	int		i,
+	int		out_coding,
+	struct g72x_state *state_ptr)
+{
+	return (__g721_decoder(i, out_coding, state_ptr));
+}
 EXPORT_SYMBOL(g721_decoder);
+
+/*
+ * The coding is a constant in each of the callers, so the conversion is
+ * resolved at compile time and the coder state is kept in a local copy
+ * that doesn't need to be written back after each sample.
+ */
+static __always_inline void
+__g721_encode_block(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len,
+	int		in_coding,
+	struct g72x_state *state_ptr)
+{
+	struct g72x_state state = *state_ptr;
+	unsigned int	i;
+	int		code;
+
+	for (i = 0; i < len; i++) {
+		code = __g721_encoder(src[i], in_coding, &state);
+		if (i & 1)
+			dst[i / 2] |= code;
+		else
+			dst[i / 2] = code << 4;
+	}
+
+	*state_ptr = state;
+}
+
+/*
+ * g721_encode_block()
+ *
+ * Encodes len samples of linear PCM, A-law or u-law data from src and
+ * stores the resulting codes in dst, two codes per octet with the first
+ * one in the upper nibble. The lower nibble of the last octet is zero
+ * for an odd number of samples. Returns 0 or -1 for unknown input coding
+ * value.
+ */
+int
+g721_encode_block(
+	unsigned char	*dst,
+	const short	*src,
+	unsigned int	len,
+	int		in_coding,
+	struct g72x_state *state_ptr)
+{
+	switch (in_coding) {
+	case AUDIO_ENCODING_ALAW:
+		__g721_encode_block(dst, src, len, AUDIO_ENCODING_ALAW,
+				    state_ptr);
+		break;
+	case AUDIO_ENCODING_ULAW:
+		__g721_encode_block(dst, src, len, AUDIO_ENCODING_ULAW,
+				    state_ptr);
+		break;
+	case AUDIO_ENCODING_LINEAR:
+		__g721_encode_block(dst, src, len, AUDIO_ENCODING_LINEAR,
+				    state_ptr);
+		break;
+	default:
+		return (-1);
+	}
+	return (0);
+}
+EXPORT_SYMBOL(g721_encode_block);
+
+static __always_inline void
+__g721_decode_block(
+	short		*dst,
+	const unsigned char *src,
+	unsigned int	len,
+	int		out_coding,
+	struct g72x_state *state_ptr)
+{
+	struct g72x_state state = *state_ptr;
+	unsigned int	i;
+	int		sample;
+
+	for (i = 0; i < len; i++) {
+		sample = __g721_decoder(i & 1 ? src[i / 2] : src[i / 2] >> 4,
+					out_coding, &state);
+		/* sr << 2 exceeds the 16 bit range on overload */
+		if (out_coding == AUDIO_ENCODING_LINEAR)
+			sample = min(max(sample, -32768), 32767);
+		dst[i] = sample;
+	}
+
+	*state_ptr = state;
+}
+
+/*
+ * g721_decode_block()
+ *
+ * Decodes len codes of G.721 encoded data packed two per octet into src,
+ * the first one in the upper nibble, and stores the resulting linear PCM,
+ * A-law or u-law values in dst. Linear PCM values exceeding the 16 bit
+ * range on overload are saturated. Returns 0 or -1 for unknown output
+ * coding value.
+ */
+int
+g721_decode_block(
+	short		*dst,
+	const unsigned char *src,
+	unsigned int	len,
+	int		out_coding,
+	struct g72x_state *state_ptr)
+{
+	switch (out_coding) {
+	case AUDIO_ENCODING_ALAW:
+		__g721_decode_block(dst, src, len, AUDIO_ENCODING_ALAW,
+				    state_ptr);
+		break;
+	case AUDIO_ENCODING_ULAW:
+		__g721_decode_block(dst, src, len, AUDIO_ENCODING_ULAW,
+				    state_ptr);
+		break;
+	case AUDIO_ENCODING_LINEAR:
+		__g721_decode_block(dst, src, len, AUDIO_ENCODING_LINEAR,
+				    state_ptr);
+		break;
+	default:
+		return (-1);
+	}
+	return (0);
+}
+EXPORT_SYMBOL(g721_decode_block);
@@ -121,6 +121,18 @@ extern int g721_decoder(
 		int code,
 		int out_coding,
 		struct g72x_state *state_ptr);
+extern int g721_encode_block(
+		unsigned char *dst,
+		const short *src,
+		unsigned int len,
+		int in_coding,
+		struct g72x_state *state_ptr);
+extern int g721_decode_block(
+		short *dst,
+		const unsigned char *src,
+		unsigned int len,
+		int out_coding,
+		struct g72x_state *state_ptr);
 extern int g723_24_encoder(
 		int sample,
 		int in_coding,
@@ -145,4 +157,17 @@ extern int ulaw2linear(unsigned char u_val);
 extern unsigned char alaw2ulaw(unsigned char aval);
 extern unsigned char ulaw2alaw(unsigned char uval);
 
+extern void linear2alaw_block(unsigned char *dst, const short *src,
+		unsigned int len);
+extern void linear2ulaw_block(unsigned char *dst, const short *src,
+		unsigned int len);
+extern void alaw2linear_block(short *dst, const unsigned char *src,
+		unsigned int len);
+extern void ulaw2linear_block(short *dst, const unsigned char *src,
+		unsigned int len);
+extern void alaw2ulaw_block(unsigned char *dst, const unsigned char *src,
+		unsigned int len);
+extern void ulaw2alaw_block(unsigned char *dst, const unsigned char *src,
+		unsigned int len);
+
 #endif /* !_G72X_H */
@@ -20,7 +20,7 @@
 #include <clms.h>
 #include <lce.h>
 
-static DECT_SFMT_MSG_DESC(clms_variable,
+DECT_SFMT_MSG_DESC(clms_variable,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_MMS_GENERIC_HEADER,	IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_MMS_OBJECT_HEADER,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -61,10 +61,10 @@ static const struct dect_trans_tbl clms_header_codings[] = {
 
 void dect_clms_rcv_fixed(struct dect_handle *dh, struct dect_msg_buf *mb)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mbr = &_mb;
 	struct dect_clms_fixed_addr_section *as;
 	struct dect_clms_fixed_data_section *ds;
-	unsigned int n, len, section, sections;
+	unsigned int n, len, section, sections, off;
+	uint8_t *data;
 	char buf[128];
 
 	clms_debug("parse {CLMS-FIXED} message");
@@ -84,11 +84,17 @@ void dect_clms_rcv_fixed(struct dect_handle *dh, struct dect_msg_buf *mb)
 	if (as->pd != DECT_CLMS_PD_DECT_IE_CODING && as->pd != 0x6)
 		return;
 
+	/* The message is reassembled in place, the data of each section is
+	 * moved to the front of the buffer behind the data already processed.
+	 */
+	data = mb->data;
+	off  = 0;
+
 	switch (as->hdr & DECT_CLMS_HDR_MASK) {
 	case DECT_CLMS_HDR_STANDARD_ONE_SECTION:
 	case DECT_CLMS_HDR_BITSTREAM_ONE_SECTION:
 	case DECT_CLMS_HDR_ALPHANUMERIC_ONE_SECTION:
-		memcpy(dect_mbuf_put(mbr, 1), &as->li, 1);
+		data[off++] = as->li;
 		goto deliver;
 	case DECT_CLMS_HDR_STANDARD_MULTI_SECTION:
 	case DECT_CLMS_HDR_BITSTREAM_MULTI_SECTION:
@@ -121,7 +127,8 @@ void dect_clms_rcv_fixed(struct dect_handle *dh, struct dect_msg_buf *mb)
 		sections++;
 
 		n = min(len, DECT_CLMS_DATA_SIZE);
-		memcpy(dect_mbuf_put(mbr, n), ds->data, n);
+		memmove(data + off, ds->data, n);
+		off += n;
 		len -= n;
 
 		dect_mbuf_pull(mb, sizeof(*ds));
@@ -130,10 +137,12 @@ void dect_clms_rcv_fixed(struct dect_handle *dh, struct dect_msg_buf *mb)
 	if (len > 0)
 		return;
 deliver:
-	dect_mbuf_dump(DECT_DEBUG_CLMS, mbr, "CLMS");
+	mb->data = data;
+	mb->len  = off;
+	dect_mbuf_dump(DECT_DEBUG_CLMS, mb, "CLMS");
 
 	clms_debug("MNCL_UNITDATA-ind: type: %u", DECT_CLMS_FIXED);
-	dh->ops->clms_ops->mncl_unitdata_ind(dh, DECT_CLMS_FIXED, NULL, mbr);
+	dh->ops->clms_ops->mncl_unitdata_ind(dh, DECT_CLMS_FIXED, NULL, mb);
 }
 
 static void dect_clms_send_fixed(struct dect_handle *dh,
@@ -198,19 +207,19 @@ static void dect_clms_rcv_variable(struct dect_handle *dh,
 				   struct dect_transaction *ta,
 				   struct dect_msg_buf *mb)
 {
-	struct dect_clms_variable_msg msg;
+	struct dect_ie_portable_identity portable_identity;
+	struct dect_msg_view view;
 
 	clms_debug("CLMS-VARIABLE");
-	if (dect_parse_sfmt_msg(dh, &clms_variable_msg_desc,
-				&msg.common, mb) < 0)
+	if (dect_msg_view_init(dh, &view, &clms_variable_msg_desc, mb) < 0)
+		return;
+	if (dect_msg_view_get(dh, &view, DECT_IE_PORTABLE_IDENTITY,
+			      &portable_identity) < 0)
 		return;
 
-	if (msg.portable_identity->type != DECT_PORTABLE_ID_TYPE_IPUI)
-		goto out;
-	if (dect_ddl_set_ipui(dh, ta->link, &msg.portable_identity->ipui) < 0)
-		goto out;
-out:
-	dect_msg_free(dh, &clms_variable_msg_desc, &msg.common);
+	if (portable_identity.type != DECT_PORTABLE_ID_TYPE_IPUI)
+		return;
+	dect_ddl_set_ipui(dh, ta->link, &portable_identity.ipui);
 }
 
 static void dect_clms_open(struct dect_handle *dh,
@@ -39,6 +39,31 @@ void dect_set_debug_hook(void (*fn)(enum dect_debug_subsys subsys,
 }
 EXPORT_SYMBOL(dect_set_debug_hook);
 
+uint32_t dect_debug_mask = DECT_DEBUG_MASK_ALL;
+
+/**
+ * Set the mask of subsystems to output debugging messages for
+ *
+ * @param mask	bitmask of DECT_DEBUG_MASK() values of the enabled subsystems
+ *
+ * Messages of disabled subsystems are neither formatted nor passed to the
+ * debugging hook. All subsystems are enabled by default.
+ */
+void dect_set_debug_mask(uint32_t mask)
+{
+	dect_debug_mask = mask;
+}
+EXPORT_SYMBOL(dect_set_debug_mask);
+
+/**
+ * Get the mask of subsystems to output debugging messages for
+ */
+uint32_t dect_get_debug_mask(void)
+{
+	return dect_debug_mask;
+}
+EXPORT_SYMBOL(dect_get_debug_mask);
+
 #ifdef DEBUG
 void __fmtstring(2, 3) __dect_debug(enum dect_debug_subsys subsys,
 				    const char *fmt, ...)
@@ -58,6 +83,7 @@ void __fmtstring(2, 3) __dect_debug(enum dect_debug_subsys subsys,
 void __dect_hexdump(enum dect_debug_subsys subsys, const char *prefix,
 		    const uint8_t *buf, size_t size)
 {
+	static const char hex[] = "0123456789abcdef";
 	unsigned int i, off, plen = 0;
 	char hbuf[3 * BLOCKSIZE + 1], abuf[BLOCKSIZE + 1];
 
@@ -67,7 +93,10 @@ void __dect_hexdump(enum dect_debug_subsys subsys, const char *prefix,
 	for (i = 0; i < size; i++) {
 		off = i % BLOCKSIZE;
 
-		sprintf(hbuf + 3 * off, "%.2x ", buf[i]);
+		hbuf[3 * off + 0] = hex[buf[i] >> 4];
+		hbuf[3 * off + 1] = hex[buf[i] & 0xf];
+		hbuf[3 * off + 2] = ' ';
+		hbuf[3 * off + 3] = '\0';
 		abuf[off] = isascii(buf[i]) && isprint(buf[i]) ? buf[i] : '.';
 
 		if (off == BLOCKSIZE - 1 || i == size - 1) {
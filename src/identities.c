@@ -238,12 +238,16 @@ void dect_dump_ipui(const struct dect_ipui *ipui)
 
 bool dect_parse_ipui(struct dect_ipui *ipui, const uint8_t *ptr, uint8_t len)
 {
+	uint8_t buf[8];
 	uint64_t tmp;
 
-	if (len < 4)
+	if (len < 4 || len > 64)
 		return false;
 
-	tmp = __be64_to_cpu(*(__be64 *)&ptr[0]);
+	/* Don't read beyond the octets covered by len */
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf, ptr, div_round_up(len, 8));
+	tmp = __be64_to_cpu(*(__be64 *)buf);
 
 	ipui->put = ptr[0] & DECT_IPUI_PUT_MASK;
 	switch (ipui->put) {
@@ -274,6 +278,7 @@ bool dect_parse_ipui(struct dect_ipui *ipui, const uint8_t *ptr, uint8_t len)
 uint8_t dect_build_ipui(uint8_t *ptr, const struct dect_ipui *ipui)
 {
 	unsigned int i, len;
+	int shift;
 	uint64_t tmp;
 
 	switch (ipui->put) {
@@ -302,8 +307,11 @@ uint8_t dect_build_ipui(uint8_t *ptr, const struct dect_ipui *ipui)
 	memset(ptr, 0, div_round_up(4 + len, 8));
 	ptr[0] = ipui->put;
 
-	for (i = 0; i < div_round_up(len, 8U); i++)
-		ptr[i] |= tmp >> (max(len, 4U) - 4 - 8 * i);
+	/* The number follows the PUT and isn't necessarily octet aligned */
+	for (i = 0; i < div_round_up(4 + max(len, 4U), 8U); i++) {
+		shift = max(len, 4U) - 4 - 8 * i;
+		ptr[i] |= shift >= 0 ? tmp >> shift : tmp << -shift;
+	}
 
 	return 4 + len;
 }
@@ -314,6 +322,27 @@ bool dect_ipui_cmp(const struct dect_ipui *i1, const struct dect_ipui *i2)
 }
 EXPORT_SYMBOL(dect_ipui_cmp);
 
+/*
+ * Jenkins one-at-a-time hash over the complete IPUI, consistent with
+ * dect_ipui_cmp().
+ */
+uint32_t dect_ipui_hash(const struct dect_ipui *ipui)
+{
+	const uint8_t *ptr = (const uint8_t *)ipui;
+	uint32_t hash = 0;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(*ipui); i++) {
+		hash += ptr[i];
+		hash += hash << 10;
+		hash ^= hash >> 6;
+	}
+	hash += hash << 3;
+	hash ^= hash >> 11;
+	hash += hash << 15;
+	return hash;
+}
+
 struct dect_tpui *dect_ipui_to_tpui(struct dect_tpui *tpui,
 				    const struct dect_ipui *ipui)
 {
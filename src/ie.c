@@ -21,6 +21,8 @@
 
 #include <dect/ie.h>
 #include <libdect.h>
+#include <utils.h>
+#include <s_fmt.h>
 
 #if 0
 #define refcnt_debug(fmt, ...)	dect_debug(DECT_DEBUG_UNKNOWN, fmt, ## __VA_ARGS__)
@@ -46,6 +48,8 @@ EXPORT_SYMBOL(dect_ie_alloc);
 
 void dect_ie_destroy(const struct dect_handle *dh, struct dect_ie_common *ie)
 {
+	if (ie->arena != NULL)
+		return dect_ie_arena_put(dh, ie->arena);
 	dect_free(dh, ie);
 }
 EXPORT_SYMBOL(dect_ie_destroy);
@@ -86,6 +90,59 @@ void __dect_ie_put(const struct dect_handle *dh, struct dect_ie_common *ie)
 }
 EXPORT_SYMBOL(__dect_ie_put);
 
+/*
+ * Information Element arenas
+ *
+ * The IEs of a received message are allocated from a single block sized for
+ * the message's worst case. The arena holds one reference for its owner and
+ * one for every IE allocated from it, IEs still referenced when the message
+ * is freed keep the arena alive until they are released.
+ */
+
+struct dect_ie_arena *dect_ie_arena_alloc(const struct dect_handle *dh,
+					  unsigned int size)
+{
+	struct dect_ie_arena *arena;
+
+	arena = dect_malloc(dh, sizeof(*arena) + size);
+	if (arena == NULL)
+		return NULL;
+	arena->refcnt = 1;
+	arena->size   = size;
+	arena->used   = 0;
+	refcnt_debug("arena %p: alloc size=%u\n", arena, size);
+	return arena;
+}
+
+struct dect_ie_common *dect_ie_arena_ie_alloc(const struct dect_handle *dh,
+					      struct dect_ie_arena *arena,
+					      size_t size)
+{
+	struct dect_ie_common *ie;
+
+	/* Fall back to the heap for repeated IEs exceeding the estimate */
+	if (arena == NULL || arena->size - arena->used < DECT_IE_ARENA_ALIGN(size))
+		return dect_ie_alloc(dh, size);
+
+	ie = (void *)arena->data + arena->used;
+	arena->used += DECT_IE_ARENA_ALIGN(size);
+	arena->refcnt++;
+
+	memset(ie, 0, size);
+	ie->refcnt = 1;
+	ie->arena  = arena;
+	return ie;
+}
+
+void dect_ie_arena_put(const struct dect_handle *dh, struct dect_ie_arena *arena)
+{
+	refcnt_debug("arena %p: release refcnt=%u\n", arena, arena->refcnt);
+	dect_assert(arena->refcnt != 0);
+	if (--arena->refcnt > 0)
+		return;
+	dect_free(dh, arena);
+}
+
 /*
  * Information Element lists
  */
@@ -125,11 +182,13 @@ EXPORT_SYMBOL(dect_ie_list_hold);
 
 void dect_ie_list_put(const struct dect_handle *dh, struct dect_ie_list *iel)
 {
-	struct dect_ie_common *ie;
+	struct dect_ie_common *ie, *next;
 
 	refcnt_debug("IEL %p: release\n", iel);
-	dect_foreach_ie(ie, iel)
+	for (ie = iel->list; ie != NULL; ie = next) {
+		next = ie->next;
 		__dect_ie_put(dh, ie);
+	}
 }
 EXPORT_SYMBOL(dect_ie_list_put);
 
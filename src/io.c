@@ -35,6 +35,8 @@
  */
 
 #include <unistd.h>
+#include <string.h>
+#include <errno.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <fcntl.h>
@@ -42,8 +44,12 @@
 #include <sys/socket.h>
 
 #include <libdect.h>
+#include <netlink.h>
+#include <transport.h>
 #include <utils.h>
 #include <io.h>
+#include <lce.h>
+#include <capture.h>
 
 #ifndef SOCK_NONBLOCK
 #define SOCK_NONBLOCK O_NONBLOCK
@@ -59,6 +65,7 @@ struct dect_fd *dect_fd_alloc(const struct dect_handle *dh)
 		return NULL;
 	dfd->fd    = -1;
 	dfd->state = DECT_FD_UNREGISTERED;
+	dfd->flags = 0;
 	return dfd;
 }
 EXPORT_SYMBOL(dect_fd_alloc);
@@ -128,16 +135,45 @@ EXPORT_SYMBOL(dect_fd_unregister);
 void dect_fd_process(struct dect_handle *dh, struct dect_fd *dfd, uint32_t events)
 {
 	dect_assert(dfd->state == DECT_FD_REGISTERED);
+
+	/* Defer freeing the descriptor until the callback has returned */
+	dfd->flags |= DECT_FD_BUSY;
+	dect_event_enter(dh);
 	dfd->callback(dh, dfd, events);
+	dect_event_exit(dh);
+	dfd->flags &= ~DECT_FD_BUSY;
+
+	if (dfd->flags & DECT_FD_DESTROYED)
+		dect_free(dh, dfd);
 }
 EXPORT_SYMBOL(dect_fd_process);
 
+void dect_event_enter(struct dect_handle *dh)
+{
+	dh->event_depth++;
+}
+
+void dect_event_exit(struct dect_handle *dh)
+{
+	dect_assert(dh->event_depth > 0);
+	if (--dh->event_depth > 0)
+		return;
+
+	dect_lce_bcast_complete(dh);
+	dect_capture_complete(dh);
+}
+
 void dect_close(const struct dect_handle *dh, struct dect_fd *dfd)
 {
 	dect_assert(dfd->state == DECT_FD_UNREGISTERED);
 	if (dfd->fd >= 0)
 		close(dfd->fd);
-	dect_free(dh, dfd);
+	dfd->fd = -1;
+
+	if (dfd->flags & DECT_FD_BUSY)
+		dfd->flags |= DECT_FD_DESTROYED;
+	else
+		dect_free(dh, dfd);
 }
 EXPORT_SYMBOL(dect_close);
 
@@ -149,7 +185,7 @@ struct dect_fd *dect_socket(const struct dect_handle *dh, int type, int protocol
 	if (dfd == NULL)
 		goto err1;
 
-	dfd->fd = socket(AF_DECT, type | SOCK_NONBLOCK, protocol);
+	dfd->fd = dh->transport->socket(dh, type | SOCK_NONBLOCK, protocol);
 	if (dfd->fd < 0)
 		goto err2;
 
@@ -161,6 +197,38 @@ err1:
 	return NULL;
 }
 
+int dect_bind(const struct dect_handle *dh, struct dect_fd *dfd,
+	      const struct sockaddr *addr, socklen_t len)
+{
+	return dh->transport->bind(dh, dfd, addr, len);
+}
+
+int dect_connect(const struct dect_handle *dh, struct dect_fd *dfd,
+		 const struct sockaddr *addr, socklen_t len)
+{
+	return dh->transport->connect(dh, dfd, addr, len);
+}
+
+int dect_listen(const struct dect_handle *dh, struct dect_fd *dfd, int backlog)
+{
+	return dh->transport->listen(dh, dfd, backlog);
+}
+
+int dect_getsockopt(const struct dect_handle *dh, const struct dect_fd *dfd,
+		    int level, int optname, void *optval, socklen_t *optlen)
+{
+	return dh->transport->getsockopt(dh, dfd, level, optname,
+					 optval, optlen);
+}
+
+int dect_setsockopt(const struct dect_handle *dh, const struct dect_fd *dfd,
+		    int level, int optname, const void *optval,
+		    socklen_t optlen)
+{
+	return dh->transport->setsockopt(dh, dfd, level, optname,
+					 optval, optlen);
+}
+
 struct dect_fd *dect_accept(const struct dect_handle *dh,
 			    const struct dect_fd *dfd,
 			    struct sockaddr *addr, socklen_t len)
@@ -171,7 +239,7 @@ struct dect_fd *dect_accept(const struct dect_handle *dh,
 	if (nfd == NULL)
 		goto err1;
 
-	nfd->fd = accept(dfd->fd, addr, &len);
+	nfd->fd = dh->transport->accept(dh, dfd, addr, &len);
 	if (nfd->fd < 0)
 		goto err2;
 	if (fcntl(nfd->fd, F_SETFL, O_NONBLOCK) < 0)
@@ -185,5 +253,286 @@ err1:
 	return NULL;
 }
 
+static void dect_rx_batch_setup(const struct dect_handle *dh,
+				struct dect_rx_batch *rxb, unsigned int i)
+{
+	struct msghdr *msg = &rxb->msg[i].msg_hdr;
+	struct dect_msg_buf *mb = &rxb->mb[i];
+
+	dect_mbuf_release_ext(dh, mb);
+	mb->data		= mb->head;
+	mb->len			= 0;
+	mb->type		= 0;
+	mb->refcnt		= 0;
+	mb->next		= NULL;
+
+	rxb->iov[i][0].iov_base	= mb->head;
+	rxb->iov[i][0].iov_len	= sizeof(mb->head);
+	rxb->iov[i][1].iov_base	= rxb->overflow[i];
+	rxb->iov[i][1].iov_len	= sizeof(rxb->overflow[i]);
+
+	msg->msg_name		= NULL;
+	msg->msg_namelen	= 0;
+	msg->msg_iov		= rxb->iov[i];
+	msg->msg_iovlen		= array_size(rxb->iov[i]);
+	msg->msg_control	= rxb->cmsg[i];
+	msg->msg_controllen	= sizeof(rxb->cmsg[i]);
+	msg->msg_flags		= 0;
+}
+
+/*
+ * Move a message exceeding the inline storage area to an external storage
+ * area. The message is truncated to zero length if no memory is available,
+ * which causes it to be discarded as malformed by the receive paths.
+ */
+static void dect_rx_batch_complete(const struct dect_handle *dh,
+				   struct dect_rx_batch *rxb, unsigned int i)
+{
+	struct dect_msg_buf *mb = &rxb->mb[i];
+	unsigned int len = rxb->msg[i].msg_len;
+
+	len = min(len, (unsigned int)DECT_RX_BUF_SIZE);
+	if (len <= sizeof(mb->head)) {
+		mb->len = len;
+		return;
+	}
+
+	mb->ext = dect_malloc(dh, len);
+	if (mb->ext == NULL)
+		return;
+	memcpy(mb->ext, mb->head, sizeof(mb->head));
+	memcpy(mb->ext + sizeof(mb->head), rxb->overflow[i],
+	       len - sizeof(mb->head));
+	mb->size = len;
+	mb->data = mb->ext;
+	mb->len  = len;
+}
+
+/**
+ * dect_rx_batch_rcv - receive a batch of messages from a socket
+ *
+ * @dh:		libdect DECT handle
+ * @dfd:	libdect file descriptor
+ * @n:		maximum number of messages to receive
+ *
+ * Receive up to @n messages into the handle's receive batch without blocking,
+ * using a single recvmmsg() call if supported by the kernel. Returns the
+ * number of messages received or -1 if the first message could not be
+ * received. errno is set to EAGAIN if no messages were pending.
+ */
+int dect_rx_batch_rcv(const struct dect_handle *dh, const struct dect_fd *dfd,
+		      unsigned int n)
+{
+#ifdef HAVE_RECVMMSG
+	static bool no_recvmmsg;
+#endif
+	struct dect_rx_batch *rxb = dh->rxb;
+	unsigned int i;
+	ssize_t len;
+	int cnt;
+
+	n = min(n, (unsigned int)DECT_RX_BATCH_SIZE);
+	for (i = 0; i < n; i++)
+		dect_rx_batch_setup(dh, rxb, i);
+
+#ifdef HAVE_RECVMMSG
+	if (!no_recvmmsg) {
+		cnt = recvmmsg(dfd->fd, rxb->msg, n, MSG_DONTWAIT, NULL);
+		if (cnt >= 0)
+			goto out;
+		if (errno != ENOSYS)
+			return -1;
+		no_recvmmsg = true;
+	}
+#endif
+	for (cnt = 0; cnt < (int)n; cnt++) {
+		len = recvmsg(dfd->fd, &rxb->msg[cnt].msg_hdr, MSG_DONTWAIT);
+		if (len < 0)
+			break;
+		rxb->msg[cnt].msg_len = len;
+	}
+	if (cnt == 0)
+		return -1;
+#ifdef HAVE_RECVMMSG
+out:
+#endif
+	for (i = 0; i < (unsigned int)cnt; i++)
+		dect_rx_batch_complete(dh, rxb, i);
+	return cnt;
+}
+
+int dect_rx_batch_init(struct dect_handle *dh)
+{
+	dh->rxb = dect_zalloc(dh, sizeof(*dh->rxb));
+	if (dh->rxb == NULL)
+		return -1;
+	return 0;
+}
+
+void dect_rx_batch_exit(struct dect_handle *dh)
+{
+	unsigned int i;
+
+	for (i = 0; i < DECT_RX_BATCH_SIZE; i++)
+		dect_mbuf_release_ext(dh, &dh->rxb->mb[i]);
+	dect_free(dh, dh->rxb);
+	dh->rxb = NULL;
+}
+
+/* Number of messages to receive per readiness event, see dect_ops::rx_budget */
+unsigned int dect_rx_budget(const struct dect_handle *dh)
+{
+	return dh->ops->rx_budget ? dh->ops->rx_budget : 1;
+}
+
+void dect_tx_batch_init(struct dect_tx_batch *txb)
+{
+	txb->cnt = 0;
+}
+
+/**
+ * dect_tx_batch_add - add a message buffer to a transmit batch
+ *
+ * @txb:	transmit batch
+ * @mb:		libdect message buffer
+ *
+ * Returns the message header of the new entry, which may be used to attach
+ * control messages using the per entry control buffer.
+ */
+struct msghdr *dect_tx_batch_add(struct dect_tx_batch *txb,
+				 struct dect_msg_buf *mb)
+{
+	unsigned int i = txb->cnt++;
+	struct msghdr *msg = &txb->msg[i].msg_hdr;
+
+	dect_assert(i < DECT_TX_BATCH_SIZE);
+	txb->mb[i]		= mb;
+	txb->iov[i].iov_base	= mb->data;
+	txb->iov[i].iov_len	= mb->len;
+
+	msg->msg_name		= NULL;
+	msg->msg_namelen	= 0;
+	msg->msg_iov		= &txb->iov[i];
+	msg->msg_iovlen		= 1;
+	msg->msg_control	= NULL;
+	msg->msg_controllen	= 0;
+	msg->msg_flags		= 0;
+	return msg;
+}
+
+/**
+ * dect_tx_batch_send - transmit a batch of messages
+ *
+ * @dh:		libdect DECT handle
+ * @txb:	transmit batch
+ * @dfd:	libdect file descriptor
+ *
+ * Transmit all messages of the batch through the handle's transport.
+ * Returns the number of messages transmitted, errno is set if transmission
+ * of a message failed.
+ */
+int dect_tx_batch_send(const struct dect_handle *dh,
+		       struct dect_tx_batch *txb, const struct dect_fd *dfd)
+{
+	return dh->transport->sendmmsg(dh, dfd, txb->msg, txb->cnt);
+}
+
+/*
+ * Kernel transport
+ */
+
+static int dect_kernel_socket(const struct dect_handle *dh, int type,
+			      int protocol)
+{
+	return socket(AF_DECT, type, protocol);
+}
+
+static int dect_kernel_bind(const struct dect_handle *dh, struct dect_fd *dfd,
+			    const struct sockaddr *addr, socklen_t len)
+{
+	return bind(dfd->fd, addr, len);
+}
+
+static int dect_kernel_connect(const struct dect_handle *dh,
+			       struct dect_fd *dfd,
+			       const struct sockaddr *addr, socklen_t len)
+{
+	return connect(dfd->fd, addr, len);
+}
+
+static int dect_kernel_listen(const struct dect_handle *dh,
+			      struct dect_fd *dfd, int backlog)
+{
+	return listen(dfd->fd, backlog);
+}
+
+static int dect_kernel_accept(const struct dect_handle *dh,
+			      const struct dect_fd *dfd,
+			      struct sockaddr *addr, socklen_t *len)
+{
+	return accept(dfd->fd, addr, len);
+}
+
+static int dect_kernel_getsockopt(const struct dect_handle *dh,
+				  const struct dect_fd *dfd, int level,
+				  int optname, void *optval, socklen_t *optlen)
+{
+	return getsockopt(dfd->fd, level, optname, optval, optlen);
+}
+
+static int dect_kernel_setsockopt(const struct dect_handle *dh,
+				  const struct dect_fd *dfd, int level,
+				  int optname, const void *optval,
+				  socklen_t optlen)
+{
+	return setsockopt(dfd->fd, level, optname, optval, optlen);
+}
+
+/*
+ * Transmit using sendmmsg() if supported by the kernel, otherwise fall back
+ * to one sendmsg() call per message.
+ */
+int dect_kernel_sendmmsg(const struct dect_handle *dh,
+			 const struct dect_fd *dfd,
+			 struct mmsghdr *msg, unsigned int vlen)
+{
+#ifdef HAVE_SENDMMSG
+	static bool no_sendmmsg;
+	int n;
+#endif
+	unsigned int cnt = 0;
+
+#ifdef HAVE_SENDMMSG
+	while (!no_sendmmsg && cnt < vlen) {
+		n = sendmmsg(dfd->fd, &msg[cnt], vlen - cnt, MSG_NOSIGNAL);
+		if (n < 0) {
+			if (errno != ENOSYS)
+				return cnt;
+			no_sendmmsg = true;
+			break;
+		}
+		cnt += n;
+	}
+#endif
+	for (; cnt < vlen; cnt++) {
+		if (sendmsg(dfd->fd, &msg[cnt].msg_hdr, MSG_NOSIGNAL) < 0)
+			break;
+	}
+	return cnt;
+}
+
+const struct dect_transport_ops dect_kernel_transport = {
+	.init		= dect_netlink_init,
+	.exit		= dect_netlink_exit,
+	.socket		= dect_kernel_socket,
+	.bind		= dect_kernel_bind,
+	.connect	= dect_kernel_connect,
+	.listen		= dect_kernel_listen,
+	.accept		= dect_kernel_accept,
+	.getsockopt	= dect_kernel_getsockopt,
+	.setsockopt	= dect_kernel_setsockopt,
+	.sendmmsg	= dect_kernel_sendmmsg,
+};
+
 /** @} */
 /** @} */
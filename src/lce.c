@@ -19,6 +19,7 @@
 #include <inttypes.h>
 #include <unistd.h>
 #include <string.h>
+#include <strings.h>
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
@@ -38,9 +39,11 @@
 #include <cc.h>
 #include <mm.h>
 #include <ss.h>
+#include <trace.h>
+#include <capture.h>
 #include <dect/auth.h>
 
-static DECT_SFMT_MSG_DESC(lce_page_response,
+DECT_SFMT_MSG_DESC(lce_page_response,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
@@ -49,7 +52,7 @@ static DECT_SFMT_MSG_DESC(lce_page_response,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(lce_page_reject,
+DECT_SFMT_MSG_DESC(lce_page_reject,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_OPTIONAL,  IE_NONE,      0),
@@ -75,19 +78,32 @@ void dect_lce_register_protocol(const struct dect_nwk_protocol *protocol)
  * @param dh	libdect DECT handle
  *
  * Allocate a libdect message buffer. The buffer needs to be released again
- * using dect_mbuf_free().
+ * using dect_mbuf_free(). Buffers are taken from the handle's message buffer
+ * pool if available, the allocator is only invoked when the pool is empty.
  */
 struct dect_msg_buf *dect_mbuf_alloc(const struct dect_handle *dh)
 {
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
 	struct dect_msg_buf *mb;
 
-	mb = dect_malloc(dh, sizeof(*mb));
-	if (mb == NULL)
-		return NULL;
+	mb = ptrlist_dequeue_head(&pool->free);
+	if (mb != NULL) {
+		pool->count--;
+		pool->stats.hits++;
+	} else {
+		pool->stats.misses++;
+		mb = dect_malloc(dh, sizeof(*mb));
+		if (mb == NULL)
+			return NULL;
+	}
+
 	memset(mb->head, 0, sizeof(mb->head));
 	mb->data   = mb->head;
+	mb->ext    = NULL;
+	mb->size   = 0;
 	mb->len    = 0;
 	mb->type   = 0;
+	mb->flags  = 0;
 	mb->refcnt = 1;
 	mb->next   = NULL;
 	return mb;
@@ -101,16 +117,82 @@ EXPORT_SYMBOL(dect_mbuf_alloc);
  * @param mb	libdect message buffer
  *
  * Release reference to a libdect message buffer. When the reference count
- * drops to zero, the buffer will be freed.
+ * drops to zero, the buffer is returned to the message buffer pool or freed
+ * if the pool has reached its high-water mark.
  */
 void dect_mbuf_free(const struct dect_handle *dh, struct dect_msg_buf *mb)
 {
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
+
 	if (--mb->refcnt > 0)
 		return;
+	dect_mbuf_release_ext(dh, mb);
+
+	if (pool->count < pool->max) {
+		mb->next   = pool->free;
+		pool->free = mb;
+		pool->count++;
+		return;
+	}
+
+	pool->stats.releases++;
 	dect_free(dh, mb);
 }
 EXPORT_SYMBOL(dect_mbuf_free);
 
+/**
+ * Get message buffer pool statistics
+ *
+ * @param dh	libdect DECT handle
+ * @param stats	statistics buffer
+ */
+void dect_mbuf_pool_stats(const struct dect_handle *dh,
+			  struct dect_mbuf_pool_stats *stats)
+{
+	*stats = dh->mbuf_pool->stats;
+	stats->cached = dh->mbuf_pool->count;
+}
+EXPORT_SYMBOL(dect_mbuf_pool_stats);
+
+static int dect_mbuf_pool_init(struct dect_handle *dh)
+{
+	struct dect_mbuf_pool *pool;
+	struct dect_msg_buf *mb;
+	unsigned int i;
+
+	pool = dect_zalloc(dh, sizeof(*pool));
+	if (pool == NULL)
+		return -1;
+
+	pool->max = dh->ops->mbuf_pool_max;
+	if (pool->max == 0)
+		pool->max = DECT_MBUF_POOL_MAX_DEFAULT;
+	if (pool->max < dh->ops->mbuf_pool_size)
+		pool->max = dh->ops->mbuf_pool_size;
+	dh->mbuf_pool = pool;
+
+	for (i = 0; i < dh->ops->mbuf_pool_size; i++) {
+		mb = dect_malloc(dh, sizeof(*mb));
+		if (mb == NULL)
+			break;
+		mb->next   = pool->free;
+		pool->free = mb;
+		pool->count++;
+	}
+	return 0;
+}
+
+static void dect_mbuf_pool_exit(struct dect_handle *dh)
+{
+	struct dect_mbuf_pool *pool = dh->mbuf_pool;
+	struct dect_msg_buf *mb;
+
+	while ((mb = ptrlist_dequeue_head(&pool->free)) != NULL)
+		dect_free(dh, mb);
+	dect_free(dh, pool);
+	dh->mbuf_pool = NULL;
+}
+
 /**
  * Pull data from the head of a libdect message buffer
  *
@@ -136,7 +218,7 @@ void *dect_mbuf_push(struct dect_msg_buf *mb, unsigned int len)
 {
 	mb->data -= len;
 	mb->len  += len;
-	dect_assert(mb->data >= mb->head);
+	dect_assert(mb->data >= dect_mbuf_start(mb));
 	return mb->data;
 }
 EXPORT_SYMBOL(dect_mbuf_push);
@@ -150,7 +232,7 @@ EXPORT_SYMBOL(dect_mbuf_push);
 void dect_mbuf_reserve(struct dect_msg_buf *mb, unsigned int len)
 {
 	mb->data += len;
-	dect_assert(mb->data < mb->head + sizeof(mb->head));
+	dect_assert(mb->data < dect_mbuf_end(mb));
 }
 EXPORT_SYMBOL(dect_mbuf_reserve);
 
@@ -159,39 +241,78 @@ EXPORT_SYMBOL(dect_mbuf_reserve);
  *
  * @param mb	libdect message buffer
  * @param len	amount of data to put
+ *
+ * The buffer must have at least @len bytes of tailroom, use dect_mbuf_expand()
+ * to make room for large messages.
  */
 void *dect_mbuf_put(struct dect_msg_buf *mb, unsigned int len)
 {
 	void *ptr = mb->data + mb->len;
+
+	dect_assert(len <= dect_mbuf_tailroom(mb));
 	mb->len += len;
 	return ptr;
 }
 EXPORT_SYMBOL(dect_mbuf_put);
 
-static ssize_t dect_mbuf_rcv(const struct dect_fd *dfd, struct msghdr *msg,
-			     struct dect_msg_buf *mb)
+/**
+ * Return the amount of space available at the tail of a libdect message buffer
+ *
+ * @param mb	libdect message buffer
+ */
+unsigned int dect_mbuf_tailroom(const struct dect_msg_buf *mb)
 {
-	struct iovec iov;
-	ssize_t len;
+	return dect_mbuf_end(mb) - (mb->data + mb->len);
+}
+EXPORT_SYMBOL(dect_mbuf_tailroom);
 
-	msg->msg_name		= NULL;
-	msg->msg_namelen	= 0;
-	msg->msg_iov		= &iov;
-	msg->msg_iovlen		= 1;
-	msg->msg_flags		= MSG_NOSIGNAL;
+/**
+ * Expand the tailroom of a libdect message buffer
+ *
+ * @param dh	libdect DECT handle
+ * @param mb	libdect message buffer
+ * @param len	amount of tailroom required
+ *
+ * Make sure the message buffer has room for at least @len more bytes of data.
+ * When the storage area is too small, the headroom and data are moved to a
+ * larger, zeroed external storage area, invalidating pointers into the
+ * buffer. The external storage area grows geometrically to keep the number
+ * of copies low when a message is built incrementally.
+ *
+ * @return 0 on success or -1 with errno set to EMSGSIZE or ENOMEM on error.
+ */
+int dect_mbuf_expand(const struct dect_handle *dh, struct dect_msg_buf *mb,
+		     unsigned int len)
+{
+	unsigned int headroom, size, cap;
+	uint8_t *ext;
 
-	iov.iov_base		= mb->data;
-	iov.iov_len		= sizeof(mb->head);
+	if (len <= dect_mbuf_tailroom(mb))
+		return 0;
 
-	len = recvmsg(dfd->fd, msg, 0);
-	if (len < 0) {
-		lce_debug("recvmsg: %s\n", strerror(errno));
-		return len;
+	headroom = mb->data - dect_mbuf_start(mb);
+	size = headroom + mb->len + len;
+	if (size > DECT_MSG_BUF_MAX_SIZE) {
+		errno = EMSGSIZE;
+		return -1;
 	}
+	cap  = dect_mbuf_end(mb) - dect_mbuf_start(mb);
+	size = min(max(size, 2 * cap), (unsigned int)DECT_MSG_BUF_MAX_SIZE);
 
-	mb->len = len;
-	return len;
+	ext = dect_malloc(dh, size);
+	if (ext == NULL)
+		return -1;
+	memcpy(ext, dect_mbuf_start(mb), headroom + mb->len);
+	memset(ext + headroom + mb->len, 0, size - headroom - mb->len);
+	lce_debug("mbuf %p: expand %u => %u bytes\n", mb, cap, size);
+
+	dect_mbuf_release_ext(dh, mb);
+	mb->ext  = ext;
+	mb->size = size;
+	mb->data = ext + headroom;
+	return 0;
 }
+EXPORT_SYMBOL(dect_mbuf_expand);
 
 static ssize_t dect_mbuf_send(const struct dect_handle *dh,
 			      const struct dect_fd *dfd,
@@ -228,18 +349,50 @@ static ssize_t dect_mbuf_send(const struct dect_handle *dh,
 		pos = dect_ie_hold(ie);		\
 	} while (0)
 
-static struct dect_lte *dect_lte_get_by_ipui(const struct dect_handle *dh,
-					     const struct dect_ipui *ipui)
+static unsigned int dect_lte_ipui_hash(const struct dect_ipui *ipui)
+{
+	return dect_ipui_hash(ipui) % DECT_LTE_HASH_SIZE;
+}
+
+static unsigned int dect_lte_tpui_hash(const struct dect_tpui *tpui)
+{
+	return dect_build_tpui(tpui) % DECT_LTE_HASH_SIZE;
+}
+
+/*
+ * Look up the location table entry of a PT. The entry contains both the
+ * assigned TPUI and the PT's capabilities, so a single lookup is sufficient
+ * to page a PT.
+ */
+struct dect_lte *dect_lte_get_by_ipui(const struct dect_handle *dh,
+				      const struct dect_ipui *ipui)
 {
 	struct dect_lte *lte;
+	struct hlist_node *pos;
 
-	list_for_each_entry(lte, &dh->ldb, list) {
+	hlist_for_each_entry(lte, pos, &dh->ldb[dect_lte_ipui_hash(ipui)], hnode) {
 		if (!dect_ipui_cmp(&lte->ipui, ipui))
 			return lte;
 	}
 	return NULL;
 }
 
+struct dect_lte *dect_lte_get_by_tpui(const struct dect_handle *dh,
+				      const struct dect_tpui *tpui)
+{
+	struct dect_lte *lte;
+	struct hlist_node *pos;
+	uint32_t t = dect_build_tpui(tpui);
+
+	hlist_for_each_entry(lte, pos, &dh->ldb_tpui[dect_lte_tpui_hash(tpui)],
+			     tpui_hnode) {
+		if (lte->tpui.type == tpui->type &&
+		    dect_build_tpui(&lte->tpui) == t)
+			return lte;
+	}
+	return NULL;
+}
+
 static struct dect_lte *dect_lte_alloc(struct dect_handle *dh,
 				       const struct dect_ipui *ipui)
 {
@@ -251,15 +404,24 @@ static struct dect_lte *dect_lte_alloc(struct dect_handle *dh,
 	memset(lte, 0, sizeof(*lte));
 	lte->ipui = *ipui;
 
-	list_add_tail(&lte->list, &dh->ldb);
+	hlist_add_head(&lte->hnode, &dh->ldb[dect_lte_ipui_hash(ipui)]);
 	return lte;
 }
 
+static void dect_lte_unhash_tpui(struct dect_lte *lte)
+{
+	if (!lte->tpui_valid)
+		return;
+	hlist_del(&lte->tpui_hnode);
+	lte->tpui_valid = false;
+}
+
 static void dect_lte_release(struct dect_handle *dh, struct dect_lte *lte)
 {
 	dect_ie_put(dh, lte->setup_capability);
 	dect_ie_put(dh, lte->terminal_capability);
-	list_del(&lte->list);
+	dect_lte_unhash_tpui(lte);
+	hlist_del(&lte->hnode);
 	dect_free(dh, lte);
 }
 
@@ -280,37 +442,37 @@ void dect_lte_update(struct dect_handle *dh, const struct dect_ipui *ipui,
 	dect_ie_update(lte->terminal_capability, terminal_capability);
 }
 
-void dect_lte_update_tpui(const struct dect_handle *dh,
+void dect_lte_update_tpui(struct dect_handle *dh,
 			  const struct dect_ipui *ipui,
 			  const struct dect_tpui *tpui)
 {
-	struct dect_lte *lte;
+	struct dect_lte *lte, *old;
 
 	lte = dect_lte_get_by_ipui(dh, ipui);
 	if (lte == NULL)
 		return;
+
+	/* An assigned TPUI identifies at most one PT */
+	old = dect_lte_get_by_tpui(dh, tpui);
+	if (old != NULL)
+		dect_lte_unhash_tpui(old);
+	dect_lte_unhash_tpui(lte);
+
 	lte->tpui	= *tpui;
 	lte->tpui_valid = true;
+	hlist_add_head(&lte->tpui_hnode, &dh->ldb_tpui[dect_lte_tpui_hash(tpui)]);
 }
 
-static const struct dect_tpui *dect_tpui(const struct dect_handle *dh,
-					 const struct dect_ipui *ipui)
+static const struct dect_tpui *dect_lte_tpui(const struct dect_lte *lte)
 {
-	const struct dect_lte *lte;
-
-	lte = dect_lte_get_by_ipui(dh, ipui);
 	if (lte == NULL || !lte->tpui_valid)
 		return NULL;
 	return &lte->tpui;
 }
 
 static enum dect_setup_capabilities
-dect_setup_capability(const struct dect_handle *dh,
-		      const struct dect_ipui *ipui)
+dect_lte_setup_capability(const struct dect_lte *lte)
 {
-	const struct dect_lte *lte;
-
-	lte = dect_lte_get_by_ipui(dh, ipui);
 	if (lte == NULL ||
 	    lte->setup_capability == NULL)
 		return DECT_SETUP_NO_FAST_SETUP;
@@ -318,12 +480,8 @@ dect_setup_capability(const struct dect_handle *dh,
 }
 
 static enum dect_page_capabilities
-dect_page_capability(const struct dect_handle *dh,
-		     const struct dect_ipui *ipui)
+dect_lte_page_capability(const struct dect_lte *lte)
 {
-	const struct dect_lte *lte;
-
-	lte = dect_lte_get_by_ipui(dh, ipui);
 	if (lte == NULL ||
 	    lte->setup_capability == NULL)
 		return DECT_PAGE_CAPABILITY_NORMAL_PAGING;
@@ -371,6 +529,11 @@ static const struct dect_trans_tbl dect_service_types[] = {
 	TRANS_TBL(DECT_SERVICE_IPQ_ERROR_DETECTION,	"Ipq_error_detection"),
 };
 
+static unsigned int dect_ddl_ipui_hash(const struct dect_ipui *ipui)
+{
+	return dect_ipui_hash(ipui) % DECT_DDL_HASH_SIZE;
+}
+
 int dect_ddl_set_ipui(struct dect_handle *dh, struct dect_data_link *ddl,
 		      const struct dect_ipui *ipui)
 {
@@ -383,6 +546,8 @@ int dect_ddl_set_ipui(struct dect_handle *dh, struct dect_data_link *ddl,
 
 		ddl->ipui   = *ipui;
 		ddl->flags |= DECT_DATA_LINK_IPUI_VALID;
+		hlist_add_head(&ddl->hnode,
+			       &dh->links_ipui[dect_ddl_ipui_hash(ipui)]);
 	}
 	return 0;
 }
@@ -391,26 +556,83 @@ static struct dect_data_link *dect_ddl_get_by_ipui(const struct dect_handle *dh,
 						   const struct dect_ipui *ipui)
 {
 	struct dect_data_link *ddl;
+	struct hlist_node *pos;
 
-	list_for_each_entry(ddl, &dh->links, list) {
-		if (ddl->flags & DECT_DATA_LINK_IPUI_VALID &&
+	hlist_for_each_entry(ddl, pos, &dh->links_ipui[dect_ddl_ipui_hash(ipui)],
+			     hnode) {
+		if (ddl->state != DECT_DATA_LINK_ESTABLISHED &&
+		    ddl->state != DECT_DATA_LINK_ESTABLISH_PENDING)
+			continue;
+		if (!dect_ipui_cmp(&ddl->ipui, ipui))
+			return ddl;
+	}
+	return NULL;
+}
+
+/*
+ * Pending indirect link establishments, used to match page responses to
+ * the link establishment requests.
+ */
+static void dect_ddl_page_hash(struct dect_handle *dh,
+			       struct dect_data_link *ddl)
+{
+	hlist_add_head(&ddl->page_hnode,
+		       &dh->links_page[dect_ddl_ipui_hash(&ddl->ipui)]);
+}
+
+static struct dect_data_link *
+dect_ddl_get_page_request(const struct dect_handle *dh,
+			  const struct dect_ipui *ipui)
+{
+	struct dect_data_link *ddl;
+	struct hlist_node *pos;
+
+	hlist_for_each_entry(ddl, pos, &dh->links_page[dect_ddl_ipui_hash(ipui)],
+			     page_hnode) {
+		if (ddl->state == DECT_DATA_LINK_ESTABLISH_PENDING &&
 		    !dect_ipui_cmp(&ddl->ipui, ipui))
 			return ddl;
 	}
 	return NULL;
 }
 
+static void dect_ddl_unhash(struct dect_data_link *ddl)
+{
+	hlist_del_init(&ddl->hnode);
+	hlist_del_init(&ddl->page_hnode);
+}
+
 static struct dect_transaction *
 dect_ddl_transaction_lookup(const struct dect_data_link *ddl, uint8_t pd,
 			    uint8_t tv, enum dect_transaction_role role)
 {
-	struct dect_transaction *ta;
+	return ddl->ta_table[pd][role][tv];
+}
 
-	list_for_each_entry(ta, &ddl->transactions, list) {
-		if (ta->pd == pd && ta->tv == tv && ta->role == role)
-			return ta;
-	}
-	return NULL;
+static void dect_ddl_transaction_hash(struct dect_data_link *ddl,
+				      struct dect_transaction *ta)
+{
+	dect_assert(ta->tv < DECT_TV_MAX);
+	dect_assert(ddl->ta_table[ta->pd][ta->role][ta->tv] == NULL);
+
+	ddl->ta_table[ta->pd][ta->role][ta->tv] = ta;
+	ddl->tv_map[ta->pd][ta->role] |= 1 << ta->tv;
+}
+
+static void dect_ddl_transaction_unhash(struct dect_data_link *ddl,
+					const struct dect_transaction *ta)
+{
+	ddl->ta_table[ta->pd][ta->role][ta->tv] = NULL;
+	ddl->tv_map[ta->pd][ta->role] &= ~(1 << ta->tv);
+}
+
+static void dect_ddl_set_state(const struct dect_handle *dh,
+			       struct dect_data_link *ddl,
+			       enum dect_data_link_states state)
+{
+	dect_trace(dh, DECT_TRACE_LCE_LINK_STATE, ddl, NULL,
+		   ddl->state, state, 0, 0);
+	ddl->state = state;
 }
 
 static struct dect_data_link *dect_ddl_alloc(const struct dect_handle *dh)
@@ -426,8 +648,9 @@ static struct dect_data_link *dect_ddl_alloc(const struct dect_handle *dh)
 	ddl->state = DECT_DATA_LINK_RELEASED;
 	init_list_head(&ddl->list);
 	init_list_head(&ddl->transactions);
-	ptrlist_init(&ddl->msg_queue);
+	ptrqueue_init(&ddl->msg_queue, DECT_DDL_MSG_QUEUE_MAX);
 	ddl_debug(ddl, "alloc");
+	dect_trace(dh, DECT_TRACE_LCE_LINK_ALLOC, ddl, NULL, 0, 0, 0, 0);
 	return ddl;
 
 err2:
@@ -442,6 +665,7 @@ static void dect_ddl_destroy(struct dect_handle *dh, struct dect_data_link *ddl)
 	unsigned int i;
 
 	ddl_debug(ddl, "destroy");
+	dect_trace(dh, DECT_TRACE_LCE_LINK_DESTROY, ddl, NULL, 0, 0, 0, 0);
 	dect_assert(list_empty(&ddl->transactions));
 
 	for (i = 0; i < array_size(protocols); i++) {
@@ -450,8 +674,9 @@ static void dect_ddl_destroy(struct dect_handle *dh, struct dect_data_link *ddl)
 	}
 
 	list_del(&ddl->list);
+	dect_ddl_unhash(ddl);
 
-	while ((mb = ptrlist_dequeue_head(&ddl->msg_queue)))
+	while ((mb = ptrqueue_dequeue(&ddl->msg_queue)))
 		dect_mbuf_free(dh, mb);
 
 	if (ddl->dfd != NULL) {
@@ -466,6 +691,16 @@ static void dect_ddl_destroy(struct dect_handle *dh, struct dect_data_link *ddl)
 	if (ddl->release_timer != NULL && dect_timer_running(ddl->release_timer))
 		dect_timer_stop(dh, ddl->release_timer);
 	dect_timer_free(dh, ddl->release_timer);
+
+	if (ddl->page_timer != NULL && dect_timer_running(ddl->page_timer))
+		dect_timer_stop(dh, ddl->page_timer);
+	dect_timer_free(dh, ddl->page_timer);
+
+	/* Freeing is deferred while processing socket events for the link */
+	if (ddl->flags & DECT_DATA_LINK_BUSY) {
+		ddl->flags |= DECT_DATA_LINK_DESTROYED;
+		return;
+	}
 	dect_free(dh, ddl);
 }
 
@@ -481,7 +716,7 @@ static void dect_ddl_release_complete(struct dect_handle *dh,
 				      struct dect_data_link *ddl)
 {
 	ddl_debug(ddl, "normal release complete");
-	ddl->state = DECT_DATA_LINK_RELEASED;
+	dect_ddl_set_state(dh, ddl, DECT_DATA_LINK_RELEASED);
 	dect_timer_stop(dh, ddl->release_timer);
 	dect_ddl_destroy(dh, ddl);
 }
@@ -496,7 +731,7 @@ static void dect_ddl_release(struct dect_handle *dh,
 	 */
 	if (shutdown(ddl->dfd->fd, SHUT_WR) < 0)
 		goto err1;
-	ddl->state = DECT_DATA_LINK_RELEASE_PENDING;
+	dect_ddl_set_state(dh, ddl, DECT_DATA_LINK_RELEASE_PENDING);
 
 	ddl->release_timer = dect_timer_alloc(dh);
 	if (ddl->release_timer == NULL)
@@ -539,7 +774,7 @@ static void dect_ddl_shutdown(struct dect_handle *dh,
 	bool last = false;
 
 	ddl_debug(ddl, "shutdown");
-	ddl->state = DECT_DATA_LINK_RELEASED;
+	dect_ddl_set_state(dh, ddl, DECT_DATA_LINK_RELEASED);
 
 	/* If no transactions are present, the link is waiting for a partial
 	 * release timeout. Destroy immediately since destruction won't be
@@ -560,17 +795,19 @@ static void dect_ddl_shutdown(struct dect_handle *dh,
 /**
  * dect_ddl_set_cipher_key - set cipher key for datalink
  *
+ * @param dh		libdect DECT handle
  * @param ddl		Datalink
  * @param ck		Cipher key
  */
-int dect_ddl_set_cipher_key(const struct dect_data_link *ddl,
+int dect_ddl_set_cipher_key(const struct dect_handle *dh,
+			    const struct dect_data_link *ddl,
 			    const uint8_t ck[DECT_CIPHER_KEY_LEN])
 {
 	int err;
 
 	ddl_debug(ddl, "DL_ENC_KEY-req: %.16" PRIx64, *(uint64_t *)ck);
-	err = setsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_ENC_KEY,
-			 ck, DECT_CIPHER_KEY_LEN);
+	err = dect_setsockopt(dh, ddl->dfd, SOL_DECT, DECT_DL_ENC_KEY,
+			      ck, DECT_CIPHER_KEY_LEN);
 	if (err != 0)
 		ddl_debug(ddl, "setsockopt: %s", strerror(errno));
 	return err;
@@ -579,18 +816,20 @@ int dect_ddl_set_cipher_key(const struct dect_data_link *ddl,
 /**
  * dect_ddl_encrypt_req - enable/disable encryption for a datalink
  *
+ * @param dh		libdect DECT handle
  * @param ddl		Datalink
  * @param status	desired ciphering state (enabled/disabled)
  */
-int dect_ddl_encrypt_req(const struct dect_data_link *ddl,
+int dect_ddl_encrypt_req(const struct dect_handle *dh,
+			 const struct dect_data_link *ddl,
 			 enum dect_cipher_states status)
 {
 	struct dect_dl_encrypt dle = { .status = status };
 	int err;
 
 	ddl_debug(ddl, "DL_ENCRYPT-req: status: %u\n", status);
-	err = setsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_ENCRYPT,
-			 &dle, sizeof(dle));
+	err = dect_setsockopt(dh, ddl->dfd, SOL_DECT, DECT_DL_ENCRYPT,
+			      &dle, sizeof(dle));
 	if (err != 0)
 		ddl_debug(ddl, "setsockopt: %s", strerror(errno));
 	return err;
@@ -634,23 +873,125 @@ static void dect_ddl_stop_sdu_timer(const struct dect_handle *dh,
 	dect_timer_stop(dh, ddl->sdu_timer);
 }
 
+/* Change the events the link socket is registered for */
+static void dect_ddl_register(const struct dect_handle *dh,
+			      struct dect_data_link *ddl, uint32_t events)
+{
+	dect_fd_unregister(dh, ddl->dfd);
+	if (dect_fd_register(dh, ddl->dfd, events) == 0) {
+		if (events & DECT_FD_WRITE)
+			ddl->flags |= DECT_DATA_LINK_TX_BLOCKED;
+		else
+			ddl->flags &= ~DECT_DATA_LINK_TX_BLOCKED;
+		return;
+	}
+
+	ddl_debug(ddl, "register: %s", strerror(errno));
+	if (events != DECT_FD_READ)
+		dect_fd_register(dh, ddl->dfd, DECT_FD_READ);
+}
+
 static ssize_t dect_ddl_send(const struct dect_handle *dh,
-			     const struct dect_data_link *ddl,
+			     struct dect_data_link *ddl,
 			     struct dect_msg_buf *mb)
 {
 	struct msghdr msg;
 	ssize_t size;
 
+	/* Messages waiting for the socket to become writable go first */
+	if (!ptrqueue_empty(&ddl->msg_queue)) {
+		if (ptrqueue_enqueue(&ddl->msg_queue, mb))
+			return 0;
+		ddl_debug(ddl, "message queue full, dropped %u messages",
+			  ddl->msg_queue.drops);
+		dect_mbuf_free(dh, mb);
+		return -1;
+	}
+
 	memset(&msg, 0, sizeof(msg));
 	dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: TX");
 	size = dect_mbuf_send(dh, ddl->dfd, &msg, mb);
+	if (size < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) &&
+	    ptrqueue_enqueue(&ddl->msg_queue, mb)) {
+		dect_ddl_register(dh, ddl, DECT_FD_READ | DECT_FD_WRITE);
+		return 0;
+	}
+	dect_trace_msg(dh, DECT_TRACE_LCE_TX, ddl, NULL, mb->len, size,
+		       mb->data, mb->len);
+	dect_capture_mbuf(dh, DECT_CAPTURE_S_SAP, DECT_CAPTURE_TX, 0,
+			  &ddl->dlei, NULL, mb);
 	dect_mbuf_free(dh, mb);
 	return size;
 }
 
+/*
+ * Transmit queued messages in batches. Messages that can't be transmitted
+ * without blocking remain queued until the socket has become writable,
+ * messages failing otherwise are dropped.
+ */
+static void dect_ddl_flush_queue(const struct dect_handle *dh,
+				 struct dect_data_link *ddl)
+{
+	struct dect_mbuf_queue *queue = &ddl->msg_queue;
+	struct dect_tx_batch txb;
+	struct dect_msg_buf *mb;
+	unsigned int i, cnt;
+	bool full = false;
+	int n;
+
+	while (!full && !ptrqueue_empty(queue)) {
+		dect_tx_batch_init(&txb);
+		for (mb = ptrqueue_peek(queue);
+		     mb != NULL && !dect_tx_batch_full(&txb); mb = mb->next)
+			dect_tx_batch_add(&txb, mb);
+
+		n = dect_tx_batch_send(dh, &txb, ddl->dfd);
+		cnt = n;
+		if (cnt < txb.cnt) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				full = true;
+			else {
+				ddl_debug(ddl, "sendmmsg: %s", strerror(errno));
+				queue->drops++;
+				cnt++;
+			}
+		}
+
+		for (i = 0; i < cnt; i++) {
+			mb = ptrqueue_dequeue(queue);
+			if (i < (unsigned int)n) {
+				dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: TX");
+				dect_trace_msg(dh, DECT_TRACE_LCE_TX, ddl, NULL,
+					       mb->len, mb->len, mb->data,
+					       mb->len);
+				dect_capture_mbuf(dh, DECT_CAPTURE_S_SAP,
+						  DECT_CAPTURE_TX, 0,
+						  &ddl->dlei, NULL, mb);
+			}
+			dect_mbuf_free(dh, mb);
+		}
+	}
+
+	if (full && !(ddl->flags & DECT_DATA_LINK_TX_BLOCKED))
+		dect_ddl_register(dh, ddl, DECT_FD_READ | DECT_FD_WRITE);
+	else if (!full && ddl->flags & DECT_DATA_LINK_TX_BLOCKED)
+		dect_ddl_register(dh, ddl, DECT_FD_READ);
+}
+
+static void dect_lce_build_hdr(const struct dect_transaction *ta,
+			       uint8_t type, uint8_t *hdr)
+{
+	hdr[1]  = type;
+	hdr[0]  = ta->pd;
+	hdr[0] |= ta->tv << DECT_S_TI_TV_SHIFT;
+	if (ta->role == DECT_TRANSACTION_RESPONDER)
+		hdr[0] |= DECT_S_TI_F_FLAG;
+}
+
 static struct dect_msg_buf *
 dect_lce_build_msg(const struct dect_handle *dh,
 		   const struct dect_transaction *ta,
+		   struct dect_sfmt_msg_tmpl *tmpl,
 		   const struct dect_sfmt_msg_desc *desc,
 		   const struct dect_msg_common *msg, uint8_t type)
 {
@@ -662,16 +1003,14 @@ dect_lce_build_msg(const struct dect_handle *dh,
 		goto err1;
 
 	dect_mbuf_reserve(mb, DECT_S_HDR_SIZE);
-	err = dect_build_sfmt_msg(dh, desc, msg, mb);
+	if (tmpl != NULL)
+		err = dect_build_sfmt_msg_tmpl(dh, tmpl, desc, msg, mb);
+	else
+		err = dect_build_sfmt_msg(dh, desc, msg, mb);
 	if (err < 0)
 		goto err2;
 
-	dect_mbuf_push(mb, DECT_S_HDR_SIZE);
-	mb->data[1]  = type;
-	mb->data[0]  = ta->pd;
-	mb->data[0] |= ta->tv << DECT_S_TI_TV_SHIFT;
-	if (ta->role == DECT_TRANSACTION_RESPONDER)
-		mb->data[0] |= DECT_S_TI_F_FLAG;
+	dect_lce_build_hdr(ta, type, dect_mbuf_push(mb, DECT_S_HDR_SIZE));
 	return mb;
 
 err2:
@@ -680,18 +1019,16 @@ err1:
 	return NULL;
 }
 
-/**
- * dect_lce_send - Queue a S-Format message for transmission to the LCE
- */
-int dect_lce_send(const struct dect_handle *dh,
-		  struct dect_transaction *ta,
-		  const struct dect_sfmt_msg_desc *desc,
-		  const struct dect_msg_common *msg, uint8_t type)
+static int __dect_lce_send(const struct dect_handle *dh,
+			   struct dect_transaction *ta,
+			   struct dect_sfmt_msg_tmpl *tmpl,
+			   const struct dect_sfmt_msg_desc *desc,
+			   const struct dect_msg_common *msg, uint8_t type)
 {
 	struct dect_data_link *ddl = ta->link;
 	struct dect_msg_buf *mb;
 
-	mb = dect_lce_build_msg(dh, ta, desc, msg, type);
+	mb = dect_lce_build_msg(dh, ta, tmpl, desc, msg, type);
 	if (mb == NULL)
 		return -1;
 
@@ -707,12 +1044,113 @@ int dect_lce_send(const struct dect_handle *dh,
 	case DECT_DATA_LINK_ESTABLISHED:
 		return dect_ddl_send(dh, ddl, mb);
 	case DECT_DATA_LINK_ESTABLISH_PENDING:
-		ptrlist_add_tail(mb, &ddl->msg_queue);
+		if (!ptrqueue_enqueue(&ddl->msg_queue, mb))
+			goto err_queue;
 		return 0;
 	default:
 		ddl_debug(ddl, "Invalid state: %u\n", ddl->state);
 		BUG();
 	}
+
+err_queue:
+	ddl_debug(ddl, "message queue full, dropped %u messages",
+		  ddl->msg_queue.drops);
+	dect_mbuf_free(dh, mb);
+	return -1;
+}
+
+/**
+ * dect_lce_send - Queue a S-Format message for transmission to the LCE
+ */
+int dect_lce_send(const struct dect_handle *dh,
+		  struct dect_transaction *ta,
+		  const struct dect_sfmt_msg_desc *desc,
+		  const struct dect_msg_common *msg, uint8_t type)
+{
+	return __dect_lce_send(dh, ta, NULL, desc, msg, type);
+}
+
+/**
+ * dect_lce_send_tmpl - Queue a S-Format message constructed from a template
+ *
+ * The message is constructed using the handle's message template @tmpl,
+ * which is rebuilt whenever the message's set of IEs differs from the one
+ * it was built for.
+ */
+int dect_lce_send_tmpl(const struct dect_handle *dh,
+		       struct dect_transaction *ta,
+		       enum dect_lce_msg_tmpls tmpl,
+		       const struct dect_sfmt_msg_desc *desc,
+		       const struct dect_msg_common *msg, uint8_t type)
+{
+	return __dect_lce_send(dh, ta, &dh->msg_tmpl[tmpl], desc, msg, type);
+}
+
+/**
+ * dect_lce_send_iov - Transmit a S-Format message without copying large IEs
+ *
+ * Large IE payloads, like display text or IWU data, are passed to the socket
+ * directly instead of being copied into the message buffer. The message is
+ * not kept for retransmission, so this may only be used by protocols that
+ * don't retransmit messages. Messages for links not established yet or
+ * waiting for the socket to become writable are queued by dect_lce_send().
+ */
+int dect_lce_send_iov(const struct dect_handle *dh,
+		      struct dect_transaction *ta,
+		      const struct dect_sfmt_msg_desc *desc,
+		      const struct dect_msg_common *msg, uint8_t type)
+{
+	struct dect_data_link *ddl = ta->link;
+	struct dect_sfmt_iov iov;
+	struct dect_msg_buf *mb;
+	struct msghdr mh;
+	unsigned int i;
+	ssize_t size;
+
+	if (ddl->state != DECT_DATA_LINK_ESTABLISHED ||
+	    !ptrqueue_empty(&ddl->msg_queue))
+		return dect_lce_send(dh, ta, desc, msg, type);
+
+	mb = dect_mbuf_alloc(dh);
+	if (mb == NULL)
+		goto err1;
+
+	dect_lce_build_hdr(ta, type, dect_mbuf_put(mb, DECT_S_HDR_SIZE));
+	dect_sfmt_iov_init(&iov, mb);
+	if (dect_build_sfmt_msg_iov(dh, desc, msg, &iov) < 0)
+		goto err2;
+
+	if (ddl->sdu_timer && dect_timer_running(ddl->sdu_timer))
+		dect_ddl_stop_sdu_timer(dh, ddl);
+
+	if (ta->mb != NULL) {
+		dect_mbuf_free(dh, ta->mb);
+		ta->mb = NULL;
+	}
+
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_iov    = iov.iov;
+	mh.msg_iovlen = iov.cnt;
+
+	for (i = 0; i < iov.cnt; i++)
+		dect_hexdump(DECT_DEBUG_LCE, "LCE: TX",
+			     iov.iov[i].iov_base, iov.iov[i].iov_len);
+
+	size = sendmsg(ddl->dfd->fd, &mh, MSG_NOSIGNAL);
+	if (size < 0)
+		lce_debug("sendmsg: %u bytes: %s\n", iov.len, strerror(errno));
+	dect_trace_msg(dh, DECT_TRACE_LCE_TX, ddl, ta, iov.len, size,
+		       iov.iov[0].iov_base, iov.iov[0].iov_len);
+	dect_capture_iov(dh, DECT_CAPTURE_S_SAP, DECT_CAPTURE_TX, 0,
+			 &ddl->dlei, NULL, iov.iov, iov.cnt);
+
+	dect_mbuf_free(dh, mb);
+	return size;
+
+err2:
+	dect_mbuf_free(dh, mb);
+err1:
+	return -1;
 }
 
 int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui,
@@ -731,7 +1169,7 @@ int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui,
 	if (ddl == NULL)
 		return -1;
 
-	mb = dect_lce_build_msg(dh, &ta, desc, msg, type);
+	mb = dect_lce_build_msg(dh, &ta, NULL, desc, msg, type);
 	if (mb == NULL)
 		return -1;
 
@@ -739,12 +1177,19 @@ int dect_lce_send_cl(struct dect_handle *dh, const struct dect_ipui *ipui,
 	case DECT_DATA_LINK_ESTABLISHED:
 		return dect_ddl_send(dh, ddl, mb);
 	case DECT_DATA_LINK_ESTABLISH_PENDING:
-		ptrlist_add_tail(mb, &ddl->msg_queue);
+		if (!ptrqueue_enqueue(&ddl->msg_queue, mb))
+			goto err_queue;
 		return 0;
 	default:
 		ddl_debug(ddl, "Invalid state: %u\n", ddl->state);
 		BUG();
 	}
+
+err_queue:
+	ddl_debug(ddl, "message queue full, dropped %u messages",
+		  ddl->msg_queue.drops);
+	dect_mbuf_free(dh, mb);
+	return -1;
 }
 
 int dect_lce_retransmit(const struct dect_handle *dh,
@@ -752,7 +1197,8 @@ int dect_lce_retransmit(const struct dect_handle *dh,
 {
 	struct dect_data_link *ddl = ta->link;
 
-	if (ta->mb != NULL &&
+	/* A message still queued for transmission holds a second reference */
+	if (ta->mb != NULL && ta->mb->refcnt == 1 &&
 	    ddl->state == DECT_DATA_LINK_ESTABLISHED) {
 		ta->mb->refcnt++;
 		return dect_ddl_send(dh, ddl, ta->mb);
@@ -760,38 +1206,35 @@ int dect_lce_retransmit(const struct dect_handle *dh,
 		return 0;
 }
 
-static void dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl)
+static void dect_ddl_rcv_error(struct dect_handle *dh,
+			       struct dect_data_link *ddl)
+{
+	switch (errno) {
+	case ENOTCONN:
+		if (ddl->state == DECT_DATA_LINK_RELEASE_PENDING)
+			return dect_ddl_release_complete(dh, ddl);
+		else
+			return dect_ddl_shutdown(dh, ddl);
+	case ETIMEDOUT:
+	case ECONNRESET:
+	case EHOSTUNREACH:
+		return dect_ddl_shutdown(dh, ddl);
+	default:
+		ddl_debug(ddl, "unhandled receive error: %s",
+			  strerror(errno));
+		BUG();
+	}
+}
+
+static void dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl,
+			     struct msghdr *msg, struct dect_msg_buf *mb)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
 	struct dect_transaction *ta;
-	struct msghdr msg;
 	struct cmsghdr *cmsg;
-	char cmsg_buf[4 * CMSG_SPACE(16)];
 	uint8_t pd, tv;
 	bool f;
 
-	msg.msg_control		= cmsg_buf;
-	msg.msg_controllen	= sizeof(cmsg_buf);
-
-	if (dect_mbuf_rcv(ddl->dfd, &msg, mb) < 0) {
-		switch (errno) {
-		case ENOTCONN:
-			if (ddl->state == DECT_DATA_LINK_RELEASE_PENDING)
-				return dect_ddl_release_complete(dh, ddl);
-			else
-				return dect_ddl_shutdown(dh, ddl);
-		case ETIMEDOUT:
-		case ECONNRESET:
-		case EHOSTUNREACH:
-			return dect_ddl_shutdown(dh, ddl);
-		default:
-			ddl_debug(ddl, "unhandled receive error: %s",
-				  strerror(errno));
-			BUG();
-		}
-	}
-
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
 		const struct dect_dl_encrypt *dle;
 
 		if (cmsg->cmsg_level != SOL_DECT)
@@ -811,6 +1254,10 @@ static void dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl)
 	}
 
 	dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: RX");
+	dect_trace_msg(dh, DECT_TRACE_LCE_RX, ddl, NULL, mb->len, 0,
+		       mb->data, mb->len);
+	dect_capture_mbuf(dh, DECT_CAPTURE_S_SAP, DECT_CAPTURE_RX, 0,
+			  &ddl->dlei, NULL, mb);
 
 	if (mb->len < DECT_S_HDR_SIZE)
 		return;
@@ -855,7 +1302,6 @@ static void dect_ddl_rcv_msg(struct dect_handle *dh, struct dect_data_link *ddl)
 static void dect_ddl_complete_direct_establish(struct dect_handle *dh,
 					       struct dect_data_link *ddl)
 {
-	struct dect_msg_buf *mb;
 	socklen_t optlen;
 	char buf1[128], buf2[128], buf3[128];
 
@@ -864,11 +1310,11 @@ static void dect_ddl_complete_direct_establish(struct dect_handle *dh,
 		goto err1;
 
 	optlen = sizeof(ddl->mcp);
-	if (getsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
-		       &ddl->mcp, &optlen))
+	if (dect_getsockopt(dh, ddl->dfd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
+			    &ddl->mcp, &optlen))
 		goto err1;
 
-	ddl->state = DECT_DATA_LINK_ESTABLISHED;
+	dect_ddl_set_state(dh, ddl, DECT_DATA_LINK_ESTABLISHED);
 	ddl_debug(ddl, "complete direct link establishment");
 
 	ddl_debug(ddl, "MAC connection: type: %s service: %s slot: %s",
@@ -880,8 +1326,7 @@ static void dect_ddl_complete_direct_establish(struct dect_handle *dh,
 	dh->ops->lce_ops->dl_establish_cfm(dh, true, ddl, &ddl->mcp);
 
 	/* Send queued messages */
-	while ((mb = ptrlist_dequeue_head(&ddl->msg_queue)))
-		dect_ddl_send(dh, ddl, mb);
+	dect_ddl_flush_queue(dh, ddl);
 	return;
 
 err1:
@@ -899,6 +1344,7 @@ static void dect_ddl_complete_indirect_establish(struct dect_handle *dh,
 	/* Stop page timer */
 	dect_timer_stop(dh, req->page_timer);
 	dect_timer_free(dh, req->page_timer);
+	req->page_timer = NULL;
 
 	ddl_debug(ddl, "complete indirect link establishment req %p", req);
 	dect_ddl_set_ipui(dh, ddl, &req->ipui);
@@ -908,16 +1354,23 @@ static void dect_ddl_complete_indirect_establish(struct dect_handle *dh,
 			protocols[i]->rebind(dh, req, ddl);
 	}
 
-	/* Transfer transactions to the new link */
+	/* Transfer transactions to the new link. The new link only carries
+	 * the LCE page response transaction, appending the transactions
+	 * of the pending link preserves their shutdown order. */
 	list_for_each_entry_safe(ta, ta_next, &req->transactions, list) {
 		ddl_debug(ta->link, "transfer transaction to link %p", ddl);
+		dect_ddl_transaction_unhash(req, ta);
 		list_move_tail(&ta->list, &ddl->transactions);
 		ta->link = ddl;
+		dect_ddl_transaction_hash(ddl, ta);
 	}
 
 	/* Send queued messages */
-	while ((mb = ptrlist_dequeue_head(&req->msg_queue)))
-		dect_ddl_send(dh, ddl, mb);
+	while ((mb = ptrqueue_dequeue(&req->msg_queue)) != NULL) {
+		if (!ptrqueue_enqueue(&ddl->msg_queue, mb))
+			dect_mbuf_free(dh, mb);
+	}
+	dect_ddl_flush_queue(dh, ddl);
 
 	/* Release pending link */
 	dect_ddl_destroy(dh, req);
@@ -952,16 +1405,18 @@ static struct dect_data_link *dect_ddl_establish(struct dect_handle *dh,
 	ddl = dect_ddl_alloc(dh);
 	if (ddl == NULL)
 		goto err1;
-	ddl->mcp   = mcp ? *mcp : default_mcp;
-	ddl->state = DECT_DATA_LINK_ESTABLISH_PENDING;
+	ddl->mcp = mcp ? *mcp : default_mcp;
+	dect_ddl_set_state(dh, ddl, DECT_DATA_LINK_ESTABLISH_PENDING);
 	dect_ddl_set_ipui(dh, ddl, ipui);
 
 	if (dh->mode == DECT_MODE_FP &&
-	    dect_setup_capability(dh, ipui) == DECT_SETUP_NO_FAST_SETUP) {
+	    dect_lte_setup_capability(dect_lte_get_by_ipui(dh, ipui)) ==
+	    DECT_SETUP_NO_FAST_SETUP) {
 		ddl->page_timer = dect_timer_alloc(dh);
 		if (ddl->page_timer == NULL)
 			goto err2;
 		dect_timer_setup(ddl->page_timer, dect_ddl_page_timer, ddl);
+		dect_ddl_page_hash(dh, ddl);
 		dect_ddl_page_timer(dh, ddl->page_timer);
 	} else {
 		ddl->dfd = dect_socket(dh, SOCK_SEQPACKET, DECT_S_SAP);
@@ -976,16 +1431,18 @@ static struct dect_data_link *dect_ddl_establish(struct dect_handle *dh,
 		ddl->dlei.dect_sapi = 0;
 
 		if (mcp != NULL &&
-		    setsockopt(ddl->dfd->fd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
-			       mcp, sizeof(*mcp)) < 0)
+		    dect_setsockopt(dh, ddl->dfd, SOL_DECT,
+				    DECT_DL_MAC_CONN_PARAMS,
+				    mcp, sizeof(*mcp)) < 0)
 			goto err2;
 
 		dect_fd_setup(ddl->dfd, dect_lce_data_link_event, ddl);
+		ddl->dfd->flags |= DECT_FD_DRAIN;
 		if (dect_fd_register(dh, ddl->dfd, DECT_FD_WRITE) < 0)
 			goto err2;
 
-		if (connect(ddl->dfd->fd, (struct sockaddr *)&ddl->dlei,
-			    sizeof(ddl->dlei)) < 0 && errno != EAGAIN)
+		if (dect_connect(dh, ddl->dfd, (struct sockaddr *)&ddl->dlei,
+				 sizeof(ddl->dlei)) < 0 && errno != EAGAIN)
 			goto err3;
 	}
 
@@ -995,6 +1452,10 @@ static struct dect_data_link *dect_ddl_establish(struct dect_handle *dh,
 err3:
 	dect_fd_unregister(dh, ddl->dfd);
 err2:
+	if (ddl->dfd != NULL)
+		dect_close(dh, ddl->dfd);
+	dect_ddl_unhash(ddl);
+	dect_timer_free(dh, ddl->sdu_timer);
 	dect_free(dh, ddl);
 err1:
 	lce_debug("dect_ddl_establish: %s\n", strerror(errno));
@@ -1022,35 +1483,82 @@ struct dect_data_link *dect_ddl_connect(struct dect_handle *dh,
 	return ddl;
 }
 
+/*
+ * Receive up to rx_budget messages from the link. Processing a message may
+ * destroy the link, in which case the remaining messages are discarded.
+ */
+static void dect_ddl_rcv(struct dect_handle *dh, struct dect_data_link *ddl)
+{
+	struct dect_rx_batch *rxb = dh->rxb;
+	unsigned int budget, i;
+	int n;
+
+	budget = dect_rx_budget(dh);
+	while (budget > 0) {
+		n = dect_rx_batch_rcv(dh, ddl->dfd, budget);
+		if (n < 0) {
+			if (errno != EAGAIN)
+				dect_ddl_rcv_error(dh, ddl);
+			return;
+		}
+
+		for (i = 0; i < (unsigned int)n; i++) {
+			dect_ddl_rcv_msg(dh, ddl, &rxb->msg[i].msg_hdr, &rxb->mb[i]);
+
+			/* Close the page transaction after receiving the first
+			 * message, which is expected to initiate a higher layer
+			 * protocol transaction or reject the page response.
+			 */
+			if (dh->page_transaction.state == DECT_TRANSACTION_OPEN) {
+				dect_debug(DECT_DEBUG_LCE, "\n");
+				dect_transaction_close(dh, &dh->page_transaction,
+						       DECT_DDL_RELEASE_NORMAL);
+			}
+
+			if (ddl->flags & DECT_DATA_LINK_DESTROYED)
+				return;
+		}
+
+		/* Socket queue drained */
+		if ((unsigned int)n < min(budget, (unsigned int)DECT_RX_BATCH_SIZE))
+			return;
+		budget -= n;
+	}
+
+	/* Budget exhausted, more messages may be queued */
+	ddl->dfd->flags |= DECT_FD_PENDING;
+}
+
 static void dect_lce_data_link_event(struct dect_handle *dh,
 				     struct dect_fd *dfd, uint32_t events)
 {
 	struct dect_data_link *ddl = dfd->data;
 
 	dect_debug(DECT_DEBUG_LCE, "\n");
+
+	/* Defer freeing the link until all events have been processed */
+	ddl->flags |= DECT_DATA_LINK_BUSY;
+
 	if (events & DECT_FD_WRITE) {
 		switch (ddl->state) {
 		case DECT_DATA_LINK_ESTABLISH_PENDING:
 			dect_ddl_complete_direct_establish(dh, ddl);
 			break;
+		case DECT_DATA_LINK_ESTABLISHED:
+			dect_ddl_flush_queue(dh, ddl);
+			break;
 		default:
 			break;
 		}
 	}
 
-	if (events & DECT_FD_READ) {
-		dect_ddl_rcv_msg(dh, ddl);
+	if (events & DECT_FD_READ &&
+	    !(ddl->flags & DECT_DATA_LINK_DESTROYED))
+		dect_ddl_rcv(dh, ddl);
 
-		/* Close the page transaction after receiving the first
-		 * message, which is expected to initiate a higher layer
-		 * protocol transaction or reject the page response.
-		 */
-		if (dh->page_transaction.state == DECT_TRANSACTION_OPEN) {
-			dect_debug(DECT_DEBUG_LCE, "\n");
-			dect_transaction_close(dh, &dh->page_transaction,
-					       DECT_DDL_RELEASE_NORMAL);
-		}
-	}
+	ddl->flags &= ~DECT_DATA_LINK_BUSY;
+	if (ddl->flags & DECT_DATA_LINK_DESTROYED)
+		dect_free(dh, ddl);
 }
 
 static void dect_lce_ssap_listener_event(struct dect_handle *dh,
@@ -1073,15 +1581,16 @@ static void dect_lce_ssap_listener_event(struct dect_handle *dh,
 	ddl->dfd = nfd;
 
 	optlen = sizeof(ddl->mcp);
-	if (getsockopt(nfd->fd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
-		       &ddl->mcp, &optlen))
+	if (dect_getsockopt(dh, nfd, SOL_DECT, DECT_DL_MAC_CONN_PARAMS,
+			    &ddl->mcp, &optlen))
 		goto err3;
 
 	dect_fd_setup(nfd, dect_lce_data_link_event, ddl);
+	nfd->flags |= DECT_FD_DRAIN;
 	if (dect_fd_register(dh, nfd, DECT_FD_READ) < 0)
 		goto err3;
 
-	ddl->state = DECT_DATA_LINK_ESTABLISHED;
+	dect_ddl_set_state(dh, ddl, DECT_DATA_LINK_ESTABLISHED);
 	if (dect_ddl_schedule_sdu_timer(dh, ddl) < 0)
 		goto err4;
 
@@ -1110,45 +1619,234 @@ err1:
  * Paging
  */
 
-ssize_t dect_lce_broadcast(const struct dect_handle *dh,
-			   const struct dect_msg_buf *mb,
-			   bool long_page, bool fast_page)
+/*
+ * Broadcast messages issued while processing an event, like the page
+ * retransmissions of all timers expiring in the same tick, are queued and
+ * transmitted in a single batch once the event has been processed. Outside
+ * of event processing they are transmitted directly. If the B-SAP socket
+ * is full, they remain queued until it has become writable again.
+ */
+enum dect_bcast_flags {
+	DECT_BCAST_LONG_PAGE	= 0x1,
+	DECT_BCAST_FAST_PAGE	= 0x2,
+};
+
+static void dect_lce_bcast_add(struct dect_tx_batch *txb,
+			       struct dect_msg_buf *mb)
 {
-	struct msghdr msg;
 	struct dect_bsap_auxdata aux;
 	struct cmsghdr *cmsg;
-	union {
-		struct cmsghdr		cmsg;
-		char			buf[CMSG_SPACE(sizeof(aux))];
-	} cmsg_buf;
-	ssize_t size;
+	struct msghdr *msg;
+	unsigned int i;
 
-	if (long_page) {
-		memset(cmsg_buf.buf, 0, sizeof(cmsg_buf.buf));
-		msg.msg_control		= &cmsg_buf;
-		msg.msg_controllen	= sizeof(cmsg_buf);
-		msg.msg_flags		= 0;
+	msg = dect_tx_batch_add(txb, mb);
+	if (mb->flags & DECT_BCAST_LONG_PAGE) {
+		i = txb->cnt - 1;
+		memset(txb->cmsg[i], 0, sizeof(txb->cmsg[i]));
+		msg->msg_control	= txb->cmsg[i];
+		msg->msg_controllen	= CMSG_SPACE(sizeof(aux));
 
-		cmsg			= CMSG_FIRSTHDR(&msg);
+		cmsg			= CMSG_FIRSTHDR(msg);
 		cmsg->cmsg_len		= CMSG_LEN(sizeof(aux));
 		cmsg->cmsg_level	= SOL_DECT;
 		cmsg->cmsg_type		= DECT_BSAP_AUXDATA;
 
 		aux.long_page		= true;
 		memcpy(CMSG_DATA(cmsg), &aux, sizeof(aux));
-	} else {
-		msg.msg_control		= NULL;
-		msg.msg_controllen	= 0;
-		if (fast_page)
-			msg.msg_flags	= MSG_OOB;
+	} else if (mb->flags & DECT_BCAST_FAST_PAGE)
+		msg->msg_flags = MSG_OOB;
+}
+
+static void dect_lce_bcast_capture(const struct dect_handle *dh,
+				   const struct dect_msg_buf *mb)
+{
+	dect_capture_mbuf(dh, DECT_CAPTURE_B_SAP, DECT_CAPTURE_TX,
+			  (mb->flags & DECT_BCAST_LONG_PAGE ?
+			   DECT_CAPTURE_LONG_PAGE : 0) |
+			  (mb->flags & DECT_BCAST_FAST_PAGE ?
+			   DECT_CAPTURE_FAST_PAGE : 0),
+			  NULL, NULL, mb);
+}
+
+/* Change the events the B-SAP socket is registered for */
+static int dect_lce_bsap_register(const struct dect_handle *dh,
+				  uint32_t events)
+{
+	dect_fd_unregister(dh, dh->b_sap);
+	if (dect_fd_register(dh, dh->b_sap, events) == 0)
+		return 0;
+
+	lce_debug("B-SAP register: %s\n", strerror(errno));
+	if (events != DECT_FD_READ)
+		dect_fd_register(dh, dh->b_sap, DECT_FD_READ);
+	return -1;
+}
+
+/*
+ * Transmit queued broadcast messages. Messages that can't be transmitted
+ * without blocking remain queued, messages failing otherwise are dropped.
+ */
+static void dect_lce_bcast_flush(const struct dect_handle *dh)
+{
+	struct dect_bcast_queue *bq = dh->bcast;
+	struct dect_tx_batch txb;
+	struct dect_msg_buf *mb;
+	unsigned int i, cnt;
+	bool full = false;
+	int n;
+
+	while (!full && !ptrqueue_empty(&bq->queue)) {
+		dect_tx_batch_init(&txb);
+		for (mb = ptrqueue_peek(&bq->queue);
+		     mb != NULL && !dect_tx_batch_full(&txb); mb = mb->next)
+			dect_lce_bcast_add(&txb, mb);
+
+		n = dect_tx_batch_send(dh, &txb, dh->b_sap);
+		cnt = n;
+		if (cnt < txb.cnt) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				full = true;
+			else {
+				lce_debug("broadcast: %s\n", strerror(errno));
+				cnt++;
+			}
+		}
+
+		for (i = 0; i < cnt; i++) {
+			mb = ptrqueue_dequeue(&bq->queue);
+			if (i < (unsigned int)n)
+				dect_lce_bcast_capture(dh, mb);
+			dect_mbuf_free(dh, mb);
+		}
+	}
+}
+
+/* Wait for the B-SAP socket to become writable while messages are queued */
+static void dect_lce_bcast_wait(const struct dect_handle *dh)
+{
+	struct dect_bcast_queue *bq = dh->bcast;
+
+	if (ptrqueue_empty(&bq->queue)) {
+		if (bq->blocked && dect_lce_bsap_register(dh, DECT_FD_READ) == 0)
+			bq->blocked = false;
+	} else if (!bq->blocked &&
+		   dect_lce_bsap_register(dh, DECT_FD_READ | DECT_FD_WRITE) == 0)
+		bq->blocked = true;
+}
+
+/**
+ * dect_lce_bcast_complete - transmit the broadcast messages queued while
+ *			     processing an event
+ *
+ * @dh:		libdect DECT handle
+ *
+ * Messages that can't be transmitted without blocking are kept until the
+ * B-SAP socket has become writable.
+ */
+void dect_lce_bcast_complete(const struct dect_handle *dh)
+{
+	if (dh->bcast == NULL)
+		return;
+
+	dect_lce_bcast_flush(dh);
+	dect_lce_bcast_wait(dh);
+}
+
+/* Queue a copy of a broadcast message for transmission */
+static int dect_lce_bcast_queue(const struct dect_handle *dh,
+				const struct dect_msg_buf *mb)
+{
+	struct dect_bcast_queue *bq = dh->bcast;
+	struct dect_msg_buf *nmb;
+
+	/* Transmit a full batch right away */
+	if (bq->queue.len == bq->queue.limit && !bq->blocked)
+		dect_lce_bcast_complete(dh);
+	if (bq->queue.len == bq->queue.limit) {
+		errno = ENOBUFS;
+		return -1;
 	}
 
+	nmb = dect_mbuf_alloc(dh);
+	if (nmb == NULL)
+		return -1;
+	if (dect_mbuf_expand(dh, nmb, mb->len) < 0)
+		goto err1;
+	memcpy(dect_mbuf_put(nmb, mb->len), mb->data, mb->len);
+	nmb->flags = mb->flags;
+
+	ptrqueue_enqueue(&bq->queue, nmb);
+	return 0;
+
+err1:
+	dect_mbuf_free(dh, nmb);
+	return -1;
+}
+
+ssize_t dect_lce_broadcast(const struct dect_handle *dh,
+			   struct dect_msg_buf *mb,
+			   bool long_page, bool fast_page)
+{
+	struct dect_bcast_queue *bq = dh->bcast;
+	struct dect_tx_batch txb;
+
 	dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: BCAST TX");
-	size = dect_mbuf_send(dh, dh->b_sap, &msg, mb);
-	dect_assert(size == (ssize_t)mb->len);
+
+	mb->flags = 0;
+	if (long_page)
+		mb->flags |= DECT_BCAST_LONG_PAGE;
+	if (fast_page)
+		mb->flags |= DECT_BCAST_FAST_PAGE;
+
+	/* Messages issued while processing an event are batched, queued
+	 * messages are transmitted first to preserve ordering. */
+	if (dh->event_depth > 0 || !ptrqueue_empty(&bq->queue))
+		return dect_lce_bcast_queue(dh, mb);
+
+	dect_tx_batch_init(&txb);
+	dect_lce_bcast_add(&txb, mb);
+	if (dect_tx_batch_send(dh, &txb, dh->b_sap) == 1) {
+		dect_lce_bcast_capture(dh, mb);
+		return 0;
+	}
+
+	if (errno != EAGAIN && errno != EWOULDBLOCK) {
+		lce_debug("broadcast: %s\n", strerror(errno));
+		return -1;
+	}
+	if (dect_lce_bcast_queue(dh, mb) < 0)
+		return -1;
+	dect_lce_bcast_wait(dh);
+	return 0;
+}
+
+static int dect_lce_bcast_init(struct dect_handle *dh)
+{
+	struct dect_bcast_queue *bq;
+
+	bq = dect_zalloc(dh, sizeof(*bq));
+	if (bq == NULL)
+		return -1;
+
+	ptrqueue_init(&bq->queue, DECT_TX_BATCH_SIZE);
+	dh->bcast = bq;
 	return 0;
 }
 
+/* Transmit what can be transmitted without blocking, drop the rest */
+static void dect_lce_bcast_exit(struct dect_handle *dh)
+{
+	struct dect_bcast_queue *bq = dh->bcast;
+	struct dect_msg_buf *mb;
+
+	if (!ptrqueue_empty(&bq->queue))
+		dect_lce_bcast_flush(dh);
+	while ((mb = ptrqueue_dequeue(&bq->queue)) != NULL)
+		dect_mbuf_free(dh, mb);
+	dect_free(dh, bq);
+	dh->bcast = NULL;
+}
+
 static enum lce_request_page_hdr_codes
 dect_page_service_to_hdr(enum dect_mac_service_types service)
 {
@@ -1267,6 +1965,7 @@ EXPORT_SYMBOL(dect_lce_group_ring_req);
 
 static int dect_lce_send_short_page(const struct dect_handle *dh,
 				    const struct dect_ipui *ipui,
+				    const struct dect_lte *lte,
 				    const struct dect_mac_conn_params *mcp)
 {
 	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
@@ -1279,7 +1978,7 @@ static int dect_lce_send_short_page(const struct dect_handle *dh,
 	msg = dect_mbuf_put(mb, sizeof(*msg));
 	msg->hdr = dect_page_service_to_hdr(mcp->service);
 
-	tpui = dect_tpui(dh, ipui);
+	tpui = dect_lte_tpui(lte);
 	if (tpui == NULL)
 		tpui = dect_ipui_to_tpui(&_tpui, ipui);
 	else
@@ -1288,7 +1987,7 @@ static int dect_lce_send_short_page(const struct dect_handle *dh,
 	page = dect_build_tpui(tpui) & DECT_LCE_SHORT_PAGE_TPUI_MASK;
 	msg->information = __cpu_to_be16(page);
 
-	if (dect_page_capability(dh, ipui) ==
+	if (dect_lte_page_capability(lte) ==
 	    DECT_PAGE_CAPABILITY_FAST_AND_NORMAL_PAGING)
 		fast_page = true;
 
@@ -1297,6 +1996,7 @@ static int dect_lce_send_short_page(const struct dect_handle *dh,
 
 static int dect_lce_send_full_page(const struct dect_handle *dh,
 				   const struct dect_ipui *ipui,
+				   const struct dect_lte *lte,
 				   const struct dect_mac_conn_params *mcp)
 {
 	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
@@ -1313,7 +2013,7 @@ static int dect_lce_send_full_page(const struct dect_handle *dh,
 	if (1) {
 		msg->hdr |= DECT_LCE_PAGE_W_FLAG;
 
-		tpui = dect_tpui(dh, ipui);
+		tpui = dect_lte_tpui(lte);
 		if (tpui == NULL)
 			tpui = dect_ipui_to_tpui(&_tpui, ipui);
 
@@ -1332,7 +2032,7 @@ static int dect_lce_send_full_page(const struct dect_handle *dh,
 	}
 	msg->information = __cpu_to_be32(page);
 
-	if (dect_page_capability(dh, ipui) ==
+	if (dect_lte_page_capability(lte) ==
 	    DECT_PAGE_CAPABILITY_FAST_AND_NORMAL_PAGING)
 		fast_page = true;
 
@@ -1343,11 +2043,14 @@ static int dect_lce_page(const struct dect_handle *dh,
 			 const struct dect_ipui *ipui,
 			 const struct dect_mac_conn_params *mcp)
 {
+	const struct dect_lte *lte;
+
+	lte = dect_lte_get_by_ipui(dh, ipui);
 	if (mcp->service == DECT_SERVICE_IN_MIN_DELAY &&
 	    mcp->slot == DECT_FULL_SLOT)
-		return dect_lce_send_short_page(dh, ipui, mcp);
+		return dect_lce_send_short_page(dh, ipui, lte, mcp);
 	else
-		return dect_lce_send_full_page(dh, ipui, mcp);
+		return dect_lce_send_full_page(dh, ipui, lte, mcp);
 }
 
 static void dect_ddl_page_timer(struct dect_handle *dh, struct dect_timer *timer)
@@ -1382,8 +2085,9 @@ static int dect_lce_send_page_reject(const struct dect_handle *dh,
 
 	reject_reason.reason = reason;
 
-	return dect_lce_send(dh, ta, &lce_page_reject_msg_desc,
-			     &msg.common, DECT_LCE_PAGE_REJECT);
+	return dect_lce_send_tmpl(dh, ta, DECT_TMPL_LCE_PAGE_REJECT,
+				  &lce_page_reject_msg_desc,
+				  &msg.common, DECT_LCE_PAGE_REJECT);
 }
 
 static void dect_lce_rcv_page_response(struct dect_handle *dh,
@@ -1391,7 +2095,7 @@ static void dect_lce_rcv_page_response(struct dect_handle *dh,
 				       struct dect_msg_buf *mb)
 {
 	struct dect_lce_page_response_msg msg;
-	struct dect_data_link *i, *req = NULL;
+	struct dect_data_link *req;
 	enum dect_sfmt_error err;
 	bool reject = true;
 
@@ -1403,15 +2107,7 @@ static void dect_lce_rcv_page_response(struct dect_handle *dh,
 		return dect_ddl_release(dh, ta->link);
 	}
 
-	list_for_each_entry(i, &dh->links, list) {
-		if (dect_ipui_cmp(&i->ipui, &msg.portable_identity->ipui))
-			continue;
-		if (i->state != DECT_DATA_LINK_ESTABLISH_PENDING)
-			continue;
-		req = i;
-		break;
-	}
-
+	req = dect_ddl_get_page_request(dh, &msg.portable_identity->ipui);
 	dect_ddl_set_ipui(dh, ta->link, &msg.portable_identity->ipui);
 
 	if (req == NULL && dh->ops->lce_ops &&
@@ -1447,13 +2143,16 @@ static void dect_lce_rcv_page_reject(struct dect_handle *dh,
 				     struct dect_transaction *ta,
 				     struct dect_msg_buf *mb)
 {
-	struct dect_lce_page_reject_msg msg;
+	struct dect_ie_reject_reason reject_reason;
+	struct dect_msg_view view;
 
 	ddl_debug(ta->link, "LCE-PAGE-REJECT");
-	if (dect_parse_sfmt_msg(dh, &lce_page_reject_msg_desc,
-				&msg.common, mb) < 0)
+	if (dect_msg_view_init(dh, &view, &lce_page_reject_msg_desc, mb) < 0)
 		return;
-	dect_msg_free(dh, &lce_page_reject_msg_desc, &msg.common);
+	if (dect_msg_view_get(dh, &view, DECT_IE_REJECT_REASON,
+			      &reject_reason) < 0)
+		return;
+	ddl_debug(ta->link, "reject reason: %x", reject_reason.reason);
 }
 
 static void dect_lce_send_page_response(struct dect_handle *dh,
@@ -1611,24 +2310,13 @@ static void dect_lce_rcv_long_page(struct dect_handle *dh,
 	dect_clms_rcv_fixed(dh, mb);
 }
 
-static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
-				uint32_t events)
+static void dect_lce_bsap_rcv(struct dect_handle *dh, struct msghdr *msg,
+			      struct dect_msg_buf *mb)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
-	struct msghdr msg;
 	struct cmsghdr *cmsg;
-	char cmsg_buf[4 * CMSG_SPACE(16)];
 	bool long_page = false;
 
-	dect_debug(DECT_DEBUG_LCE, "\n");
-
-	msg.msg_control		= cmsg_buf;
-	msg.msg_controllen	= sizeof(cmsg_buf);
-
-	if (dect_mbuf_rcv(dfd, &msg, mb) < 0)
-		return;
-
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
 		const struct dect_bsap_auxdata *aux;
 
 		if (cmsg->cmsg_level != SOL_DECT)
@@ -1648,6 +2336,9 @@ static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
 	}
 
 	dect_mbuf_dump(DECT_DEBUG_LCE, mb, "LCE: BCAST RX");
+	dect_capture_mbuf(dh, DECT_CAPTURE_B_SAP, DECT_CAPTURE_RX,
+			  long_page ? DECT_CAPTURE_LONG_PAGE : 0,
+			  NULL, NULL, mb);
 
 	switch (mb->len) {
 	case 3:
@@ -1660,6 +2351,42 @@ static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
 	}
 }
 
+static void dect_lce_bsap_event(struct dect_handle *dh, struct dect_fd *dfd,
+				uint32_t events)
+{
+	struct dect_rx_batch *rxb = dh->rxb;
+	unsigned int budget, i;
+	int n;
+
+	if (events & DECT_FD_WRITE)
+		dect_lce_bcast_complete(dh);
+	if (!(events & DECT_FD_READ))
+		return;
+
+	dect_debug(DECT_DEBUG_LCE, "\n");
+
+	budget = dect_rx_budget(dh);
+	while (budget > 0) {
+		n = dect_rx_batch_rcv(dh, dfd, budget);
+		if (n < 0)
+			return;
+
+		for (i = 0; i < (unsigned int)n; i++) {
+			dect_lce_bsap_rcv(dh, &rxb->msg[i].msg_hdr, &rxb->mb[i]);
+
+			/* The socket may have been closed by a callback */
+			if (dfd->flags & DECT_FD_DESTROYED)
+				return;
+		}
+
+		if ((unsigned int)n < min(budget, (unsigned int)DECT_RX_BATCH_SIZE))
+			return;
+		budget -= n;
+	}
+
+	dfd->flags |= DECT_FD_PENDING;
+}
+
 static void dect_lce_rcv(struct dect_handle *dh, struct dect_transaction *ta,
 			 struct dect_msg_buf *mb)
 {
@@ -1708,15 +2435,13 @@ static const struct dect_nwk_protocol lce_protocol = {
 static int dect_transaction_alloc_tv(const struct dect_data_link *ddl,
 				     const struct dect_nwk_protocol *protocol)
 {
-	uint16_t tv;
+	uint8_t map = ddl->tv_map[protocol->pd][DECT_TRANSACTION_INITIATOR];
+	int tv;
 
-	for (tv = 0; tv < protocol->max_transactions; tv++) {
-		if (dect_ddl_transaction_lookup(ddl, protocol->pd, tv,
-						DECT_TRANSACTION_INITIATOR))
-			continue;
-		return tv;
-	}
-	return -1;
+	tv = ffs(~map & 0xff) - 1;
+	if (tv < 0 || tv >= protocol->max_transactions)
+		return -1;
+	return tv;
 }
 
 static void dect_transaction_link(struct dect_data_link *ddl,
@@ -1742,6 +2467,8 @@ static void dect_transaction_link(struct dect_data_link *ddl,
 			list_add_tail(&ta->list, &ddl->transactions);
 	} else
 		list_add(&ta->list, &ddl->transactions);
+
+	dect_ddl_transaction_hash(ddl, ta);
 }
 
 int dect_ddl_transaction_open(struct dect_handle *dh, struct dect_transaction *ta,
@@ -1763,6 +2490,7 @@ int dect_ddl_transaction_open(struct dect_handle *dh, struct dect_transaction *t
 	ta->tv    = tv;
 
 	dect_transaction_link(ddl, ta);
+	dect_trace(dh, DECT_TRACE_LCE_TA_OPEN, ddl, ta, ta->role, 0, 0, 0);
 	return 0;
 }
 
@@ -1791,6 +2519,7 @@ void dect_transaction_confirm(struct dect_handle *dh, struct dect_transaction *t
 	ddl_debug(req->link, "confirm transaction: %s TV: %u Role: %u",
 		  protocols[ta->pd]->name, ta->tv, ta->role);
 	dect_transaction_link(req->link, ta);
+	dect_trace(dh, DECT_TRACE_LCE_TA_CONFIRM, NULL, ta, ta->role, 0, 0, 0);
 }
 
 void dect_transaction_close(struct dect_handle *dh, struct dect_transaction *ta,
@@ -1800,8 +2529,10 @@ void dect_transaction_close(struct dect_handle *dh, struct dect_transaction *ta,
 
 	ddl_debug(ddl, "close transaction: %s TV: %u Role: %u",
 		  protocols[ta->pd]->name, ta->tv, ta->role);
+	dect_trace(dh, DECT_TRACE_LCE_TA_CLOSE, ddl, ta, ta->role, mode, 0, 0);
 
 	list_del(&ta->list);
+	dect_ddl_transaction_unhash(ddl, ta);
 	ta->state = DECT_TRANSACTION_CLOSED;
 	if (ta->mb != NULL)
 		dect_mbuf_free(dh, ta->mb);
@@ -1920,20 +2651,32 @@ int dect_lce_init(struct dect_handle *dh)
 	if (dh->mode == DECT_MODE_PP)
 		dect_pp_set_default_pmid(dh);
 
+	if (dect_mbuf_pool_init(dh) < 0)
+		goto err1;
+
+	dh->msg_tmpl = dect_zalloc(dh, sizeof(*dh->msg_tmpl) * __DECT_TMPL_MAX);
+	if (dh->msg_tmpl == NULL)
+		goto err2;
+
 	/* Open B-SAP socket */
 	dh->b_sap = dect_socket(dh, SOCK_DGRAM, DECT_B_SAP);
 	if (dh->b_sap == NULL)
-		goto err1;
+		goto err3;
 
 	memset(&b_addr, 0, sizeof(b_addr));
 	b_addr.dect_family = AF_DECT;
 	b_addr.dect_index = dh->index;
-	if (bind(dh->b_sap->fd, (struct sockaddr *)&b_addr, sizeof(b_addr)) < 0)
-		goto err2;
+	if (dect_bind(dh, dh->b_sap, (struct sockaddr *)&b_addr,
+		      sizeof(b_addr)) < 0)
+		goto err4;
 
 	dect_fd_setup(dh->b_sap, dect_lce_bsap_event, NULL);
+	dh->b_sap->flags |= DECT_FD_DRAIN;
 	if (dect_fd_register(dh, dh->b_sap, DECT_FD_READ) < 0)
-		goto err2;
+		goto err4;
+
+	if (dect_lce_bcast_init(dh) < 0)
+		goto err5;
 
 	dh->page_transaction.state = DECT_TRANSACTION_CLOSED;
 
@@ -1941,7 +2684,7 @@ int dect_lce_init(struct dect_handle *dh)
 	if (dh->mode == DECT_MODE_FP) {
 		dh->s_sap = dect_socket(dh, SOCK_SEQPACKET, DECT_S_SAP);
 		if (dh->s_sap == NULL)
-			goto err3;
+			goto err6;
 
 		memset(&s_addr, 0, sizeof(s_addr));
 		s_addr.dect_family = AF_DECT;
@@ -1949,15 +2692,15 @@ int dect_lce_init(struct dect_handle *dh)
 		s_addr.dect_lln    = DECT_LLN_ANY;
 		s_addr.dect_sapi   = DECT_SAPI_ANY;
 
-		if (bind(dh->s_sap->fd, (struct sockaddr *)&s_addr,
-			 sizeof(s_addr)) < 0)
-			goto err4;
-		if (listen(dh->s_sap->fd, 10) < 0)
-			goto err4;
+		if (dect_bind(dh, dh->s_sap, (struct sockaddr *)&s_addr,
+			      sizeof(s_addr)) < 0)
+			goto err7;
+		if (dect_listen(dh, dh->s_sap, 10) < 0)
+			goto err7;
 
 		dect_fd_setup(dh->s_sap, dect_lce_ssap_listener_event, NULL);
 		if (dect_fd_register(dh, dh->s_sap, DECT_FD_READ) < 0)
-			goto err4;
+			goto err7;
 	}
 
 	dect_lce_register_protocol(&lce_protocol);
@@ -1967,12 +2710,18 @@ int dect_lce_init(struct dect_handle *dh)
 	dect_lce_register_protocol(&dect_mm_protocol);
 	return 0;
 
-err4:
+err7:
 	dect_close(dh, dh->s_sap);
-err3:
+err6:
+	dect_lce_bcast_exit(dh);
+err5:
 	dect_fd_unregister(dh, dh->b_sap);
-err2:
+err4:
 	dect_close(dh, dh->b_sap);
+err3:
+	dect_free(dh, dh->msg_tmpl);
+err2:
+	dect_mbuf_pool_exit(dh);
 err1:
 	lce_debug("dect_lce_init: %s\n", strerror(errno));
 	return -1;
@@ -1981,21 +2730,32 @@ err1:
 void dect_lce_exit(struct dect_handle *dh)
 {
 	struct dect_data_link *ddl, *ddl_next;
-	struct dect_lte *lte, *lte_next;
+	struct dect_lte *lte;
+	struct hlist_node *pos, *next;
+	unsigned int i;
 
 	list_for_each_entry_safe(ddl, ddl_next, &dh->links, list)
 		dect_ddl_shutdown(dh, ddl);
 
-	list_for_each_entry_safe(lte, lte_next, &dh->ldb, list)
-		dect_lte_release(dh, lte);
+	for (i = 0; i < array_size(dh->ldb); i++) {
+		hlist_for_each_entry_safe(lte, pos, next, &dh->ldb[i], hnode)
+			dect_lte_release(dh, lte);
+	}
 
 	if (dh->mode == DECT_MODE_FP) {
 		dect_fd_unregister(dh, dh->s_sap);
 		dect_close(dh, dh->s_sap);
 	}
 
+	dect_lce_bcast_exit(dh);
 	dect_fd_unregister(dh, dh->b_sap);
 	dect_close(dh, dh->b_sap);
+
+	for (i = 0; i < __DECT_TMPL_MAX; i++)
+		dect_sfmt_msg_tmpl_flush(dh, &dh->msg_tmpl[i]);
+	dect_free(dh, dh->msg_tmpl);
+
+	dect_mbuf_pool_exit(dh);
 }
 
 /** @} */
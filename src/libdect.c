@@ -18,9 +18,13 @@
 #include <time.h>
 
 #include <libdect.h>
-#include <netlink.h>
 #include <utils.h>
 #include <lce.h>
+#include <timer.h>
+#include <loop.h>
+#include <transport.h>
+#include <trace.h>
+#include <io.h>
 
 static struct dect_handle *dect_alloc_handle(struct dect_ops *ops)
 {
@@ -37,45 +41,69 @@ static struct dect_handle *dect_alloc_handle(struct dect_ops *ops)
 	memset(dh, 0, sizeof(*dh) + ops->priv_size);
 
 	dh->ops = ops;
-	init_list_head(&dh->ldb);
 	init_list_head(&dh->links);
 	init_list_head(&dh->mme_list);
 	return dh;
 }
 
-/**
- * Initialize the libdect subsystems and bind to a cluster
- *
- * @param ops		DECT ops
- * @param cluster	Cluster name
- *
- * @return		a new libdect DECT handle or NULL on error.
- */
-struct dect_handle *dect_open_handle(struct dect_ops *ops, const char *cluster)
+struct dect_handle *__dect_open_handle(struct dect_ops *ops,
+				       const struct dect_transport_ops *transport,
+				       void *priv, const char *cluster)
 {
 	struct dect_handle *dh;
 
-	if (cluster == NULL)
-		cluster = "cluster0";
-
 	dh = dect_alloc_handle(ops);
 	if (dh == NULL)
 		goto err1;
+	dh->transport	   = transport;
+	dh->transport_priv = priv;
 
-	if (dect_netlink_init(dh, cluster) < 0)
+	if (dect_trace_init(dh) < 0)
 		goto err2;
-	if (dect_lce_init(dh) < 0)
+	if (dect_loop_init(dh) < 0)
 		goto err3;
+	if (dect_timer_wheel_init(dh) < 0)
+		goto err4;
+	if (dect_rx_batch_init(dh) < 0)
+		goto err5;
+	if (dh->transport->init(dh, cluster) < 0)
+		goto err6;
+	if (dect_lce_init(dh) < 0)
+		goto err7;
 
 	return dh;
 
+err7:
+	dh->transport->exit(dh);
+err6:
+	dect_rx_batch_exit(dh);
+err5:
+	dect_timer_wheel_exit(dh);
+err4:
+	dect_loop_exit(dh);
 err3:
-	dect_netlink_exit(dh);
+	dect_trace_exit(dh);
 err2:
 	dect_free(dh, dh);
 err1:
 	return NULL;
 }
+
+/**
+ * Initialize the libdect subsystems and bind to a cluster
+ *
+ * @param ops		DECT ops
+ * @param cluster	Cluster name
+ *
+ * @return		a new libdect DECT handle or NULL on error.
+ */
+struct dect_handle *dect_open_handle(struct dect_ops *ops, const char *cluster)
+{
+	if (cluster == NULL)
+		cluster = "cluster0";
+
+	return __dect_open_handle(ops, &dect_kernel_transport, NULL, cluster);
+}
 EXPORT_SYMBOL(dect_open_handle);
 
 /**
@@ -86,7 +114,12 @@ EXPORT_SYMBOL(dect_open_handle);
 void dect_close_handle(struct dect_handle *dh)
 {
 	dect_lce_exit(dh);
-	dect_netlink_exit(dh);
+	dh->transport->exit(dh);
+	dect_capture_stop(dh);
+	dect_rx_batch_exit(dh);
+	dect_timer_wheel_exit(dh);
+	dect_loop_exit(dh);
+	dect_trace_exit(dh);
 	dect_free(dh, dh);
 }
 EXPORT_SYMBOL(dect_close_handle);
@@ -0,0 +1,516 @@
+/*
+ * libdect built-in event loop
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @addtogroup events
+ * @{
+ *
+ * @defgroup loop Event loop
+ *
+ * libdect built-in event loop.
+ *
+ * Applications not integrating libdect into an existing event loop can use
+ * the built-in event loop based on epoll, timerfd and signalfd by setting
+ * dect_ops::event_ops to &#dect_loop_event_ops or &#dect_loop_et_event_ops
+ * and calling dect_loop_run() after opening the handle. No private storage
+ * needs to be managed by the application.
+ *
+ * With #dect_loop_et_event_ops, sockets that are drained on each read event
+ * (the LCE and raw sockets) are registered edge-triggered. Sockets that still
+ * hold data when the receive budget (dect_ops::rx_budget) is exhausted are
+ * serviced again before the loop waits for new events.
+ *
+ * The event loop is shared by all handles of the process using the built-in
+ * event ops, dect_loop_run() processes the events of all of them. Signal
+ * handling is left to the application unless it calls
+ * dect_loop_handle_signals() to have SIGINT and SIGTERM terminate
+ * dect_loop_run().
+ *
+ * @{
+ */
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <io.h>
+#include <timer.h>
+#include <loop.h>
+
+/**
+ * struct dect_loop_fd - event loop file descriptor private data
+ *
+ * @ready:	ready list node
+ * @dfd:	libdect file descriptor
+ * @ctx:	event loop context of the owning handle
+ */
+struct dect_loop_fd {
+	struct list_head	ready;
+	struct dect_fd		*dfd;
+	struct dect_loop_ctx	*ctx;
+};
+
+/**
+ * struct dect_loop_timer - event loop timer private data
+ *
+ * @list:	timer list node
+ * @expires:	absolute CLOCK_MONOTONIC expiry time
+ * @timer:	libdect timer
+ * @ctx:	event loop context of the owning handle
+ */
+struct dect_loop_timer {
+	struct list_head	list;
+	struct timespec		expires;
+	struct dect_timer	*timer;
+	struct dect_loop_ctx	*ctx;
+};
+
+static struct dect_loop *dect_loop;
+
+static bool dect_loop_is_builtin(const struct dect_event_ops *ops)
+{
+	return ops == &dect_loop_event_ops || ops == &dect_loop_et_event_ops;
+}
+
+/*
+ * File descriptors
+ */
+
+static int dect_loop_register_fd(const struct dect_handle *dh,
+				 struct dect_fd *dfd, uint32_t events)
+{
+	struct dect_loop_ctx *ctx = dh->loop;
+	struct dect_loop_fd *lfd = dect_fd_priv(dfd);
+	struct epoll_event ev = {
+		.data.ptr	= dfd,
+	};
+
+	if (events & DECT_FD_READ)
+		ev.events |= EPOLLIN;
+	if (events & DECT_FD_WRITE)
+		ev.events |= EPOLLOUT;
+	if (ctx->edge_triggered && dfd->flags & DECT_FD_DRAIN)
+		ev.events |= EPOLLET;
+
+	init_list_head(&lfd->ready);
+	lfd->dfd = dfd;
+	lfd->ctx = ctx;
+	return epoll_ctl(ctx->loop->epfd, EPOLL_CTL_ADD, dfd->fd, &ev);
+}
+
+static void dect_loop_unregister_fd(const struct dect_handle *dh,
+				    struct dect_fd *dfd)
+{
+	struct dect_loop *loop = dh->loop->loop;
+	struct dect_loop_fd *lfd = dect_fd_priv(dfd);
+	unsigned int i;
+
+	epoll_ctl(loop->epfd, EPOLL_CTL_DEL, dfd->fd, NULL);
+	list_del_init(&lfd->ready);
+
+	/* The descriptor may be closed by the caller, invalidate references
+	 * from events that have not been processed yet. */
+	if (loop->current == dfd)
+		loop->current = NULL;
+	for (i = loop->cur + 1; i < loop->nevents; i++) {
+		if (loop->events[i].data.ptr == dfd)
+			loop->events[i].data.ptr = NULL;
+	}
+}
+
+static void dect_loop_process_fd(struct dect_loop *loop, struct dect_fd *dfd,
+				 uint32_t events)
+{
+	struct dect_loop_fd *lfd = dect_fd_priv(dfd);
+	struct dect_loop_ctx *ctx = lfd->ctx;
+
+	dfd->flags &= ~DECT_FD_PENDING;
+	loop->current = dfd;
+
+	dect_fd_process(ctx->dh, dfd, events);
+
+	/* An edge-triggered descriptor won't be reported again until new
+	 * data arrives, service it again if the callback had to stop before
+	 * draining the socket. */
+	if (loop->current == dfd && ctx->edge_triggered &&
+	    dfd->flags & DECT_FD_PENDING && list_empty(&lfd->ready))
+		list_add_tail(&lfd->ready, &loop->ready);
+	loop->current = NULL;
+}
+
+static void dect_loop_process_ready(struct dect_loop *loop)
+{
+	struct dect_loop_fd *lfd;
+	LIST_HEAD(ready);
+
+	/* Descriptors unregistered by a callback are unlinked from the
+	 * local list. */
+	list_splice_init(&loop->ready, &ready);
+	while (!list_empty(&ready)) {
+		lfd = list_first_entry(&ready, struct dect_loop_fd, ready);
+		list_del_init(&lfd->ready);
+		dect_loop_process_fd(loop, lfd->dfd, DECT_FD_READ);
+	}
+}
+
+/*
+ * Timers
+ */
+
+static bool timespec_before(const struct timespec *t1,
+			    const struct timespec *t2)
+{
+	if (t1->tv_sec != t2->tv_sec)
+		return t1->tv_sec < t2->tv_sec;
+	return t1->tv_nsec < t2->tv_nsec;
+}
+
+static void dect_loop_arm_timer(const struct dect_loop *loop)
+{
+	const struct dect_loop_timer *lt;
+	struct itimerspec its = {};
+
+	if (!list_empty(&loop->timers)) {
+		lt = list_first_entry(&loop->timers, struct dect_loop_timer, list);
+		its.it_value = lt->expires;
+	}
+	timerfd_settime(loop->tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void dect_loop_start_timer(const struct dect_handle *dh,
+				  struct dect_timer *timer,
+				  const struct timeval *tv)
+{
+	struct dect_loop *loop = dh->loop->loop;
+	struct dect_loop_timer *lt = dect_timer_priv(timer), *pos;
+
+	clock_gettime(CLOCK_MONOTONIC, &lt->expires);
+	lt->expires.tv_sec  += tv->tv_sec;
+	lt->expires.tv_nsec += tv->tv_usec * 1000;
+	if (lt->expires.tv_nsec >= 1000000000) {
+		lt->expires.tv_sec++;
+		lt->expires.tv_nsec -= 1000000000;
+	}
+	lt->timer = timer;
+	lt->ctx   = dh->loop;
+
+	/* Most timers are started with the same timeout as the previous
+	 * ones, search for the insertion point from the tail. */
+	list_for_each_entry_reverse(pos, &loop->timers, list) {
+		if (!timespec_before(&lt->expires, &pos->expires))
+			break;
+	}
+	list_add(&lt->list, &pos->list);
+
+	if (loop->timers.next == &lt->list)
+		dect_loop_arm_timer(loop);
+}
+
+static void dect_loop_stop_timer(const struct dect_handle *dh,
+				 struct dect_timer *timer)
+{
+	struct dect_loop_timer *lt = dect_timer_priv(timer);
+
+	/* The timerfd is rearmed lazily on the next expiry */
+	list_del(&lt->list);
+}
+
+static void dect_loop_run_timers(struct dect_loop *loop)
+{
+	struct dect_loop_timer *lt;
+	struct timespec now;
+	uint64_t exp;
+
+	if (read(loop->tfd, &exp, sizeof(exp)) < 0 && errno != EAGAIN)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	while (!list_empty(&loop->timers)) {
+		lt = list_first_entry(&loop->timers, struct dect_loop_timer, list);
+		if (timespec_before(&now, &lt->expires))
+			break;
+		list_del(&lt->list);
+		dect_timer_run(lt->ctx->dh, lt->timer);
+	}
+	dect_loop_arm_timer(loop);
+}
+
+/*
+ * Event loop
+ */
+
+static void dect_loop_rcv_signal(struct dect_loop *loop)
+{
+	struct signalfd_siginfo ssi;
+
+	if (read(loop->sfd, &ssi, sizeof(ssi)) == sizeof(ssi))
+		loop->stop = true;
+}
+
+static uint32_t dect_loop_events(uint32_t events)
+{
+	if (events & EPOLLOUT && !(events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+		return DECT_FD_WRITE;
+	if (events & EPOLLOUT)
+		return DECT_FD_READ | DECT_FD_WRITE;
+	return DECT_FD_READ;
+}
+
+/**
+ * Run the built-in event loop
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Process events of all handles using the built-in event loop until
+ * dect_loop_stop() is called or, if enabled by dect_loop_handle_signals(),
+ * SIGINT or SIGTERM is received.
+ *
+ * @return		0 on success or -1 on error with errno set.
+ */
+int dect_loop_run(struct dect_handle *dh)
+{
+	struct dect_loop *loop;
+	struct epoll_event *ev;
+	int timeout, n;
+
+	dect_assert(dh->loop != NULL);
+	loop = dh->loop->loop;
+
+	loop->stop = false;
+	while (!loop->stop) {
+		timeout = list_empty(&loop->ready) ? -1 : 0;
+		n = epoll_wait(loop->epfd, loop->events,
+			       array_size(loop->events), timeout);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		loop->nevents = n;
+		for (loop->cur = 0; loop->cur < loop->nevents; loop->cur++) {
+			ev = &loop->events[loop->cur];
+			if (ev->data.ptr == NULL)
+				continue;
+			else if (ev->data.ptr == &loop->tfd)
+				dect_loop_run_timers(loop);
+			else if (ev->data.ptr == &loop->sfd)
+				dect_loop_rcv_signal(loop);
+			else
+				dect_loop_process_fd(loop, ev->data.ptr,
+						     dect_loop_events(ev->events));
+		}
+		loop->nevents = 0;
+		loop->cur     = 0;
+
+		dect_loop_process_ready(loop);
+	}
+	return 0;
+}
+EXPORT_SYMBOL(dect_loop_run);
+
+/**
+ * Stop the built-in event loop
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Terminate dect_loop_run() after processing the current events.
+ */
+void dect_loop_stop(const struct dect_handle *dh)
+{
+	dh->loop->loop->stop = true;
+}
+EXPORT_SYMBOL(dect_loop_stop);
+
+static int dect_loop_add(struct dect_loop *loop, int *fd)
+{
+	struct epoll_event ev = {
+		.events		= EPOLLIN,
+		.data.ptr	= fd,
+	};
+
+	return epoll_ctl(loop->epfd, EPOLL_CTL_ADD, *fd, &ev);
+}
+
+/**
+ * Terminate the built-in event loop on SIGINT and SIGTERM
+ *
+ * @param dh		libdect DECT handle
+ *
+ * Block SIGINT and SIGTERM in the calling thread and terminate dect_loop_run()
+ * when one of them is received. The previous signal mask of the thread is
+ * restored when the last handle using the built-in event loop is closed.
+ * Multithreaded programs must block both signals in all threads, which is
+ * most easily done by calling this function before creating any threads.
+ *
+ * @return		0 on success or -1 on error with errno set.
+ */
+int dect_loop_handle_signals(const struct dect_handle *dh)
+{
+	struct dect_loop *loop;
+	sigset_t mask;
+	int err;
+
+	dect_assert(dh->loop != NULL);
+	loop = dh->loop->loop;
+	if (loop->sfd >= 0)
+		return 0;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	err = pthread_sigmask(SIG_BLOCK, &mask, &loop->sigmask);
+	if (err != 0) {
+		errno = err;
+		goto err1;
+	}
+
+	loop->sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (loop->sfd < 0)
+		goto err2;
+	if (dect_loop_add(loop, &loop->sfd) < 0)
+		goto err3;
+	return 0;
+
+err3:
+	close(loop->sfd);
+	loop->sfd = -1;
+err2:
+	pthread_sigmask(SIG_SETMASK, &loop->sigmask, NULL);
+err1:
+	return -1;
+}
+EXPORT_SYMBOL(dect_loop_handle_signals);
+
+static struct dect_loop *dect_loop_alloc(void)
+{
+	struct dect_loop *loop;
+
+	loop = calloc(1, sizeof(*loop));
+	if (loop == NULL)
+		goto err1;
+	init_list_head(&loop->timers);
+	init_list_head(&loop->ready);
+	loop->sfd = -1;
+
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0)
+		goto err2;
+
+	loop->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (loop->tfd < 0)
+		goto err3;
+	if (dect_loop_add(loop, &loop->tfd) < 0)
+		goto err4;
+
+	return loop;
+
+err4:
+	close(loop->tfd);
+err3:
+	close(loop->epfd);
+err2:
+	free(loop);
+err1:
+	return NULL;
+}
+
+static void dect_loop_free(struct dect_loop *loop)
+{
+	if (loop->sfd >= 0) {
+		close(loop->sfd);
+		pthread_sigmask(SIG_SETMASK, &loop->sigmask, NULL);
+	}
+	close(loop->tfd);
+	close(loop->epfd);
+	free(loop);
+}
+
+int dect_loop_init(struct dect_handle *dh)
+{
+	struct dect_loop_ctx *ctx;
+
+	if (!dect_loop_is_builtin(dh->ops->event_ops))
+		return 0;
+
+	ctx = dect_malloc(dh, sizeof(*ctx));
+	if (ctx == NULL)
+		goto err1;
+	ctx->dh = dh;
+	ctx->edge_triggered = dh->ops->event_ops == &dect_loop_et_event_ops;
+
+	if (dect_loop == NULL) {
+		dect_loop = dect_loop_alloc();
+		if (dect_loop == NULL)
+			goto err2;
+	}
+	dect_loop->users++;
+	ctx->loop = dect_loop;
+
+	dh->loop = ctx;
+	return 0;
+
+err2:
+	dect_free(dh, ctx);
+err1:
+	return -1;
+}
+
+void dect_loop_exit(struct dect_handle *dh)
+{
+	struct dect_loop_ctx *ctx = dh->loop;
+
+	if (ctx == NULL)
+		return;
+
+	if (--ctx->loop->users == 0) {
+		dect_loop_free(ctx->loop);
+		dect_loop = NULL;
+	}
+	dect_free(dh, ctx);
+	dh->loop = NULL;
+}
+
+/**
+ * Level-triggered built-in event loop ops
+ */
+const struct dect_event_ops dect_loop_event_ops = {
+	.fd_priv_size		= sizeof(struct dect_loop_fd),
+	.register_fd		= dect_loop_register_fd,
+	.unregister_fd		= dect_loop_unregister_fd,
+	.timer_priv_size	= sizeof(struct dect_loop_timer),
+	.start_timer		= dect_loop_start_timer,
+	.stop_timer		= dect_loop_stop_timer,
+};
+EXPORT_SYMBOL(dect_loop_event_ops);
+
+/**
+ * Edge-triggered built-in event loop ops
+ */
+const struct dect_event_ops dect_loop_et_event_ops = {
+	.fd_priv_size		= sizeof(struct dect_loop_fd),
+	.register_fd		= dect_loop_register_fd,
+	.unregister_fd		= dect_loop_unregister_fd,
+	.timer_priv_size	= sizeof(struct dect_loop_timer),
+	.start_timer		= dect_loop_start_timer,
+	.stop_timer		= dect_loop_stop_timer,
+};
+EXPORT_SYMBOL(dect_loop_et_event_ops);
+
+/** @} */
+/** @} */
@@ -28,9 +28,10 @@
 #include <s_fmt.h>
 #include <lce.h>
 #include <mm.h>
+#include <trace.h>
 #include <dect/auth.h>
 
-static DECT_SFMT_MSG_DESC(mm_access_rights_accept,
+DECT_SFMT_MSG_DESC(mm_access_rights_accept,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_MANDATORY, IE_NONE,      DECT_SFMT_IE_REPEAT),
@@ -47,7 +48,7 @@ static DECT_SFMT_MSG_DESC(mm_access_rights_accept,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_access_rights_request,
+DECT_SFMT_MSG_DESC(mm_access_rights_request,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_AUTH_TYPE,			IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CIPHER_INFO,		IE_NONE,      IE_OPTIONAL,  0),
@@ -60,7 +61,7 @@ static DECT_SFMT_MSG_DESC(mm_access_rights_request,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_access_rights_reject,
+DECT_SFMT_MSG_DESC(mm_access_rights_reject,
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_DURATION,			IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_IWU_TO_IWU,		IE_NONE,      IE_OPTIONAL,  0),
@@ -68,19 +69,19 @@ static DECT_SFMT_MSG_DESC(mm_access_rights_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_access_rights_terminate_accept,
+DECT_SFMT_MSG_DESC(mm_access_rights_terminate_accept,
 	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_access_rights_terminate_reject,
+DECT_SFMT_MSG_DESC(mm_access_rights_terminate_reject,
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_DURATION,			IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_access_rights_terminate_request,
+DECT_SFMT_MSG_DESC(mm_access_rights_terminate_request,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
@@ -89,7 +90,7 @@ static DECT_SFMT_MSG_DESC(mm_access_rights_terminate_request,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_authentication_reject,
+DECT_SFMT_MSG_DESC(mm_authentication_reject,
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_AUTH_TYPE,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -100,7 +101,7 @@ static DECT_SFMT_MSG_DESC(mm_authentication_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_authentication_reply,
+DECT_SFMT_MSG_DESC(mm_authentication_reply,
 	DECT_SFMT_IE(DECT_IE_RES,			IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_RS,			IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_ZAP_FIELD,			IE_NONE,      IE_OPTIONAL,  0),
@@ -112,7 +113,7 @@ static DECT_SFMT_MSG_DESC(mm_authentication_reply,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_authentication_request,
+DECT_SFMT_MSG_DESC(mm_authentication_request,
 	DECT_SFMT_IE(DECT_IE_AUTH_TYPE,			IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_RAND,			IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_RES,			IE_NONE,      IE_OPTIONAL,  0),
@@ -124,7 +125,7 @@ static DECT_SFMT_MSG_DESC(mm_authentication_request,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_cipher_suggest,
+DECT_SFMT_MSG_DESC(mm_cipher_suggest,
 	DECT_SFMT_IE(DECT_IE_CIPHER_INFO,		IE_NONE,      IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_CALL_IDENTITY,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CONNECTION_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
@@ -133,7 +134,7 @@ static DECT_SFMT_MSG_DESC(mm_cipher_suggest,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_cipher_request,
+DECT_SFMT_MSG_DESC(mm_cipher_request,
 	DECT_SFMT_IE(DECT_IE_CIPHER_INFO,		IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_CALL_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_CONNECTION_IDENTITY,	IE_OPTIONAL,  IE_NONE,      0),
@@ -142,7 +143,7 @@ static DECT_SFMT_MSG_DESC(mm_cipher_request,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_cipher_reject,
+DECT_SFMT_MSG_DESC(mm_cipher_reject,
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_CIPHER_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -150,7 +151,7 @@ static DECT_SFMT_MSG_DESC(mm_cipher_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_detach,
+DECT_SFMT_MSG_DESC(mm_detach,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_NETWORK_PARAMETER,		IE_NONE,      IE_OPTIONAL,  0),
@@ -161,7 +162,7 @@ static DECT_SFMT_MSG_DESC(mm_detach,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_identity_reply,
+DECT_SFMT_MSG_DESC(mm_identity_reply,
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_NONE,      IE_OPTIONAL,  0),
@@ -175,7 +176,7 @@ static DECT_SFMT_MSG_DESC(mm_identity_reply,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_identity_request,
+DECT_SFMT_MSG_DESC(mm_identity_request,
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_IDENTITY_TYPE,		IE_MANDATORY, IE_NONE,      DECT_SFMT_IE_REPEAT),
 	DECT_SFMT_IE(DECT_IE_NETWORK_PARAMETER,		IE_OPTIONAL,  IE_NONE,      0),
@@ -184,7 +185,7 @@ static DECT_SFMT_MSG_DESC(mm_identity_request,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_key_allocate,
+DECT_SFMT_MSG_DESC(mm_key_allocate,
 	DECT_SFMT_IE(DECT_IE_ALLOCATION_TYPE,		IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_RAND,			IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_RS,			IE_MANDATORY, IE_NONE,      0),
@@ -192,7 +193,7 @@ static DECT_SFMT_MSG_DESC(mm_key_allocate,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_locate_accept,
+DECT_SFMT_MSG_DESC(mm_locate_accept,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_LOCATION_AREA,		IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_USE_TPUI,			IE_OPTIONAL,  IE_NONE,      0),
@@ -209,7 +210,7 @@ static DECT_SFMT_MSG_DESC(mm_locate_accept,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_locate_reject,
+DECT_SFMT_MSG_DESC(mm_locate_reject,
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_DURATION,			IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -219,7 +220,7 @@ static DECT_SFMT_MSG_DESC(mm_locate_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_locate_request,
+DECT_SFMT_MSG_DESC(mm_locate_request,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_LOCATION_AREA,		IE_NONE,      IE_OPTIONAL,  0),
@@ -237,7 +238,7 @@ static DECT_SFMT_MSG_DESC(mm_locate_request,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_info_accept,
+DECT_SFMT_MSG_DESC(mm_info_accept,
 	DECT_SFMT_IE(DECT_IE_INFO_TYPE,			IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_CALL_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0),
@@ -252,7 +253,7 @@ static DECT_SFMT_MSG_DESC(mm_info_accept,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_info_reject,
+DECT_SFMT_MSG_DESC(mm_info_reject,
 	DECT_SFMT_IE(DECT_IE_CALL_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_SEGMENTED_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -261,7 +262,7 @@ static DECT_SFMT_MSG_DESC(mm_info_reject,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_info_request,
+DECT_SFMT_MSG_DESC(mm_info_request,
 	DECT_SFMT_IE(DECT_IE_INFO_TYPE,			IE_MANDATORY, IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_CALL_IDENTITY,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_NONE,      IE_OPTIONAL,  0),
@@ -276,7 +277,7 @@ static DECT_SFMT_MSG_DESC(mm_info_request,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_info_suggest,
+DECT_SFMT_MSG_DESC(mm_info_suggest,
 	DECT_SFMT_IE(DECT_IE_INFO_TYPE,			IE_MANDATORY, IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_CALL_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_FIXED_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
@@ -292,7 +293,7 @@ static DECT_SFMT_MSG_DESC(mm_info_suggest,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_temporary_identity_assign,
+DECT_SFMT_MSG_DESC(mm_temporary_identity_assign,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_LOCATION_AREA,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_NWK_ASSIGNED_IDENTITY,	IE_OPTIONAL,  IE_NONE,      0),
@@ -304,20 +305,20 @@ static DECT_SFMT_MSG_DESC(mm_temporary_identity_assign,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_temporary_identity_assign_ack,
+DECT_SFMT_MSG_DESC(mm_temporary_identity_assign_ack,
 	DECT_SFMT_IE(DECT_IE_SEGMENTED_INFO,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_IWU_TO_IWU,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_temporary_identity_assign_rej,
+DECT_SFMT_MSG_DESC(mm_temporary_identity_assign_rej,
 	DECT_SFMT_IE(DECT_IE_REJECT_REASON,		IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_NONE,      IE_OPTIONAL,  0),
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_iwu,
+DECT_SFMT_MSG_DESC(mm_iwu,
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_SEGMENTED_INFO,		IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
 	DECT_SFMT_IE(DECT_IE_IWU_TO_IWU,		IE_OPTIONAL,  IE_OPTIONAL,  0),
@@ -326,7 +327,7 @@ static DECT_SFMT_MSG_DESC(mm_iwu,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(mm_notify_msg,
+DECT_SFMT_MSG_DESC(mm_notify_msg,
 	DECT_SFMT_IE(DECT_IE_TIMER_RESTART,		IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE(DECT_IE_ESCAPE_TO_PROPRIETARY,	IE_OPTIONAL,  IE_NONE,      0),
 	DECT_SFMT_IE_END_MSG
@@ -401,6 +402,8 @@ static int dect_mm_procedure_initiate(struct dect_handle *dh,
 		dect_timer_start(dh, mp->timer, proc->param[dh->mode].timeout);
 
 	mme->current = mp;
+	dect_trace(dh, DECT_TRACE_MM_PROC_INITIATE, NULL, &mp->transaction,
+		   type, priority, 0, 0);
 	return 0;
 }
 
@@ -433,6 +436,8 @@ static int dect_mm_procedure_respond(struct dect_handle *dh,
 	mp->iec      = NULL;
 
 	mme->current = mp;
+	dect_trace(dh, DECT_TRACE_MM_PROC_RESPOND, mme->link, NULL,
+		   type, priority, 0, 0);
 	return 0;
 }
 
@@ -441,6 +446,8 @@ static void dect_mm_procedure_complete(struct dect_handle *dh,
 {
 	struct dect_mm_procedure *mp = mme->current;
 	mm_debug(mme, "complete %s procedure", dect_mm_proc[mp->type].name);
+	dect_trace(dh, DECT_TRACE_MM_PROC_COMPLETE, NULL, &mp->transaction,
+		   mp->type, mp->priority, 0, 0);
 
 	if (dect_timer_running(mp->timer))
 		dect_timer_stop(dh, mp->timer);
@@ -469,6 +476,8 @@ static void dect_mm_procedure_timeout(struct dect_handle *dh,
 
 	mme = container_of(mp, struct dect_mm_endpoint, procedure[mp->role]);
 	dect_debug(DECT_DEBUG_MM, "\n");
+	dect_trace(dh, DECT_TRACE_MM_PROC_TIMEOUT, NULL, &mp->transaction,
+		   type, mp->retransmissions, 0, 0);
 	if (mp->retransmissions++ == 0) {
 		mm_debug(mme, "timeout, retransmitting");
 		dect_lce_retransmit(dh, &mp->transaction);
@@ -1066,7 +1075,7 @@ int dect_mm_cipher_req(struct dect_handle *dh, struct dect_mm_endpoint *mme,
 	if (err < 0)
 		goto err1;
 
-	err = dect_ddl_set_cipher_key(mme->link, ck);
+	err = dect_ddl_set_cipher_key(dh, mme->link, ck);
 	if (err < 0)
 		goto err2;
 
@@ -1131,9 +1140,9 @@ void dect_mm_cipher_res(struct dect_handle *dh, struct dect_mm_endpoint *mme,
 		return;
 
 	if (accept) {
-		if (dect_ddl_set_cipher_key(mme->link, ck) < 0)
+		if (dect_ddl_set_cipher_key(dh, mme->link, ck) < 0)
 			goto out;
-		dect_ddl_encrypt_req(mme->link, DECT_CIPHER_ENABLED);
+		dect_ddl_encrypt_req(dh, mme->link, DECT_CIPHER_ENABLED);
 	} else
 		dect_mm_send_cipher_reject(dh, mme, param);
 
@@ -1916,8 +1925,10 @@ static int dect_mm_send_locate_accept(const struct dect_handle *dh,
 		.model_identifier	= param->model_identifier,
 	};
 
-	return dect_mm_send_msg(dh, mme, &mm_locate_accept_msg_desc,
-				&msg.common, DECT_MM_LOCATE_ACCEPT);
+	return dect_lce_send_tmpl(dh, &mme->current->transaction,
+				  DECT_TMPL_MM_LOCATE_ACCEPT,
+				  &mm_locate_accept_msg_desc,
+				  &msg.common, DECT_MM_LOCATE_ACCEPT);
 }
 
 static int dect_mm_send_locate_reject(const struct dect_handle *dh,
@@ -2723,8 +2734,10 @@ static int dect_mm_send_info_accept(const struct dect_handle *dh,
 		.escape_to_proprietary	= param->escape_to_proprietary,
 	};
 
-	return dect_mm_send_msg(dh, mme, &mm_info_accept_msg_desc,
-				&msg.common, DECT_MM_INFO_ACCEPT);
+	return dect_lce_send_tmpl(dh, &mme->current->transaction,
+				  DECT_TMPL_MM_INFO_ACCEPT,
+				  &mm_info_accept_msg_desc,
+				  &msg.common, DECT_MM_INFO_ACCEPT);
 }
 
 static int dect_mm_send_info_reject(const struct dect_handle *dh,
@@ -55,6 +55,9 @@ static void __maybe_unused dect_netlink_obj_dump(struct nl_object *obj)
 		.dp_buflen	= sizeof(buf),
 	};
 
+	if (!dect_debug_enabled(DECT_DEBUG_NL))
+		return;
+
 	buf[0] = '\0';
 	nl_object_dump(obj, &dp);
 	dect_debug(DECT_DEBUG_NL, "%s", buf);
@@ -223,6 +226,9 @@ static void dect_fp_capabilities_dump(const struct dect_fp_capabilities *fpc)
 {
 	char buf1[512], buf2[512], buf3[512];
 
+	if (!dect_debug_enabled(DECT_DEBUG_NL))
+		return;
+
 	nl_dect_llme_fpc2str(fpc->fpc, buf1, sizeof(buf1));
 	nl_dect_llme_efpc2str(fpc->efpc, buf2, sizeof(buf2));
 	nl_dect_llme_efpc22str(fpc->efpc2, buf3, sizeof(buf3));
@@ -309,6 +315,14 @@ int dect_llme_rfp_preload_req(struct dect_handle *dh,
 	nl_debug_entry("MAC_ME_RFP_PRELOAD-req\n");
 	dect_fp_capabilities_dump(fpc);
 
+	/* Transports without a MAC layer only keep the handle state */
+	if (dh->nlsock == NULL) {
+		dh->fpc.hlc   = fpc->hlc;
+		dh->fpc.ehlc  = fpc->ehlc;
+		dh->fpc.ehlc2 = fpc->ehlc2;
+		return 0;
+	}
+
 	lmsg = dect_llme_msg_init(dh, DECT_LLME_MAC_RFP_PRELOAD, DECT_LLME_REQUEST);
 	if (lmsg == NULL)
 		return -1;
@@ -343,6 +357,11 @@ int dect_llme_mac_me_info_res(struct dect_handle *dh, const struct dect_ari *par
 	int err;
 
 	nl_debug_entry("MAC_ME_INFO-res\n");
+	if (dh->nlsock == NULL) {
+		dh->pari = *pari;
+		return 0;
+	}
+
 	lmsg = dect_llme_msg_init(dh, DECT_LLME_MAC_INFO, DECT_LLME_RESPONSE);
 	if (lmsg == NULL)
 		return -1;
@@ -390,6 +409,11 @@ int dect_llme_scan_req(struct dect_handle *dh)
 	int err;
 
 	nl_debug_entry("SCAN-req\n");
+	if (dh->nlsock == NULL) {
+		memset(&dh->pari, 0, sizeof(dh->pari));
+		return 0;
+	}
+
 	lmsg = dect_llme_msg_init(dh, DECT_LLME_SCAN, DECT_LLME_REQUEST);
 	if (lmsg == NULL)
 		return -1;
@@ -29,6 +29,7 @@
 #include <libdect.h>
 #include <utils.h>
 #include <io.h>
+#include <capture.h>
 #include <dect/raw.h>
 
 static void dect_raw_fill_sockaddr(struct dect_handle *dh,
@@ -83,41 +84,20 @@ ssize_t dect_raw_transmit(struct dect_handle *dh, struct dect_fd *dfd,
 	aux.slot		= slot;
 	memcpy(CMSG_DATA(cmsg), &aux, sizeof(aux));
 
+	dect_capture_mbuf(dh, DECT_CAPTURE_RAW, DECT_CAPTURE_TX, 0,
+			  NULL, &aux, mb);
 	return sendmsg(dfd->fd, &msg, 0);
 }
 EXPORT_SYMBOL(dect_raw_transmit);
 
-static void dect_raw_event(struct dect_handle *dh, struct dect_fd *dfd,
-			   uint32_t events)
+static void dect_raw_rcv(struct dect_handle *dh, struct dect_fd *dfd,
+			 struct msghdr *msg, struct dect_msg_buf *mb)
 {
-	DECT_DEFINE_MSG_BUF_ONSTACK(_mb), *mb = &_mb;
-	struct msghdr msg;
 	struct dect_raw_auxdata *aux;
 	struct cmsghdr *cmsg;
-	char cmsg_buf[4 * CMSG_SPACE(16)];
-	struct iovec iov;
-	ssize_t len;
-
-	dect_assert(!(events & ~DECT_FD_READ));
-
-	msg.msg_name		= NULL;
-	msg.msg_namelen		= 0;
-	msg.msg_control		= cmsg_buf;
-	msg.msg_controllen	= sizeof(cmsg_buf);
-	msg.msg_iov		= &iov;
-	msg.msg_iovlen		= 1;
-	msg.msg_flags		= 0;
-
-	iov.iov_base		= mb->data;
-	iov.iov_len		= sizeof(mb->head);
-
-	len = recvmsg(dfd->fd, &msg, 0);
-	if (len < 0)
-		return;
-	mb->len = len;
 
 	aux = NULL;
-	for (cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+	for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
 		if (cmsg->cmsg_level != SOL_DECT)
 			continue;
 
@@ -139,9 +119,42 @@ static void dect_raw_event(struct dect_handle *dh, struct dect_fd *dfd,
 	mb->frame = aux->frame;
 	mb->slot  = aux->slot;
 
+	dect_capture_mbuf(dh, DECT_CAPTURE_RAW, DECT_CAPTURE_RX, 0,
+			  NULL, aux, mb);
 	dh->ops->raw_ops->raw_rcv(dh, dfd, mb);
 }
 
+static void dect_raw_event(struct dect_handle *dh, struct dect_fd *dfd,
+			   uint32_t events)
+{
+	struct dect_rx_batch *rxb = dh->rxb;
+	unsigned int budget, i;
+	int n;
+
+	dect_assert(!(events & ~DECT_FD_READ));
+
+	budget = dect_rx_budget(dh);
+	while (budget > 0) {
+		n = dect_rx_batch_rcv(dh, dfd, budget);
+		if (n < 0)
+			return;
+
+		for (i = 0; i < (unsigned int)n; i++) {
+			dect_raw_rcv(dh, dfd, &rxb->msg[i].msg_hdr, &rxb->mb[i]);
+
+			/* The callback may have closed the socket */
+			if (dfd->flags & DECT_FD_DESTROYED)
+				return;
+		}
+
+		if ((unsigned int)n < min(budget, (unsigned int)DECT_RX_BATCH_SIZE))
+			return;
+		budget -= n;
+	}
+
+	dfd->flags |= DECT_FD_PENDING;
+}
+
 /**
  * Open a new DECT raw socket
  *
@@ -163,10 +176,11 @@ struct dect_fd *dect_raw_open(struct dect_handle *dh)
 
 	dect_raw_fill_sockaddr(dh, &da);
 
-	if (bind(dfd->fd, (struct sockaddr *)&da, sizeof(da)) < 0)
+	if (dect_bind(dh, dfd, (struct sockaddr *)&da, sizeof(da)) < 0)
 		goto err2;
 
 	dect_fd_setup(dfd, dect_raw_event, dfd);
+	dfd->flags |= DECT_FD_DRAIN;
 	if (dect_fd_register(dh, dfd, DECT_FD_READ) < 0)
 		goto err2;
 out:
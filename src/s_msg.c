@@ -30,6 +30,7 @@
 #include <utils.h>
 #include <s_fmt.h>
 #include <lce.h>
+#include <trace.h>
 
 #define sfmt_debug(fmt, args...) \
 	dect_debug(DECT_DEBUG_SFMT, fmt, ## args)
@@ -74,20 +75,6 @@ static int dect_sfmt_build_repeat_indicator(struct dect_sfmt_ie *dst,
 	return 0;
 }
 
-static int dect_sfmt_parse_empty_single_octet(const struct dect_handle *dh,
-					      struct dect_ie_common **ie,
-					      const struct dect_sfmt_ie *src)
-{
-	return 0;
-}
-
-static int dect_sfmt_build_empty_single_octet(struct dect_sfmt_ie *dst,
-					      const struct dect_ie_common *ie)
-{
-	dst->data[0] = 0;
-	return 0;
-}
-
 static const struct dect_trans_tbl dect_call_classes[] = {
 	TRANS_TBL(DECT_CALL_CLASS_LIA_SERVICE_SETUP,		"LiA service call setup"),
 	TRANS_TBL(DECT_CALL_CLASS_MESSAGE,			"message call"),
@@ -113,38 +100,6 @@ static const struct dect_trans_tbl dect_basic_services[] = {
 	TRANS_TBL(DECT_SERVICE_OTHER,				"Other"),
 };
 
-static void dect_sfmt_dump_basic_service(const struct dect_ie_common *_ie)
-{
-	const struct dect_ie_basic_service *ie = dect_ie_container(ie, _ie);
-	char buf[128];
-
-	sfmt_debug("\tcall class: %s\n",
-		   dect_val2str(dect_call_classes, buf, ie->class));
-	sfmt_debug("\tservice: %s\n",
-		   dect_val2str(dect_basic_services, buf, ie->service));
-}
-
-static int dect_sfmt_parse_basic_service(const struct dect_handle *dh,
-					 struct dect_ie_common **ie,
-					 const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_basic_service *dst = dect_ie_container(dst, *ie);
-
-	dst->class   = src->data[1] >> DECT_BASIC_SERVICE_CALL_CLASS_SHIFT;
-	dst->service = src->data[1] & DECT_BASIC_SERVICE_SERVICE_MASK;
-	return 0;
-}
-
-static int dect_sfmt_build_basic_service(struct dect_sfmt_ie *dst,
-					 const struct dect_ie_common *ie)
-{
-	struct dect_ie_basic_service *src = dect_ie_container(src, ie);
-
-	dst->data[1]  = src->class << DECT_BASIC_SERVICE_CALL_CLASS_SHIFT;
-	dst->data[1] |= src->service;
-	return 0;
-}
-
 static void dect_sfmt_dump_display(const struct dect_ie_common *_ie)
 {
 	const struct dect_ie_display *ie = dect_ie_container(ie, _ie);
@@ -246,6 +201,8 @@ static int dect_sfmt_build_info_type(struct dect_sfmt_ie *dst,
 	struct dect_ie_info_type *ie = dect_ie_container(ie, src);
 	unsigned int n = 2, i;
 
+	if (ie->num > array_size(ie->type))
+		return -1;
 	for (i = 0; i < ie->num; i++)
 		dst->data[n++] = ie->type[i];
 	dst->data[n - 1] |= DECT_OCTET_GROUP_END;
@@ -344,6 +301,8 @@ static int dect_sfmt_parse_identity_type(const struct dect_handle *dh,
 {
 	struct dect_ie_identity_type *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 4)
+		return -1;
 	dst->group = src->data[2] & ~DECT_OCTET_GROUP_END;
 	dst->type  = src->data[3] & ~DECT_OCTET_GROUP_END;
 	return 0;
@@ -384,34 +343,6 @@ static const struct dect_trans_tbl dect_release_reasons[] = {
 	TRANS_TBL(DECT_RELEASE_REKEYING_FAILED,			"Rekeying failed"),
 };
 
-static void dect_sfmt_dump_release_reason(const struct dect_ie_common *_ie)
-{
-	const struct dect_ie_release_reason *ie = dect_ie_container(ie, _ie);
-	char buf[128];
-
-	sfmt_debug("\trelease reason: %s\n",
-		   dect_val2str(dect_release_reasons, buf, ie->reason));
-}
-
-static int dect_sfmt_parse_release_reason(const struct dect_handle *dh,
-					  struct dect_ie_common **ie,
-					  const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_release_reason *dst = dect_ie_container(dst, *ie);
-
-	dst->reason = src->data[1];
-	return 0;
-}
-
-static int dect_sfmt_build_release_reason(struct dect_sfmt_ie *dst,
-					  const struct dect_ie_common *ie)
-{
-	struct dect_ie_release_reason *src = dect_ie_container(src, ie);
-
-	dst->data[1] = src->reason;
-	return 0;
-}
-
 static const struct dect_trans_tbl dect_signal_codes[] = {
 	TRANS_TBL(DECT_SIGNAL_DIAL_TONE_ON,				"ring tone on"),
 	TRANS_TBL(DECT_SIGNAL_RING_BACK_TONE_ON,			"ring-back tone on"),
@@ -436,33 +367,6 @@ static const struct dect_trans_tbl dect_signal_codes[] = {
 	TRANS_TBL(DECT_SIGNAL_ALERTING_BASE + DECT_ALERTING_OFF,	"ring off"),
 };
 
-static void dect_sfmt_dump_signal(const struct dect_ie_common *_ie)
-{
-	struct dect_ie_signal *ie = dect_ie_container(ie, _ie);
-	char buf[128];
-
-	sfmt_debug("\tsignal: %s\n", dect_val2str(dect_signal_codes, buf, ie->code));
-}
-
-static int dect_sfmt_parse_signal(const struct dect_handle *dh,
-				  struct dect_ie_common **ie,
-				  const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_signal *dst = dect_ie_container(dst, *ie);
-
-	dst->code = src->data[1];
-	return 0;
-}
-
-static int dect_sfmt_build_signal(struct dect_sfmt_ie *dst,
-				  const struct dect_ie_common *src)
-{
-	struct dect_ie_signal *ie = dect_ie_container(ie, src);
-
-	dst->data[1] = ie->code;
-	return 0;
-}
-
 static int dect_sfmt_parse_timer_restart(const struct dect_handle *dh,
 					 struct dect_ie_common **ie,
 					 const struct dect_sfmt_ie *src)
@@ -517,6 +421,8 @@ static int dect_sfmt_parse_portable_identity(const struct dect_handle *dh,
 	if (!(src->data[3] & DECT_OCTET_GROUP_END))
 		return -1;
 	len = src->data[3] & ~DECT_OCTET_GROUP_END;
+	if (src->len < 4 + div_round_up(len, 8))
+		return -1;
 
 	switch (dst->type) {
 	case DECT_PORTABLE_ID_TYPE_IPUI:
@@ -590,7 +496,7 @@ static int dect_sfmt_parse_fixed_identity(const struct dect_handle *dh,
 					  const struct dect_sfmt_ie *src)
 {
 	struct dect_ie_fixed_identity *dst = dect_ie_container(dst, *ie);
-	uint8_t len, ari_len;
+	uint8_t buf[8], len, ari_len;
 	uint64_t ari;
 
 	if (src->len < DECT_IE_FIXED_IDENTITY_MIN_SIZE)
@@ -604,7 +510,10 @@ static int dect_sfmt_parse_fixed_identity(const struct dect_handle *dh,
 		return -1;
 	len = src->data[3] & ~DECT_OCTET_GROUP_END;
 
-	ari  = __be64_to_cpu(*(__be64 *)&src->data[4]);
+	/* The ARI may be shorter than 64 bits, don't read beyond the IE */
+	memset(buf, 0, sizeof(buf));
+	memcpy(buf, src->data + 4, min(src->len - 4U, (unsigned int)sizeof(buf)));
+	ari  = __be64_to_cpu(*(__be64 *)buf);
 	ari_len = dect_parse_ari(&dst->ari, ari << 1);
 	if (ari_len == 0)
 		return -1;
@@ -640,36 +549,6 @@ static int dect_sfmt_build_fixed_identity(struct dect_sfmt_ie *dst,
 	return 0;
 }
 
-static void dect_sfmt_dump_location_area(const struct dect_ie_common *_ie)
-{
-	const struct dect_ie_location_area *ie = dect_ie_container(ie, _ie);
-
-	sfmt_debug("\ttype: %x level: %u\n", ie->type, ie->level);
-}
-
-static int dect_sfmt_parse_location_area(const struct dect_handle *dh,
-					 struct dect_ie_common **ie,
-					 const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_location_area *dst = dect_ie_container(dst, *ie);
-
-	dst->type  = (src->data[2] & DECT_LOCATION_AREA_TYPE_MASK) >>
-		     DECT_LOCATION_AREA_TYPE_SHIFT;
-	dst->level = (src->data[2] & DECT_LOCATION_LEVEL_MASK);
-	return 0;
-}
-
-static int dect_sfmt_build_location_area(struct dect_sfmt_ie *dst,
-					 const struct dect_ie_common *ie)
-{
-	struct dect_ie_location_area *src = dect_ie_container(src, ie);
-
-	dst->data[2]  = src->type << DECT_LOCATION_AREA_TYPE_SHIFT;
-	dst->data[2] |= src->level;
-	dst->len = 3;
-	return 0;
-}
-
 static const struct dect_trans_tbl dect_auth_algs[] = {
 	TRANS_TBL(DECT_AUTH_DSAA,			"DSAA"),
 	TRANS_TBL(DECT_AUTH_GSM,			"GSM"),
@@ -683,41 +562,6 @@ static const struct dect_trans_tbl dect_auth_key_types[] = {
 	TRANS_TBL(DECT_KEY_AUTHENTICATION_CODE,		"Authentication code"),
 };
 
-static void dect_sfmt_dump_allocation_type(const struct dect_ie_common *_ie)
-{
-	const struct dect_ie_allocation_type *ie = dect_ie_container(ie, _ie);
-	char buf[128];
-
-	sfmt_debug("\tauthentication algorithm: %s\n",
-		   dect_val2str(dect_auth_algs, buf, ie->auth_id));
-	sfmt_debug("\tauthentication key number: %u\n", ie->auth_key_num);
-	sfmt_debug("\tauthentication code number: %u\n", ie->auth_code_num);
-}
-
-static int dect_sfmt_parse_allocation_type(const struct dect_handle *dh,
-					   struct dect_ie_common **ie,
-					   const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_allocation_type *dst = dect_ie_container(dst, *ie);
-
-	dst->auth_id = src->data[2];
-	dst->auth_key_num  = (src->data[3] & 0xf0) >> 4;
-	dst->auth_code_num = (src->data[3] & 0x0f);
-	return 0;
-}
-
-static int dect_sfmt_build_allocation_type(struct dect_sfmt_ie *dst,
-					   const struct dect_ie_common *ie)
-{
-	struct dect_ie_allocation_type *src = dect_ie_container(src, ie);
-
-	dst->data[2]  = src->auth_id;
-	dst->data[3]  = src->auth_key_num << 4;
-	dst->data[3] |= src->auth_code_num;
-	dst->len = 4;
-	return 0;
-}
-
 static const struct dect_trans_tbl dect_auth_flags[] = {
 	TRANS_TBL(DECT_AUTH_FLAG_INC,		"INC"),
 	TRANS_TBL(DECT_AUTH_FLAG_DEF,		"DEF"),
@@ -750,9 +594,14 @@ static int dect_sfmt_parse_auth_type(const struct dect_handle *dh,
 	struct dect_ie_auth_type *dst = dect_ie_container(dst, *ie);
 	uint8_t n = 2;
 
+	if (src->len < 5)
+		return -1;
 	dst->auth_id = src->data[n++];
-	if (dst->auth_id == DECT_AUTH_PROPRIETARY)
-		dst->proprietary_auth_id = src->data[n]++;
+	if (dst->auth_id == DECT_AUTH_PROPRIETARY) {
+		if (src->len < 6)
+			return -1;
+		dst->proprietary_auth_id = src->data[n++];
+	}
 
 	dst->auth_key_type  = (src->data[n] & 0xf0) >> 4;
 	dst->auth_key_num   = (src->data[n] & 0x0f);
@@ -763,10 +612,12 @@ static int dect_sfmt_parse_auth_type(const struct dect_handle *dh,
 	n++;
 
 	/* Octets 5a and 5b are only present if the DEF flag is set */
-	if (dst->flags & DECT_AUTH_FLAG_DEF)
+	if (dst->flags & DECT_AUTH_FLAG_DEF) {
+		if (src->len < n + 2)
+			return -1;
 		dst->defck_index = src->data[n] << 8 |
 				   src->data[n + 1];
-
+	}
 	return 0;
 }
 
@@ -889,6 +740,8 @@ static int dect_sfmt_parse_service_change_info(const struct dect_handle *dh,
 {
 	struct dect_ie_service_change_info *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 3)
+		return -1;
 	dst->master = src->data[2] & 0x40;
 	dst->mode   = src->data[2] & 0x0f;
 	return 0;
@@ -974,6 +827,8 @@ static int dect_sfmt_parse_facility(const struct dect_handle *dh,
 {
 	struct dect_ie_facility *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 3)
+		return -1;
 	dst->service = src->data[2] & 0x1f;
 	dst->len = src->len - 3;
 	if (dst->len > array_size(dst->components))
@@ -1004,39 +859,6 @@ static const struct dect_trans_tbl dect_progress_descriptions[] = {
 	TRANS_TBL(DECT_PROGRESS_END_TO_END_ISDN,			"Call is end-to-end PLMN/ISDN"),
 };
 
-static void dect_sfmt_dump_progress_indicator(const struct dect_ie_common *_ie)
-{
-	const struct dect_ie_progress_indicator *ie = dect_ie_container(ie, _ie);
-	char buf[128];
-
-	sfmt_debug("\tLocation: %s\n",
-		   dect_val2str(dect_locations, buf, ie->location));
-	sfmt_debug("\tProgress description: %s\n",
-		   dect_val2str(dect_progress_descriptions, buf, ie->progress));
-}
-
-static int dect_sfmt_parse_progress_indicator(const struct dect_handle *dh,
-					      struct dect_ie_common **ie,
-					      const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_progress_indicator *dst = dect_ie_container(dst, *ie);
-
-	dst->location = src->data[2] & DECT_SFMT_IE_PROGRESS_INDICATOR_LOCATION_MASK;
-	dst->progress = src->data[3] & ~DECT_OCTET_GROUP_END;
-	return 0;
-}
-
-static int dect_sfmt_build_progress_indicator(struct dect_sfmt_ie *dst,
-					      const struct dect_ie_common *ie)
-{
-	struct dect_ie_progress_indicator *src = dect_ie_container(src, ie);
-
-	dst->data[3] = DECT_OCTET_GROUP_END | src->progress;
-	dst->data[2] = DECT_OCTET_GROUP_END | src->location;
-	dst->len = 4;
-	return 0;
-}
-
 static const struct dect_trans_tbl dect_time_date_codings[] = {
 	TRANS_TBL(DECT_TIME_DATE_TIME,		"Time"),
 	TRANS_TBL(DECT_TIME_DATE_DATE,		"Date"),
@@ -1082,10 +904,16 @@ static int dect_sfmt_parse_time_date(const struct dect_handle *dh,
 	struct dect_ie_time_date *dst = dect_ie_container(dst, *ie);
 	unsigned int n;
 
+	if (src->len < 3)
+		return -1;
 	dst->coding         = src->data[2] >> 6;
 	dst->interpretation = src->data[2] & 0x3f;
 	n = 3;
 
+	if (src->len < n + (dst->coding & 0x2 ? 3 : 0) +
+			   (dst->coding & 0x1 ? 4 : 0))
+		return -1;
+
 	if (dst->coding & 0x2) {
 		dst->year     = src->data[n++];
 		dst->month    = src->data[n++];
@@ -1144,13 +972,19 @@ static int dect_sfmt_parse_multi_display(const struct dect_handle *dh,
 static int dect_sfmt_build_multi_display(struct dect_sfmt_ie *dst,
 					 const struct dect_ie_common *ie)
 {
-	struct dect_ie_display *src = dect_ie_container(src, ie);
-
-	memcpy(dst->data + 2, src->info, src->len);
-	dst->len = src->len + 2;
+	dst->len = 2;
 	return 0;
 }
 
+static unsigned int dect_sfmt_payload_multi_display(const struct dect_ie_common *ie,
+						    const uint8_t **data)
+{
+	const struct dect_ie_display *src = dect_ie_container(src, ie);
+
+	*data = src->info;
+	return src->len;
+}
+
 static int dect_sfmt_parse_multi_keypad(const struct dect_handle *dh,
 					struct dect_ie_common **ie,
 					const struct dect_sfmt_ie *src)
@@ -1167,13 +1001,19 @@ static int dect_sfmt_parse_multi_keypad(const struct dect_handle *dh,
 static int dect_sfmt_build_multi_keypad(struct dect_sfmt_ie *dst,
 					const struct dect_ie_common *ie)
 {
-	struct dect_ie_keypad *src = dect_ie_container(src, ie);
-
-	memcpy(dst->data + 2, src->info, src->len);
-	dst->len = src->len + 2;
+	dst->len = 2;
 	return 0;
 }
 
+static unsigned int dect_sfmt_payload_multi_keypad(const struct dect_ie_common *ie,
+						   const uint8_t **data)
+{
+	const struct dect_ie_keypad *src = dect_ie_container(src, ie);
+
+	*data = src->info;
+	return src->len;
+}
+
 static const struct dect_trans_tbl dect_features[] = {
 	TRANS_TBL(DECT_FEATURE_REGISTER_RECALL,			"register recall"),
 	TRANS_TBL(DECT_FEATURE_EXTERNAL_HO_SWITCH,		"external handover switch"),
@@ -1186,35 +1026,6 @@ static const struct dect_trans_tbl dect_features[] = {
 	TRANS_TBL(DECT_FEATURE_COST_INFORMATION,		"cost information"),
 };
 
-static void dect_sfmt_dump_feature_activate(const struct dect_ie_common *_ie)
-{
-	const struct dect_ie_feature_activate *ie = dect_ie_container(ie, _ie);
-	char buf[128];
-
-	sfmt_debug("\tfeature: %s\n", dect_val2str(dect_features, buf, ie->feature));
-}
-
-static int dect_sfmt_parse_feature_activate(const struct dect_handle *dh,
-					    struct dect_ie_common **ie,
-					    const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_feature_activate *dst = dect_ie_container(dst, *ie);
-
-	dst->feature = src->data[2] & ~DECT_OCTET_GROUP_END;
-	return 0;
-}
-
-static int dect_sfmt_build_feature_activate(struct dect_sfmt_ie *dst,
-					    const struct dect_ie_common *ie)
-{
-	struct dect_ie_feature_activate *src = dect_ie_container(src, ie);
-
-	dst->data[2]  = src->feature;
-	dst->data[2] |= DECT_OCTET_GROUP_END;
-	dst->len = 3;
-	return 0;
-}
-
 static void dect_sfmt_dump_feature_indicate(const struct dect_ie_common *_ie)
 {
 	const struct dect_ie_feature_indicate *ie = dect_ie_container(ie, _ie);
@@ -1230,6 +1041,8 @@ static int dect_sfmt_parse_feature_indicate(const struct dect_handle *dh,
 {
 	struct dect_ie_feature_indicate *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 4)
+		return -1;
 	dst->feature = src->data[2] & ~DECT_OCTET_GROUP_END;
 	dst->status  = src->data[3];
 	return 0;
@@ -1265,6 +1078,8 @@ static int dect_sfmt_parse_network_parameter(const struct dect_handle *dh,
 {
 	struct dect_ie_network_parameter *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 3)
+		return -1;
 	dst->discriminator = src->data[2];
 	dst->len = src->len - 3;
 	if (dst->len > array_size(dst->data))
@@ -1278,6 +1093,8 @@ static int dect_sfmt_build_network_parameter(struct dect_sfmt_ie *dst,
 {
 	const struct dect_ie_network_parameter *src = dect_ie_container(src, ie);
 
+	if (src->len > array_size(src->data))
+		return -1;
 	dst->data[2] = src->discriminator;
 	memcpy(dst->data + 3, src->data, src->len);
 	dst->len = src->len + 3;
@@ -1318,58 +1135,6 @@ static const struct dect_trans_tbl dect_reject_reasons[] = {
 	TRANS_TBL(DECT_REJECT_LOCATION_NATIONAL_ROAMING_NOT_ALLOWED,	"national roaming not allowed"),
 };
 
-static void dect_sfmt_dump_reject_reason(const struct dect_ie_common *_ie)
-{
-	struct dect_ie_reject_reason *ie = dect_ie_container(ie, _ie);
-	char buf[128];
-
-	sfmt_debug("\treject reason: %s\n",
-		   dect_val2str(dect_reject_reasons, buf, ie->reason));
-}
-
-static int dect_sfmt_parse_reject_reason(const struct dect_handle *dh,
-					 struct dect_ie_common **ie,
-					 const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_reject_reason *dst = dect_ie_container(dst, *ie);
-
-	dst->reason = src->data[2];
-	return 0;
-}
-
-static int dect_sfmt_build_reject_reason(struct dect_sfmt_ie *dst,
-					 const struct dect_ie_common *ie)
-{
-	struct dect_ie_reject_reason *src = dect_ie_container(src, ie);
-
-	dst->data[2] = src->reason;
-	dst->len = 3;
-	return 0;
-}
-
-static int dect_sfmt_parse_setup_capability(const struct dect_handle *dh,
-					    struct dect_ie_common **ie,
-					    const struct dect_sfmt_ie *src)
-{
-	struct dect_ie_setup_capability *dst = dect_ie_container(dst, *ie);
-
-	dst->page_capability  = (src->data[2] & 0x3);
-	dst->setup_capability = (src->data[2] & 0xc) >> 2;
-	return 0;
-}
-
-static int dect_sfmt_build_setup_capability(struct dect_sfmt_ie *dst,
-					    const struct dect_ie_common *ie)
-{
-	struct dect_ie_setup_capability *src = dect_ie_container(src, ie);
-
-	dst->data[2]  = src->page_capability;
-	dst->data[2] |= src->setup_capability << 2;
-	dst->data[2] |= DECT_OCTET_GROUP_END;
-	dst->len = 3;
-	return 0;
-}
-
 static const struct dect_trans_tbl dect_display_capabilities[] = {
 	TRANS_TBL(DECT_DISPLAY_CAPABILITY_NOT_APPLICABLE,	"not applicable"),
 	TRANS_TBL(DECT_DISPLAY_CAPABILITY_NO_DISPLAY,		"no display"),
@@ -1504,73 +1269,83 @@ static int dect_sfmt_parse_terminal_capability(const struct dect_handle *dh,
 					       const struct dect_sfmt_ie *src)
 {
 	struct dect_ie_terminal_capability *dst = dect_ie_container(dst, *ie);
+	uint8_t data[DECT_IE_TERMINAL_CAPABILITY_MAX_SIZE];
 	uint8_t i, n = 2;
 
+	/*
+	 * The octet groups are terminated by the extension bit, parse from a
+	 * zero padded copy to avoid reading beyond the end of truncated IEs.
+	 */
+	if (src->len < 3)
+		return -1;
+	memset(data, 0, sizeof(data));
+	memcpy(data, src->data, min(src->len, (uint16_t)sizeof(data)));
+
 	/* Octet group 3 */
-	dst->display = (src->data[n] & DECT_TERMINAL_CAPABILITY_DISPLAY_MASK);
-	dst->tone    = (src->data[n] & DECT_TERMINAL_CAPABILITY_TONE_MASK) >>
+	dst->display = (data[n] & DECT_TERMINAL_CAPABILITY_DISPLAY_MASK);
+	dst->tone    = (data[n] & DECT_TERMINAL_CAPABILITY_TONE_MASK) >>
 		       DECT_TERMINAL_CAPABILITY_TONE_SHIFT;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 
-	dst->echo	     = (src->data[n] & DECT_TERMINAL_CAPABILITY_ECHO_MASK) >>
+	dst->echo	     = (data[n] & DECT_TERMINAL_CAPABILITY_ECHO_MASK) >>
 			       DECT_TERMINAL_CAPABILITY_ECHO_SHIFT;
-	dst->noise_rejection = (src->data[n] & DECT_TERMINAL_CAPABILITY_NOISE_MASK) >>
+	dst->noise_rejection = (data[n] & DECT_TERMINAL_CAPABILITY_NOISE_MASK) >>
 			       DECT_TERMINAL_CAPABILITY_NOISE_SHIFT;
-	dst->volume_ctrl     = (src->data[n] & DECT_TERMINAL_CAPABILITY_VOLUME_MASK);
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->volume_ctrl     = (data[n] & DECT_TERMINAL_CAPABILITY_VOLUME_MASK);
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 
-	dst->slot = src->data[n] & ~DECT_OCTET_GROUP_END;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->slot = data[n] & ~DECT_OCTET_GROUP_END;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 
-	dst->display_memory = src->data[n] & ~DECT_OCTET_GROUP_END;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->display_memory = data[n] & ~DECT_OCTET_GROUP_END;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 	dst->display_memory <<= 7;
 
-	dst->display_memory += src->data[n] & ~DECT_OCTET_GROUP_END;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->display_memory += data[n] & ~DECT_OCTET_GROUP_END;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 
-	dst->display_lines   = src->data[n] & ~DECT_OCTET_GROUP_END;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->display_lines   = data[n] & ~DECT_OCTET_GROUP_END;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 
-	dst->display_columns = src->data[n] & ~DECT_OCTET_GROUP_END;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->display_columns = data[n] & ~DECT_OCTET_GROUP_END;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 
-	dst->scrolling	     = src->data[n] & ~DECT_OCTET_GROUP_END;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->scrolling	     = data[n] & ~DECT_OCTET_GROUP_END;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group4;
 
 group4:
 	dst->profile_indicator = 0;
 	for (i = 0; i < 8; i++) {
 		dst->profile_indicator |=
-			(uint64_t)(src->data[n] & ~DECT_OCTET_GROUP_END) <<
+			(uint64_t)(data[n] & ~DECT_OCTET_GROUP_END) <<
 			(64 - 8 * (i + 1));
-		if (src->data[n++] & DECT_OCTET_GROUP_END)
+		if (data[n++] & DECT_OCTET_GROUP_END)
 			goto group5;
 	}
 
 group5:
-	dst->display_control = src->data[n] & 0x7;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->display_control = data[n] & 0x7;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group6;
-	dst->display_charsets = src->data[n] & ~DECT_OCTET_GROUP_END;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	dst->display_charsets = data[n] & ~DECT_OCTET_GROUP_END;
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group6;
 
 group6:
 	/* Older equipment may not include octet group 6 */
 	if (n == src->len)
 		goto group7;
-	if (src->data[n++] & DECT_OCTET_GROUP_END)
+	if (data[n++] & DECT_OCTET_GROUP_END)
 		goto group7;
-	if (!(src->data[n++] & DECT_OCTET_GROUP_END))
+	if (!(data[n++] & DECT_OCTET_GROUP_END))
 		return -1;
 
 group7:
@@ -1684,11 +1459,15 @@ static int dect_sfmt_parse_calling_party_number(const struct dect_handle *dh,
 	struct dect_ie_calling_party_number *dst = dect_ie_container(dst, *ie);
 	unsigned int n = 2;
 
+	if (src->len < 3)
+		return -1;
 	dst->type         = (src->data[n] & 0x70) >> 4;
 	dst->npi          = (src->data[n] & 0x0f);
 	if (src->data[n] & DECT_OCTET_GROUP_END)
 		goto group4;
 	n++;
+	if (src->len < 4)
+		return -1;
 	dst->presentation = (src->data[n] & 0x3) >> 5;
 	dst->screening    = (src->data[n] & 0x3);
 	if (!(src->data[n] & DECT_OCTET_GROUP_END))
@@ -1708,6 +1487,8 @@ static int dect_sfmt_build_calling_party_number(struct dect_sfmt_ie *dst,
 	struct dect_ie_calling_party_number *src = dect_ie_container(src, ie);
 	unsigned int n = 2;
 
+	if (src->len > array_size(src->address))
+		return -1;
 	dst->data[n]  = src->type << 4;
 	dst->data[n] |= src->npi;
 
@@ -1747,6 +1528,8 @@ static int dect_sfmt_parse_calling_party_name(const struct dect_handle *dh,
 {
 	struct dect_ie_calling_party_name *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 3)
+		return -1;
 	dst->presentation = (src->data[2] & 0x3) >> 5;
 	dst->alphabet     = (src->data[2] & 0x7) >> 2;
 	dst->screening    = (src->data[2] & 0x3);
@@ -1763,6 +1546,8 @@ static int dect_sfmt_build_calling_party_name(struct dect_sfmt_ie *dst,
 {
 	struct dect_ie_calling_party_name *src = dect_ie_container(src, ie);
 
+	if (src->len > array_size(src->name))
+		return -1;
 	dst->data[2]  = src->presentation << 5;
 	dst->data[2] |= src->alphabet << 2;
 	dst->data[2] |= src->screening;
@@ -1791,6 +1576,8 @@ static int dect_sfmt_parse_called_party_number(const struct dect_handle *dh,
 {
 	struct dect_ie_called_party_number *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 3)
+		return -1;
 	dst->type = (src->data[2] & 0x70) >> 4;
 	dst->npi  = (src->data[2] & 0x0f);
 
@@ -1806,6 +1593,8 @@ static int dect_sfmt_build_called_party_number(struct dect_sfmt_ie *dst,
 {
 	struct dect_ie_called_party_number *src = dect_ie_container(src, ie);
 
+	if (src->len > array_size(src->address))
+		return -1;
 	dst->data[2]  = src->type << 4;
 	dst->data[2] |= src->npi;
 	dst->data[2] |= DECT_OCTET_GROUP_END;
@@ -1844,10 +1633,15 @@ static int dect_sfmt_parse_duration(const struct dect_handle *dh,
 {
 	struct dect_ie_duration *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 3)
+		return -1;
 	dst->lock = src->data[2] & 0x70;
 	dst->time = src->data[2] & 0x0f;
-	if (!(src->data[2] & DECT_OCTET_GROUP_END))
+	if (!(src->data[2] & DECT_OCTET_GROUP_END)) {
+		if (src->len < 4)
+			return -1;
 		dst->duration = src->data[3];
+	}
 	return 0;
 }
 
@@ -1919,6 +1713,8 @@ static int dect_sfmt_parse_iwu_to_iwu(const struct dect_handle *dh,
 {
 	struct dect_ie_iwu_to_iwu *dst = dect_ie_container(dst, *ie);
 
+	if (src->len < 3)
+		return -1;
 	dst->sr  = src->data[2] & 0x40;
 	dst->pd  = src->data[2] & 0x3f;
 	if (!(src->data[2] & DECT_OCTET_GROUP_END))
@@ -1939,11 +1735,19 @@ static int dect_sfmt_build_iwu_to_iwu(struct dect_sfmt_ie *dst,
 	dst->data[2]  = src->sr ? 0x40 : 0x0;
 	dst->data[2] |= src->pd;
 	dst->data[2] |= DECT_OCTET_GROUP_END;
-	memcpy(dst->data + 3, src->data, src->len);
-	dst->len = src->len + 3;
+	dst->len = 3;
 	return 0;
 }
 
+static unsigned int dect_sfmt_payload_iwu_to_iwu(const struct dect_ie_common *ie,
+						 const uint8_t **data)
+{
+	const struct dect_ie_iwu_to_iwu *src = dect_ie_container(src, ie);
+
+	*data = src->data;
+	return src->len;
+}
+
 static void dect_sfmt_dump_escape_to_proprietary(const struct dect_ie_common *_ie)
 {
 	struct dect_ie_escape_to_proprietary *ie = dect_ie_container(ie, _ie);
@@ -1960,11 +1764,19 @@ static int dect_sfmt_build_escape_to_proprietary(struct dect_sfmt_ie *dst,
 	dst->data[2]  = DECT_ESC_TO_PROPRIETARY_IE_DESC_EMC;
 	dst->data[2] |= DECT_OCTET_GROUP_END;
 	*(uint16_t *)&dst->data[3] = __cpu_to_be16(src->emc);
-	memcpy(dst->data + 5, src->content, src->len);
-	dst->len = 5 + src->len;
+	dst->len = 5;
 	return 0;
 }
 
+static unsigned int dect_sfmt_payload_escape_to_proprietary(const struct dect_ie_common *ie,
+							    const uint8_t **data)
+{
+	const struct dect_ie_escape_to_proprietary *src = dect_ie_container(src, ie);
+
+	*data = src->content;
+	return src->len;
+}
+
 static int dect_sfmt_parse_escape_to_proprietary(const struct dect_handle *dh,
 						 struct dect_ie_common **ie,
 						 const struct dect_sfmt_ie *src)
@@ -1972,6 +1784,8 @@ static int dect_sfmt_parse_escape_to_proprietary(const struct dect_handle *dh,
 	struct dect_ie_escape_to_proprietary *dst = dect_ie_container(dst, *ie);
 	uint8_t dtype;
 
+	if (src->len < 5)
+		return -1;
 	dtype = (src->data[2] & DECT_ESC_TO_PROPRIETARY_IE_DESC_TYPE_MASK);
 	if (dtype != DECT_ESC_TO_PROPRIETARY_IE_DESC_EMC)
 		return -1;
@@ -2054,6 +1868,8 @@ static int dect_sfmt_parse_codec_list(const struct dect_handle *dh,
 	struct dect_ie_codec_list *dst = dect_ie_container(dst, *ie);
 	unsigned int n = 2;
 
+	if (src->len < 3)
+		return -1;
 	dst->negotiation = (src->data[n] & ~DECT_OCTET_GROUP_END) >> 4;
 	n++;
 
@@ -2079,6 +1895,8 @@ static int dect_sfmt_build_codec_list(struct dect_sfmt_ie *dst,
 	struct dect_ie_codec_list *src = dect_ie_container(src, ie);
 	unsigned int n = 2, i;
 
+	if (src->num > array_size(src->entry))
+		return -1;
 	dst->data[n] = (src->negotiation << 4) | DECT_OCTET_GROUP_END;
 	n++;
 
@@ -2125,6 +1943,8 @@ static int dect_sfmt_build_events_notification(struct dect_sfmt_ie *dst,
 	struct dect_ie_events_notification *src = dect_ie_container(src, ie);
 	unsigned int n = 2, i;
 
+	if (src->num > array_size(src->events))
+		return -1;
 	for (i = 0; i < src->num; i++) {
 		dst->data[n++] = src->events[i].type;
 		dst->data[n++] = src->events[i].subtype | DECT_OCTET_GROUP_END;
@@ -2135,6 +1955,152 @@ static int dect_sfmt_build_events_notification(struct dect_sfmt_ie *dst,
 	return 0;
 }
 
+/*
+ * Fixed layout IEs
+ *
+ * IEs consisting only of bit fields at fixed octet positions are described
+ * declaratively, their parse, build and dump functions are generated from
+ * the description below and dispatched by IE identifier, which allows the
+ * compiler to inline them into the message parsing and construction paths.
+ *
+ * Each IE is described by its identifier, the name of its dect_ie structure,
+ * its minimum length including the IE header and a list of fields:
+ *
+ * VAL(member, octet, mask, shift, desc):	numeric value
+ * SYM(member, octet, mask, shift, desc, tbl):	value translated by @tbl
+ * EXT(octet):					octet group end marker
+ */
+
+#define DECT_SFMT_NO_FIELDS(F)
+
+#define DECT_SFMT_BASIC_SERVICE_FIELDS(F)					\
+	F(SYM, class, 1, DECT_BASIC_SERVICE_CALL_CLASS_MASK,			\
+	  DECT_BASIC_SERVICE_CALL_CLASS_SHIFT, "call class", dect_call_classes)	\
+	F(SYM, service, 1, DECT_BASIC_SERVICE_SERVICE_MASK, 0,			\
+	  "service", dect_basic_services)
+
+#define DECT_SFMT_RELEASE_REASON_FIELDS(F)					\
+	F(SYM, reason, 1, 0xff, 0, "release reason", dect_release_reasons)
+
+#define DECT_SFMT_SIGNAL_FIELDS(F)						\
+	F(SYM, code, 1, 0xff, 0, "signal", dect_signal_codes)
+
+#define DECT_SFMT_LOCATION_AREA_FIELDS(F)					\
+	F(VAL, type, 2, DECT_LOCATION_AREA_TYPE_MASK,				\
+	  DECT_LOCATION_AREA_TYPE_SHIFT, "type")				\
+	F(VAL, level, 2, DECT_LOCATION_LEVEL_MASK, 0, "level")
+
+#define DECT_SFMT_ALLOCATION_TYPE_FIELDS(F)					\
+	F(SYM, auth_id, 2, 0xff, 0, "authentication algorithm",		\
+	  dect_auth_algs)							\
+	F(VAL, auth_key_num, 3, 0xf0, 4, "authentication key number")		\
+	F(VAL, auth_code_num, 3, 0x0f, 0, "authentication code number")
+
+#define DECT_SFMT_PROGRESS_INDICATOR_FIELDS(F)					\
+	F(EXT, 2)								\
+	F(SYM, location, 2, DECT_SFMT_IE_PROGRESS_INDICATOR_LOCATION_MASK, 0,	\
+	  "Location", dect_locations)						\
+	F(EXT, 3)								\
+	F(SYM, progress, 3, ~DECT_OCTET_GROUP_END, 0,				\
+	  "Progress description", dect_progress_descriptions)
+
+#define DECT_SFMT_FEATURE_ACTIVATE_FIELDS(F)					\
+	F(EXT, 2)								\
+	F(SYM, feature, 2, ~DECT_OCTET_GROUP_END, 0, "feature", dect_features)
+
+#define DECT_SFMT_REJECT_REASON_FIELDS(F)					\
+	F(SYM, reason, 2, 0xff, 0, "reject reason", dect_reject_reasons)
+
+#define DECT_SFMT_SETUP_CAPABILITY_FIELDS(F)					\
+	F(EXT, 2)								\
+	F(VAL, page_capability, 2, 0x3, 0, "page capability")			\
+	F(VAL, setup_capability, 2, 0xc, 2, "setup capability")
+
+#define DECT_SFMT_FIXED_IES(IE)							\
+	IE(DECT_IE_SENDING_COMPLETE, sending_complete, 1,			\
+	   DECT_SFMT_NO_FIELDS)							\
+	IE(DECT_IE_DELIMITER_REQUEST, delimiter_request, 1,			\
+	   DECT_SFMT_NO_FIELDS)							\
+	IE(DECT_IE_USE_TPUI, use_tpui, 1,					\
+	   DECT_SFMT_NO_FIELDS)							\
+	IE(DECT_IE_BASIC_SERVICE, basic_service, 2,				\
+	   DECT_SFMT_BASIC_SERVICE_FIELDS)					\
+	IE(DECT_IE_RELEASE_REASON, release_reason, 2,				\
+	   DECT_SFMT_RELEASE_REASON_FIELDS)					\
+	IE(DECT_IE_SIGNAL, signal, 2,						\
+	   DECT_SFMT_SIGNAL_FIELDS)						\
+	IE(DECT_IE_LOCATION_AREA, location_area, 3,				\
+	   DECT_SFMT_LOCATION_AREA_FIELDS)					\
+	IE(DECT_IE_ALLOCATION_TYPE, allocation_type, 4,				\
+	   DECT_SFMT_ALLOCATION_TYPE_FIELDS)					\
+	IE(DECT_IE_PROGRESS_INDICATOR, progress_indicator, 4,			\
+	   DECT_SFMT_PROGRESS_INDICATOR_FIELDS)					\
+	IE(DECT_IE_FEATURE_ACTIVATE, feature_activate, 3,			\
+	   DECT_SFMT_FEATURE_ACTIVATE_FIELDS)					\
+	IE(DECT_IE_REJECT_REASON, reject_reason, 3,				\
+	   DECT_SFMT_REJECT_REASON_FIELDS)					\
+	IE(DECT_IE_SETUP_CAPABILITY, setup_capability, 3,			\
+	   DECT_SFMT_SETUP_CAPABILITY_FIELDS)
+
+#define DECT_SFMT_PARSE_FIELD(kind, ...)	DECT_SFMT_PARSE_##kind(__VA_ARGS__)
+#define DECT_SFMT_PARSE_VAL(member, octet, mask, shift, desc)			\
+	dst->member = (src->data[octet] & (mask)) >> (shift);
+#define DECT_SFMT_PARSE_SYM(member, octet, mask, shift, desc, tbl)		\
+	DECT_SFMT_PARSE_VAL(member, octet, mask, shift, desc)
+#define DECT_SFMT_PARSE_EXT(octet)
+
+#define DECT_SFMT_BUILD_FIELD(kind, ...)	DECT_SFMT_BUILD_##kind(__VA_ARGS__)
+#define DECT_SFMT_BUILD_VAL(member, octet, mask, shift, desc)			\
+	dst->data[octet] |= (src->member << (shift)) & (mask);
+#define DECT_SFMT_BUILD_SYM(member, octet, mask, shift, desc, tbl)		\
+	DECT_SFMT_BUILD_VAL(member, octet, mask, shift, desc)
+#define DECT_SFMT_BUILD_EXT(octet)						\
+	dst->data[octet] |= DECT_OCTET_GROUP_END;
+
+#define DECT_SFMT_DUMP_FIELD(kind, ...)		DECT_SFMT_DUMP_##kind(__VA_ARGS__)
+#define DECT_SFMT_DUMP_VAL(member, octet, mask, shift, desc)			\
+	sfmt_debug("\t" desc ": %u\n", ie->member);
+#define DECT_SFMT_DUMP_SYM(member, octet, mask, shift, desc, tbl)		\
+	sfmt_debug("\t" desc ": %s\n", dect_val2str(tbl, buf, ie->member));
+#define DECT_SFMT_DUMP_EXT(octet)
+
+#define DECT_SFMT_FIXED_IE_FUNCS(type, name, size, fields)			\
+static inline int dect_sfmt_parse_##name(const struct dect_handle *dh,		\
+					 struct dect_ie_common **_ie,		\
+					 const struct dect_sfmt_ie *src)	\
+{										\
+	struct dect_ie_##name *dst __maybe_unused =				\
+		dect_ie_container(dst, *_ie);					\
+										\
+	if (src->len < (size))							\
+		return -1;							\
+	fields(DECT_SFMT_PARSE_FIELD)						\
+	return 0;								\
+}										\
+										\
+static inline int dect_sfmt_build_##name(struct dect_sfmt_ie *dst,		\
+					 const struct dect_ie_common *_ie)	\
+{										\
+	const struct dect_ie_##name *src __maybe_unused =			\
+		dect_ie_container(src, _ie);					\
+										\
+	memset(dst->data, 0, (size));						\
+	fields(DECT_SFMT_BUILD_FIELD)						\
+	dst->len = (size);							\
+	return 0;								\
+}										\
+										\
+static inline void dect_sfmt_dump_##name(const struct dect_ie_common *_ie)	\
+{										\
+	const struct dect_ie_##name *ie __maybe_unused =			\
+		dect_ie_container(ie, _ie);					\
+	char buf[128] __maybe_unused;						\
+										\
+	fields(DECT_SFMT_DUMP_FIELD)						\
+}
+
+DECT_SFMT_FIXED_IES(DECT_SFMT_FIXED_IE_FUNCS)
+
 static const struct dect_ie_handler {
 	const char	*name;
 	size_t		size;
@@ -2143,6 +2109,8 @@ static const struct dect_ie_handler {
 				 const struct dect_sfmt_ie *ie);
 	int		(*build)(struct dect_sfmt_ie *dst,
 				 const struct dect_ie_common *ie);
+	unsigned int	(*payload)(const struct dect_ie_common *ie,
+				   const uint8_t **data);
 	void		(*dump)(const struct dect_ie_common *ie);
 } dect_ie_handlers[256] = {
 	[DECT_IE_REPEAT_INDICATOR]		= {
@@ -2154,20 +2122,20 @@ static const struct dect_ie_handler {
 	[DECT_IE_SENDING_COMPLETE]		= {
 		.name	= "SENDING-COMPLETE",
 		.size	= sizeof(struct dect_ie_sending_complete),
-		.parse	= dect_sfmt_parse_empty_single_octet,
-		.build	= dect_sfmt_build_empty_single_octet,
+		.parse	= dect_sfmt_parse_sending_complete,
+		.build	= dect_sfmt_build_sending_complete,
 	},
 	[DECT_IE_DELIMITER_REQUEST]		= {
 		.name	= "DELIMITER-REQUEST",
 		.size	= sizeof(struct dect_ie_delimiter_request),
-		.parse	= dect_sfmt_parse_empty_single_octet,
-		.build	= dect_sfmt_build_empty_single_octet,
+		.parse	= dect_sfmt_parse_delimiter_request,
+		.build	= dect_sfmt_build_delimiter_request,
 	},
 	[DECT_IE_USE_TPUI]			= {
 		.name	= "USE-TPUI",
 		.size	= sizeof(struct dect_ie_use_tpui),
-		.parse	= dect_sfmt_parse_empty_single_octet,
-		.build	= dect_sfmt_build_empty_single_octet,
+		.parse	= dect_sfmt_parse_use_tpui,
+		.build	= dect_sfmt_build_use_tpui,
 	},
 	[DECT_IE_BASIC_SERVICE]			= {
 		.name	= "BASIC-SERVICE",
@@ -2356,6 +2324,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_display),
 		.parse	= dect_sfmt_parse_multi_display,
 		.build	= dect_sfmt_build_multi_display,
+		.payload = dect_sfmt_payload_multi_display,
 		.dump	= dect_sfmt_dump_display,
 	},
 	[DECT_IE_MULTI_KEYPAD]			= {
@@ -2363,6 +2332,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_keypad),
 		.parse	= dect_sfmt_parse_multi_keypad,
 		.build	= dect_sfmt_build_multi_keypad,
+		.payload = dect_sfmt_payload_multi_keypad,
 		.dump	= dect_sfmt_dump_keypad,
 	},
 	[DECT_IE_FEATURE_ACTIVATE]		= {
@@ -2413,6 +2383,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_setup_capability),
 		.parse	= dect_sfmt_parse_setup_capability,
 		.build	= dect_sfmt_build_setup_capability,
+		.dump	= dect_sfmt_dump_setup_capability,
 	},
 	[DECT_IE_TERMINAL_CAPABILITY]		= {
 		.name	= "TERMINAL-CAPABILITY",
@@ -2482,6 +2453,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_iwu_to_iwu),
 		.parse	= dect_sfmt_parse_iwu_to_iwu,
 		.build	= dect_sfmt_build_iwu_to_iwu,
+		.payload = dect_sfmt_payload_iwu_to_iwu,
 		.dump	= dect_sfmt_dump_iwu_to_iwu,
 	},
 	[DECT_IE_MODEL_IDENTIFIER]		= {
@@ -2497,6 +2469,7 @@ static const struct dect_ie_handler {
 		.size	= sizeof(struct dect_ie_escape_to_proprietary),
 		.parse	= dect_sfmt_parse_escape_to_proprietary,
 		.build	= dect_sfmt_build_escape_to_proprietary,
+		.payload = dect_sfmt_payload_escape_to_proprietary,
 		.dump	= dect_sfmt_dump_escape_to_proprietary,
 	},
 	[DECT_IE_CODEC_LIST]			= {
@@ -2521,25 +2494,65 @@ static const struct dect_ie_handler {
 	},
 };
 
-static enum dect_sfmt_ie_status dect_rx_status(const struct dect_handle *dh,
-					       const struct dect_sfmt_ie_desc *desc)
+#define DECT_SFMT_PARSE_CASE(type, name, size, fields)				\
+	case type:								\
+		return dect_sfmt_parse_##name(dh, dst, ie);
+#define DECT_SFMT_BUILD_CASE(type, name, size, fields)				\
+	case type:								\
+		return dect_sfmt_build_##name(dst, ie);
+#define DECT_SFMT_DUMP_CASE(type, name, size, fields)				\
+	case type:								\
+		dect_sfmt_dump_##name(ie);					\
+		break;
+
+static int dect_sfmt_parse_ie(const struct dect_handle *dh,
+			      const struct dect_ie_handler *ieh,
+			      struct dect_ie_common **dst,
+			      const struct dect_sfmt_ie *ie)
 {
-	if (dh->mode == DECT_MODE_FP)
-		return desc->pp_fp;
-	else
-		return desc->fp_pp;
+	switch (ie->id) {
+	DECT_SFMT_FIXED_IES(DECT_SFMT_PARSE_CASE)
+	default:
+		return ieh->parse(dh, dst, ie);
+	}
 }
 
-static enum dect_sfmt_ie_status dect_tx_status(const struct dect_handle *dh,
-					       const struct dect_sfmt_ie_desc *desc)
+static int dect_sfmt_build_ie(const struct dect_ie_handler *ieh, uint8_t type,
+			      struct dect_sfmt_ie *dst,
+			      const struct dect_ie_common *ie)
 {
-	if (dh->mode == DECT_MODE_FP)
-		return desc->fp_pp;
-	else
-		return desc->pp_fp;
+	switch (type) {
+	DECT_SFMT_FIXED_IES(DECT_SFMT_BUILD_CASE)
+	default:
+		return ieh->build(dst, ie);
+	}
 }
 
-static struct dect_ie_common **
+static void dect_sfmt_dump_ie(const struct dect_ie_handler *ieh, uint8_t type,
+			      const struct dect_ie_common *ie)
+{
+	if (!dect_debug_enabled(DECT_DEBUG_SFMT))
+		return;
+
+	switch (type) {
+	DECT_SFMT_FIXED_IES(DECT_SFMT_DUMP_CASE)
+	default:
+		if (ieh->dump != NULL)
+			ieh->dump(ie);
+		break;
+	}
+}
+
+static enum dect_sfmt_ie_status dect_tx_status(const struct dect_handle *dh,
+					       const struct dect_sfmt_ie_desc *desc)
+{
+	if (dh->mode == DECT_MODE_FP)
+		return desc->fp_pp;
+	else
+		return desc->pp_fp;
+}
+
+static struct dect_ie_common **
 dect_next_ie(const struct dect_sfmt_ie_desc *desc, struct dect_ie_common **ie)
 {
 	if (desc->type == DECT_IE_REPEAT_INDICATOR)
@@ -2550,73 +2563,59 @@ dect_next_ie(const struct dect_sfmt_ie_desc *desc, struct dect_ie_common **ie)
 		return ie;
 }
 
-static void dect_msg_ie_init(const struct dect_sfmt_ie_desc *desc,
-			     struct dect_ie_common **ie)
-{
-	struct dect_ie_list *iel;
-
-	if (desc->flags & DECT_SFMT_IE_END)
-		return;
-
-	if (desc->type == DECT_IE_REPEAT_INDICATOR) {
-		iel = dect_ie_container(iel, (struct dect_ie_common *)ie);
-		dect_ie_list_init(iel);
-	} else if (!(desc->flags & DECT_SFMT_IE_REPEAT))
-		*ie = NULL;
-	else
-		return;
-#if 0
-	sfmt_debug("init message IE %p: <%s>\n",
-		 ie, dect_ie_handlers[desc->type].name);
-#endif
-}
-
-/**
- * Parse a S-Format encoded Information Element header
- *
- * @param ie	result pointer to the Information Element
- * @param mb	message buffer
- *
- * Parse a S-Format encoded Information Element header and return the parsed
- * information in the ie structure.
- *
- * @return 0 on success or -1 if a parsing error occured.
- */
-enum dect_sfmt_error
-dect_parse_sfmt_ie_header(struct dect_sfmt_ie *ie,
-			  const struct dect_msg_buf *mb)
+static enum dect_sfmt_error
+__dect_parse_sfmt_ie_header(struct dect_sfmt_ie *ie, uint8_t *data,
+			    unsigned int len)
 {
 	uint8_t val;
 
-	if (mb->len < 1)
+	if (len < 1)
 		return -1;
 
-	ie->id = mb->data[0] & DECT_SFMT_IE_FIXED_LEN;
+	ie->id = data[0] & DECT_SFMT_IE_FIXED_LEN;
 	if (ie->id & DECT_SFMT_IE_FIXED_LEN) {
-		ie->id |= (mb->data[0] & DECT_SFMT_IE_FIXED_ID_MASK);
-		val     = (mb->data[0] & DECT_SFMT_IE_FIXED_VAL_MASK);
+		ie->id |= (data[0] & DECT_SFMT_IE_FIXED_ID_MASK);
+		val     = (data[0] & DECT_SFMT_IE_FIXED_VAL_MASK);
 		if (ie->id != DECT_IE_DOUBLE_OCTET_ELEMENT) {
 			ie->len = 1;
 			if (ie->id == DECT_IE_EXT_PREFIX)
 				ie->id |= val;
 		} else {
-			if (mb->len < 2)
+			if (len < 2)
 				return -1;
 			ie->id |= val;
 			ie->len = 2;
 		}
 	} else {
-		if (mb->len < 2U || mb->len < 2U + mb->data[1])
+		if (len < 2U || len < 2U + data[1])
 			return -1;
-		ie->id  = mb->data[0];
-		ie->len = mb->data[1] + 2;
+		ie->id  = data[0];
+		ie->len = data[1] + 2;
 	}
-	ie->data = mb->data;
+	ie->data = data;
 
 //	sfmt_debug("found IE: <<%s>> (%x) len: %u\n", dect_ie_handlers[ie->id].name,
 //		   ie->id, ie->len);
 	return 0;
 }
+
+/**
+ * Parse a S-Format encoded Information Element header
+ *
+ * @param ie	result pointer to the Information Element
+ * @param mb	message buffer
+ *
+ * Parse a S-Format encoded Information Element header and return the parsed
+ * information in the ie structure.
+ *
+ * @return 0 on success or -1 if a parsing error occured.
+ */
+enum dect_sfmt_error
+dect_parse_sfmt_ie_header(struct dect_sfmt_ie *ie,
+			  const struct dect_msg_buf *mb)
+{
+	return __dect_parse_sfmt_ie_header(ie, mb->data, mb->len);
+}
 EXPORT_SYMBOL(dect_parse_sfmt_ie_header);
 
 static int dect_build_sfmt_ie_header(struct dect_sfmt_ie *dst, uint8_t id)
@@ -2633,6 +2632,8 @@ static int dect_build_sfmt_ie_header(struct dect_sfmt_ie *dst, uint8_t id)
 			dst->len = 0;
 		else {
 			dect_assert(dst->len > 2);
+			if (dst->len > DECT_SFMT_IE_MAX_SIZE)
+				return -1;
 			dst->data[1] = dst->len - 2;
 			dst->data[0] = id;
 		}
@@ -2640,25 +2641,11 @@ static int dect_build_sfmt_ie_header(struct dect_sfmt_ie *dst, uint8_t id)
 	return 0;
 }
 
-/**
- * Parse a S-Format encoded Information Element
- *
- * @param dh		libdect DECT handle
- * @param type		IE type
- * @param dst		result pointer to the allocated information element
- * @param ie		information element
- *
- * Parse a S-Format encoded Information Element and return an allocated IE
- * structure.
- *
- * @return #DECT_SFMT_OK on success or one of the @ref dect_sfmt_error
- * "S-Format error codes" on error. On success the dst parameter is set to
- * point to the allocated information element structure.
- */
-enum dect_sfmt_error
-dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
-		   struct dect_ie_common **dst,
-		   const struct dect_sfmt_ie *ie)
+static enum dect_sfmt_error
+__dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
+		     struct dect_ie_common **dst,
+		     const struct dect_sfmt_ie *ie,
+		     struct dect_ie_arena *arena)
 {
 	const struct dect_ie_handler *ieh;
 	int err = -1;
@@ -2668,7 +2655,7 @@ dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
 		goto err1;
 
 	if (ieh->size > 0) {
-		*dst = dect_ie_alloc(dh, ieh->size);
+		*dst = dect_ie_arena_ie_alloc(dh, arena, ieh->size);
 		if (*dst == NULL)
 			goto err1;
 	}
@@ -2676,20 +2663,47 @@ dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
 	sfmt_debug("  IE: <<%s>> id: %x len: %u dst: %p\n",
 		   ieh->name, ie->id, ie->len, *dst);
 
-	err = ieh->parse(dh, dst, ie);
+	err = dect_sfmt_parse_ie(dh, ieh, dst, ie);
 	if (err < 0)
 		goto err2;
-	if (ieh->dump != NULL)
-		ieh->dump(*dst);
+	/* IEs without storage of their own, like the repeat indicator,
+	 * are parsed into the destination directly. */
+	dect_sfmt_dump_ie(ieh, ie->id,
+			  ieh->size > 0 ? *dst : (struct dect_ie_common *)dst);
 	return 0;
 
 err2:
-	dect_free(dh, *dst);
-	*dst = NULL;
+	if (ieh->size > 0) {
+		dect_ie_destroy(dh, *dst);
+		*dst = NULL;
+	}
 err1:
 	sfmt_debug("smsg: IE parsing error\n");
 	return err;
 }
+
+/**
+ * Parse a S-Format encoded Information Element
+ *
+ * @param dh		libdect DECT handle
+ * @param type		IE type
+ * @param dst		result pointer to the allocated information element
+ * @param ie		information element
+ *
+ * Parse a S-Format encoded Information Element and return an allocated IE
+ * structure.
+ *
+ * @return #DECT_SFMT_OK on success or one of the @ref dect_sfmt_error
+ * "S-Format error codes" on error. On success the dst parameter is set to
+ * point to the allocated information element structure.
+ */
+enum dect_sfmt_error
+dect_parse_sfmt_ie(const struct dect_handle *dh, uint8_t type,
+		   struct dect_ie_common **dst,
+		   const struct dect_sfmt_ie *ie)
+{
+	return __dect_parse_sfmt_ie(dh, type, dst, ie, NULL);
+}
 EXPORT_SYMBOL(dect_parse_sfmt_ie);
 
 static void sfmt_debug_msg(const struct dect_sfmt_msg_desc *mdesc, const char *msg)
@@ -2697,6 +2711,9 @@ static void sfmt_debug_msg(const struct dect_sfmt_msg_desc *mdesc, const char *m
 	char buf[strlen(mdesc->name) + 1];
 	unsigned int i;
 
+	if (!dect_debug_enabled(DECT_DEBUG_SFMT))
+		return;
+
 	strcpy(buf, mdesc->name);
 	for (i = 0; i < sizeof(buf); i++) {
 		if (islower(buf[i]))
@@ -2707,110 +2724,457 @@ static void sfmt_debug_msg(const struct dect_sfmt_msg_desc *mdesc, const char *m
 	sfmt_debug("%s {%s} message\n", msg, buf);
 }
 
+static void dect_sfmt_msg_tbl_mode(struct dect_sfmt_msg_tbl *tbl,
+				   enum dect_cluster_modes mode,
+				   enum dect_sfmt_ie_status status,
+				   unsigned int idx)
+{
+	switch (status) {
+	case DECT_SFMT_IE_MANDATORY:
+		tbl->mode[mode].mandatory |= 1ULL << idx;
+		break;
+	case DECT_SFMT_IE_OPTIONAL:
+		tbl->mode[mode].optional |= 1ULL << idx;
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * dect_sfmt_ie_size - return the size of the IE structure of an IE type
+ *
+ * @type:	IE type
+ */
+size_t dect_sfmt_ie_size(uint8_t type)
+{
+	return dect_ie_handlers[type].size;
+}
+
+/**
+ * dect_sfmt_msg_desc_compile - compile a S-Format message description
+ *
+ * @mdesc:	message description
+ *
+ * Build the IE identifier to IE description lookup table, the IE storage
+ * offsets and the bitmasks of mandatory and optional IEs in the receive
+ * direction of both FP and PP mode.
+ */
+static void dect_sfmt_msg_desc_compile(const struct dect_sfmt_msg_desc *mdesc)
+{
+	struct dect_sfmt_msg_tbl *tbl = mdesc->tbl;
+	const struct dect_sfmt_ie_desc *desc;
+	unsigned int idx, n, offset = 0;
+
+	for (n = 0; !(mdesc->ie[n].flags & DECT_SFMT_IE_END); n++)
+		dect_assert(n < DECT_SFMT_MSG_MAX_IES);
+
+	memset(tbl->slot, DECT_SFMT_IE_INDEX_NONE, sizeof(tbl->slot));
+	for (idx = 0; idx < n; idx++) {
+		desc = &mdesc->ie[idx];
+
+		/* Repeated IEs are added to the list of the preceeding
+		 * repeat indicator. */
+		if (desc->type == DECT_IE_REPEAT_INDICATOR) {
+			tbl->lists |= 1ULL << idx;
+			tbl->offset[idx] = offset;
+			offset += sizeof(struct dect_ie_list);
+		} else if (desc->flags & DECT_SFMT_IE_REPEAT) {
+			dect_assert(idx > 0 && tbl->lists & (1ULL << (idx - 1)));
+			tbl->offset[idx] = tbl->offset[idx - 1];
+		} else {
+			tbl->offset[idx] = offset;
+			offset += sizeof(struct dect_ie_common *);
+		}
+
+		tbl->arena_size += DECT_IE_ARENA_ALIGN(dect_ie_handlers[desc->type].size);
+
+		dect_sfmt_msg_tbl_mode(tbl, DECT_MODE_FP, desc->pp_fp, idx);
+		dect_sfmt_msg_tbl_mode(tbl, DECT_MODE_PP, desc->fp_pp, idx);
+	}
+	tbl->size = offset;
+
+	/* Chain descriptions of the same IE in reverse order, so the slot
+	 * refers to the first one. */
+	while (idx-- > 0) {
+		desc = &mdesc->ie[idx];
+		tbl->next[idx] = tbl->slot[desc->type];
+		tbl->slot[desc->type] = idx;
+
+		if (desc->type == DECT_IE_SINGLE_DISPLAY)
+			tbl->slot[DECT_IE_MULTI_DISPLAY] = idx;
+		if (desc->type == DECT_IE_SINGLE_KEYPAD)
+			tbl->slot[DECT_IE_MULTI_KEYPAD] = idx;
+	}
+}
+
+static void __init dect_sfmt_msg_descs_init(void)
+{
+	const struct dect_sfmt_msg_desc * const *ref, *mdesc;
+
+	dect_foreach_sfmt_msg_desc(ref, mdesc)
+		dect_sfmt_msg_desc_compile(mdesc);
+}
+
+static void dect_msg_init(const struct dect_sfmt_msg_tbl *tbl,
+			  struct dect_msg_common *msg)
+{
+	uint64_t lists = tbl->lists;
+	unsigned int idx;
+
+	memset(msg->ie, 0, tbl->size);
+	while (lists) {
+		idx = __builtin_ctzll(lists);
+		dect_ie_list_init((void *)msg->ie + tbl->offset[idx]);
+		lists &= lists - 1;
+	}
+}
+
+/*
+ * Locate the first description matching an IE following the previously
+ * matched one. Returns the index of the description, DECT_SFMT_IE_INDEX_NONE
+ * for unexpected IEs, which are ignored, or -1 for IEs not allowed in the
+ * receive direction.
+ */
+static int dect_sfmt_msg_lookup(const struct dect_handle *dh,
+				const struct dect_sfmt_msg_desc *mdesc,
+				const struct dect_sfmt_ie *ie,
+				unsigned int *pos)
+{
+	const struct dect_sfmt_msg_tbl *tbl = mdesc->tbl;
+	uint64_t optional = tbl->mode[dh->mode].optional;
+	uint64_t mandatory = tbl->mode[dh->mode].mandatory;
+	const struct dect_sfmt_ie_desc *desc;
+	unsigned int idx;
+
+	for (idx = tbl->slot[ie->id]; idx < *pos; idx = tbl->next[idx])
+		;
+	if (idx == DECT_SFMT_IE_INDEX_NONE) {
+		sfmt_debug("  IE: <<%s>> id: %x unexpected\n",
+			   dect_ie_handlers[ie->id].name, ie->id);
+		return DECT_SFMT_IE_INDEX_NONE;
+	}
+	desc = &mdesc->ie[idx];
+
+	/* Multi display/keypad IEs are accepted for optional single
+	 * display/keypad IEs only. */
+	if (ie->id != desc->type && !(optional & (1ULL << idx)))
+		return DECT_SFMT_IE_INDEX_NONE;
+	if (!((mandatory | optional) & (1ULL << idx)))
+		return -1;
+
+	*pos = desc->flags & DECT_SFMT_IE_REPEAT ? idx : idx + 1;
+	return idx;
+}
+
+static enum dect_sfmt_error
+dect_sfmt_msg_check_mandatory(const struct dect_handle *dh,
+			      const struct dect_sfmt_msg_desc *mdesc,
+			      uint64_t seen)
+{
+	uint64_t mandatory = mdesc->tbl->mode[dh->mode].mandatory;
+	unsigned int idx;
+
+	if ((seen & mandatory) == mandatory)
+		return DECT_SFMT_OK;
+
+	idx = __builtin_ctzll(mandatory & ~seen);
+	sfmt_debug("  IE <%s> id: %x missing\n",
+		   dect_ie_handlers[mdesc->ie[idx].type].name,
+		   mdesc->ie[idx].type);
+	return DECT_SFMT_MANDATORY_IE_MISSING;
+}
+
+/* Empty variable length IEs are treated as absent */
+static bool dect_sfmt_ie_empty(const struct dect_sfmt_ie *ie)
+{
+	if ((ie->id & DECT_SFMT_IE_FIXED_LEN) || ie->len != 2)
+		return false;
+
+	sfmt_debug("  IE: <<%s>> id: %x len: %u (empty)\n",
+		   dect_ie_handlers[ie->id].name, ie->id, ie->len);
+	return true;
+}
+
 enum dect_sfmt_error dect_parse_sfmt_msg(const struct dect_handle *dh,
 					 const struct dect_sfmt_msg_desc *mdesc,
 					 struct dect_msg_common *_dst,
 					 struct dect_msg_buf *mb)
 {
-	const struct dect_sfmt_ie_desc *desc = mdesc->ie;
-	struct dect_ie_common **dst = &_dst->ie[0];
-	struct dect_sfmt_ie _ie[2], *ie;
-	uint8_t idx = 0;
+	const struct dect_sfmt_msg_tbl *tbl = mdesc->tbl;
+	uint64_t mandatory = tbl->mode[dh->mode].mandatory;
+	struct dect_ie_common **dst, *rie;
+	unsigned int len = mb->len, pos = 0;
+	enum dect_sfmt_error err;
+	struct dect_sfmt_ie ie;
+	uint64_t seen = 0;
+	int idx;
 
 	sfmt_debug_msg(mdesc, "parse");
 
-	dect_msg_ie_init(desc, dst);
+	_dst->arena = NULL;
+	if (dh->ops->ie_arena && tbl->arena_size > 0)
+		_dst->arena = dect_ie_arena_alloc(dh, tbl->arena_size);
+	dect_msg_init(tbl, _dst);
+
 	while (mb->len > 0) {
 		/* Parse the next information element header */
-		ie = &_ie[idx++ % array_size(_ie)];;
-		if (dect_parse_sfmt_ie_header(ie, mb) < 0)
-			return -1;
-
-		/* Locate a matching member in the description and apply
-		 * policy checks. */
-		while (1) {
-			if (desc->flags & DECT_SFMT_IE_END)
-				goto out;
-
-			switch (dect_rx_status(dh, desc)) {
-			case DECT_SFMT_IE_MANDATORY:
-				if (desc->type == ie->id)
-					goto found;
-				return DECT_SFMT_MANDATORY_IE_MISSING;
-			case DECT_SFMT_IE_NONE:
-				if (desc->type == ie->id)
-					return -1;
-				break;
-			case DECT_SFMT_IE_OPTIONAL:
-				if (desc->type == ie->id)
-					goto found;
-				if (desc->type == DECT_IE_SINGLE_DISPLAY &&
-				    ie->id == DECT_IE_MULTI_DISPLAY)
-					goto found;
-				if (desc->type == DECT_IE_SINGLE_KEYPAD &&
-				    ie->id == DECT_IE_MULTI_KEYPAD)
-					goto found;
-				break;
-			}
+		if (dect_parse_sfmt_ie_header(&ie, mb) < 0) {
+			err = -1;
+			goto err1;
+		}
 
-			dst = dect_next_ie(desc, dst);
-			desc++;
-			dect_msg_ie_init(desc, dst);
+		idx = dect_sfmt_msg_lookup(dh, mdesc, &ie, &pos);
+		if (idx < 0) {
+			err = -1;
+			goto err1;
 		}
-found:
-		/* Treat empty variable length IEs as absent */
-		if (!(ie->id & DECT_SFMT_IE_FIXED_LEN) && ie->len == 2) {
-			sfmt_debug("  IE: <<%s>> id: %x len: %u (empty)\n",
-				   dect_ie_handlers[ie->id].name, ie->id, ie->len);
+		if (idx == DECT_SFMT_IE_INDEX_NONE)
 			goto next;
-		}
 
-		/* Ignore corrupt optional IEs */
-		if (dect_parse_sfmt_ie(dh, desc->type, dst, ie) < 0 &&
-		    dect_rx_status(dh, desc) == DECT_SFMT_IE_MANDATORY)
-			return DECT_SFMT_MANDATORY_IE_ERROR;
+		seen |= 1ULL << idx;
+		if (dect_sfmt_ie_empty(&ie))
+			goto next;
 
+		dst = (void *)_dst->ie + tbl->offset[idx];
+		if (mdesc->ie[idx].flags & DECT_SFMT_IE_REPEAT) {
+			rie = NULL;
+			if (__dect_parse_sfmt_ie(dh, ie.id, &rie, &ie,
+						 _dst->arena) == 0)
+				__dect_ie_list_add(rie, (struct dect_ie_list *)dst);
+			else if (mandatory & (1ULL << idx)) {
+				err = DECT_SFMT_MANDATORY_IE_ERROR;
+				goto err1;
+			}
+		/* Ignore corrupt optional IEs */
+		} else if (__dect_parse_sfmt_ie(dh, ie.id, dst, &ie,
+						_dst->arena) < 0 &&
+			   mandatory & (1ULL << idx)) {
+			err = DECT_SFMT_MANDATORY_IE_ERROR;
+			goto err1;
+		}
 next:
-		dect_mbuf_pull(mb, ie->len);
+		dect_mbuf_pull(mb, ie.len);
+	}
 
-		dst = dect_next_ie(desc, dst);
-		desc++;
-		dect_msg_ie_init(desc, dst);
+	err = dect_sfmt_msg_check_mandatory(dh, mdesc, seen);
+	if (err != DECT_SFMT_OK)
+		goto err1;
+	dect_trace(dh, DECT_TRACE_SFMT_PARSE, NULL, NULL,
+		   len, DECT_SFMT_OK, DECT_TRACE_NONE, 0);
+	return DECT_SFMT_OK;
+
+err1:
+	dect_trace(dh, DECT_TRACE_SFMT_PARSE, NULL, NULL,
+		   len, err, mb->len > 0 ? ie.id : DECT_TRACE_NONE, 0);
+	dect_msg_free(dh, mdesc, _dst);
+	return err;
+}
+
+/*
+ * Message views
+ *
+ * A message view indexes the IEs of a received message without decoding
+ * them. IEs are decoded on demand into storage provided by the caller, or
+ * into an allocated IE if the caller needs an owned copy. Only the first
+ * element of repeated IEs is indexed.
+ */
+
+/**
+ * dect_msg_view_init - index the IEs of a received message
+ *
+ * @dh:		libdect DECT handle
+ * @view:	message view
+ * @mdesc:	message description
+ * @mb:		message buffer
+ *
+ * Validate the IE sequence of the message against the message description
+ * and record the offset of each IE. The message buffer is not modified and
+ * must remain valid while the view is used.
+ */
+enum dect_sfmt_error dect_msg_view_init(const struct dect_handle *dh,
+					struct dect_msg_view *view,
+					const struct dect_sfmt_msg_desc *mdesc,
+					const struct dect_msg_buf *mb)
+{
+	unsigned int offset = 0, pos = 0;
+	struct dect_sfmt_ie ie;
+	uint64_t seen = 0;
+	int idx;
+
+	sfmt_debug_msg(mdesc, "index");
+
+	view->mdesc   = mdesc;
+	view->data    = mb->data;
+	view->len     = mb->len;
+	view->present = 0;
+
+	while (offset < mb->len) {
+		if (__dect_parse_sfmt_ie_header(&ie, mb->data + offset,
+						mb->len - offset) < 0)
+			return -1;
+
+		idx = dect_sfmt_msg_lookup(dh, mdesc, &ie, &pos);
+		if (idx < 0)
+			return -1;
+		if (idx == DECT_SFMT_IE_INDEX_NONE)
+			goto next;
+
+		seen |= 1ULL << idx;
+		if (dect_sfmt_ie_empty(&ie) || view->present & (1ULL << idx))
+			goto next;
+
+		view->present |= 1ULL << idx;
+		view->offset[idx] = offset;
+next:
+		offset += ie.len;
 	}
-out:
-	while (!(desc->flags & DECT_SFMT_IE_END)) {
-		if (dect_rx_status(dh, desc) == DECT_SFMT_IE_MANDATORY)
-			return DECT_SFMT_MANDATORY_IE_MISSING;
-		dst = dect_next_ie(desc, dst);
-		desc++;
-		dect_msg_ie_init(desc, dst);
+
+	return dect_sfmt_msg_check_mandatory(dh, mdesc, seen);
+}
+
+/**
+ * dect_msg_view_find - locate an IE in a message view
+ *
+ * @view:	message view
+ * @type:	IE type
+ * @ie:		result pointer to the IE header
+ *
+ * @return 0 if the IE is present or -1 otherwise. The IE data refers to the
+ * message buffer.
+ */
+int dect_msg_view_find(const struct dect_msg_view *view, uint8_t type,
+		       struct dect_sfmt_ie *ie)
+{
+	const struct dect_sfmt_msg_tbl *tbl = view->mdesc->tbl;
+	unsigned int idx;
+
+	for (idx = tbl->slot[type]; idx != DECT_SFMT_IE_INDEX_NONE;
+	     idx = tbl->next[idx]) {
+		if (view->present & (1ULL << idx))
+			break;
 	}
+	if (idx == DECT_SFMT_IE_INDEX_NONE)
+		return -1;
 
-	return DECT_SFMT_OK;
+	return __dect_parse_sfmt_ie_header(ie, view->data + view->offset[idx],
+					   view->len - view->offset[idx]);
 }
 
 /**
- * Construct a S-Format encoded Information Element
+ * __dect_msg_view_get - decode an IE of a message view
  *
- * @param dh		libdect DECT handle
- * @param type		IE type
- * @param mb		message buffer to append IE to
- * @param ie		information element
+ * @dh:		libdect DECT handle
+ * @view:	message view
+ * @type:	IE type
+ * @dst:	IE storage
+ * @size:	size of the IE storage
  *
- * Construct a S-Format encoded Information Element and append it to the message
- * buffer.
+ * Decode an IE into storage provided by the caller, usually on the stack.
+ * The IE is not reference counted and must not be held.
  *
- * @return #DECT_SFMT_OK on success or one of the @ref dect_sfmt_error
- * "S-Format error codes" on error.
+ * @return #DECT_SFMT_OK on success, -1 if the IE is absent or invalid.
  */
-enum dect_sfmt_error
-dect_build_sfmt_ie(const struct dect_handle *dh, uint8_t type,
-		   struct dect_msg_buf *mb,
-		   const struct dect_ie_common *ie)
+enum dect_sfmt_error __dect_msg_view_get(const struct dect_handle *dh,
+					 const struct dect_msg_view *view,
+					 uint8_t type, struct dect_ie_common *dst,
+					 size_t size)
+{
+	const struct dect_ie_handler *ieh;
+	struct dect_sfmt_ie ie;
+
+	if (dect_msg_view_find(view, type, &ie) < 0)
+		return -1;
+
+	ieh = &dect_ie_handlers[ie.id];
+	if (ieh->parse == NULL)
+		return -1;
+	dect_assert(ieh->size > 0 && ieh->size <= size);
+
+	memset(dst, 0, size);
+	if (dect_sfmt_parse_ie(dh, ieh, &dst, &ie) < 0)
+		return -1;
+	dect_sfmt_dump_ie(ieh, ie.id, dst);
+	return DECT_SFMT_OK;
+}
+
+/**
+ * dect_msg_view_copy - decode an IE of a message view into an allocated IE
+ *
+ * @dh:		libdect DECT handle
+ * @view:	message view
+ * @type:	IE type
+ *
+ * @return a reference counted IE or NULL if the IE is absent or invalid.
+ */
+struct dect_ie_common *dect_msg_view_copy(const struct dect_handle *dh,
+					  const struct dect_msg_view *view,
+					  uint8_t type)
+{
+	struct dect_ie_common *ie = NULL;
+	struct dect_sfmt_ie sie;
+
+	if (dect_msg_view_find(view, type, &sie) < 0)
+		return NULL;
+	if (dect_ie_handlers[sie.id].size == 0)
+		return NULL;
+	if (__dect_parse_sfmt_ie(dh, sie.id, &ie, &sie, NULL) < 0)
+		return NULL;
+	return ie;
+}
+
+static void dect_sfmt_iov_flush(struct dect_sfmt_iov *iov)
+{
+	struct dect_msg_buf *mb = iov->mb;
+
+	if (mb->len == iov->off)
+		return;
+	iov->iov[iov->cnt].iov_base = mb->data + iov->off;
+	iov->iov[iov->cnt].iov_len  = mb->len - iov->off;
+	iov->len += mb->len - iov->off;
+	iov->off  = mb->len;
+	iov->cnt++;
+}
+
+/*
+ * Expand the message buffer of a scatter/gather message, segments already
+ * referring to the message buffer are moved along with the data.
+ */
+static int dect_sfmt_mbuf_expand(const struct dect_handle *dh,
+				 struct dect_msg_buf *mb,
+				 struct dect_sfmt_iov *iov, unsigned int len)
+{
+	uint8_t *data = mb->data;
+	unsigned int i;
+
+	if (dect_mbuf_expand(dh, mb, len) < 0)
+		return -1;
+	if (iov == NULL || mb->data == data)
+		return 0;
+
+	for (i = 0; i < iov->cnt; i++) {
+		if ((uint8_t *)iov->iov[i].iov_base < data ||
+		    (uint8_t *)iov->iov[i].iov_base >= data + mb->len)
+			continue;
+		iov->iov[i].iov_base = mb->data +
+				       ((uint8_t *)iov->iov[i].iov_base - data);
+	}
+	return 0;
+}
+
+static enum dect_sfmt_error
+__dect_build_sfmt_ie_iov(const struct dect_handle *dh, uint8_t type,
+			 struct dect_msg_buf *mb,
+			 const struct dect_ie_common *ie,
+			 struct dect_sfmt_iov *iov)
 {
 	const struct dect_ie_handler *ieh;
+	const uint8_t *payload = NULL;
+	uint8_t buf[DECT_SFMT_IE_MAX_SIZE];
+	unsigned int plen = 0, hlen;
 	struct dect_sfmt_ie dst;
 	enum dect_sfmt_error err = 0;
+	bool ref;
 
 	if (type == DECT_IE_SINGLE_DISPLAY) {
 		struct dect_ie_display *display = dect_ie_container(display, ie);
@@ -2828,42 +3192,102 @@ dect_build_sfmt_ie(const struct dect_handle *dh, uint8_t type,
 		goto err1;
 
 	sfmt_debug("  IE: <<%s>> id: %x %p\n", ieh->name, type, ie);
-	if (ieh->dump != NULL)
-		ieh->dump(ie);
-
-	dst.data = mb->data + mb->len;
-	dst.len = 0;
-	err = ieh->build(&dst, ie);
+	dect_sfmt_dump_ie(ieh, type, ie);
+
+	if (ieh->payload != NULL)
+		plen = ieh->payload(ie, &payload);
+
+	/* Build into a scratch buffer holding the largest possible encoding,
+	 * the builders bound their output by the size of the IE's arrays.
+	 */
+	memset(buf, 0, sizeof(buf));
+	dst.data = buf;
+	dst.len  = 0;
+	err = dect_sfmt_build_ie(ieh, type, &dst, ie);
 	if (err < 0)
 		goto err1;
 
-	dect_build_sfmt_ie_header(&dst, type);
-	mb->len += dst.len;
+	dst.len += plen;
+	if (dect_build_sfmt_ie_header(&dst, type) < 0) {
+		err = DECT_SFMT_INVALID_IE;
+		goto err1;
+	}
+	if (dst.len == 0)
+		return 0;
+	hlen = dst.len - plen;
+
+	/* Reference large payloads instead of copying them if possible */
+	ref = iov != NULL && plen >= DECT_SFMT_IOV_MIN_LEN &&
+	      iov->cnt + 2 < array_size(iov->iov);
+
+	if (dect_sfmt_mbuf_expand(dh, mb, iov, ref ? hlen : dst.len) < 0) {
+		err = DECT_SFMT_NO_BUFFER_SPACE;
+		goto err1;
+	}
+	dst.data = mb->data + mb->len;
+	memcpy(dst.data, buf, hlen);
+
+	if (ref) {
+		mb->len += hlen;
+		dect_sfmt_iov_flush(iov);
+		iov->iov[iov->cnt].iov_base = (void *)payload;
+		iov->iov[iov->cnt].iov_len  = plen;
+		iov->len += plen;
+		iov->cnt++;
+	} else {
+		if (plen > 0)
+			memcpy(dst.data + hlen, payload, plen);
+		mb->len += dst.len;
+	}
 	return 0;
 
 err1:
 	return err;
 }
+
+/**
+ * Construct a S-Format encoded Information Element
+ *
+ * @param dh		libdect DECT handle
+ * @param type		IE type
+ * @param mb		message buffer to append IE to
+ * @param ie		information element
+ *
+ * Construct a S-Format encoded Information Element and append it to the message
+ * buffer.
+ *
+ * @return #DECT_SFMT_OK on success or one of the @ref dect_sfmt_error
+ * "S-Format error codes" on error.
+ */
+enum dect_sfmt_error
+dect_build_sfmt_ie(const struct dect_handle *dh, uint8_t type,
+		   struct dect_msg_buf *mb,
+		   const struct dect_ie_common *ie)
+{
+	return __dect_build_sfmt_ie_iov(dh, type, mb, ie, NULL);
+}
 EXPORT_SYMBOL(dect_build_sfmt_ie);
 
 static enum dect_sfmt_error
 __dect_build_sfmt_ie(const struct dect_handle *dh,
 		     const struct dect_sfmt_ie_desc *desc,
 		     struct dect_msg_buf *mb,
-		     const struct dect_ie_common *ie)
+		     const struct dect_ie_common *ie,
+		     struct dect_sfmt_iov *iov)
 {
 	if (dect_tx_status(dh, desc) == DECT_SFMT_IE_NONE) {
 		sfmt_debug("  IE <%s> id: %x not allowed\n",
 			   dect_ie_handlers[desc->type].name, desc->type);
 		return DECT_SFMT_INVALID_IE;
 	}
-	return dect_build_sfmt_ie(dh, desc->type, mb, ie);
+	return __dect_build_sfmt_ie_iov(dh, desc->type, mb, ie, iov);
 }
 
-enum dect_sfmt_error dect_build_sfmt_msg(const struct dect_handle *dh,
-					 const struct dect_sfmt_msg_desc *mdesc,
-					 const struct dect_msg_common *_src,
-					 struct dect_msg_buf *mb)
+static enum dect_sfmt_error
+__dect_build_sfmt_msg(const struct dect_handle *dh,
+		      const struct dect_sfmt_msg_desc *mdesc,
+		      const struct dect_msg_common *_src,
+		      struct dect_msg_buf *mb, struct dect_sfmt_iov *iov)
 {
 	const struct dect_sfmt_ie_desc *desc = mdesc->ie;
 	struct dect_ie_common * const *src = &_src->ie[0], **next, *rsrc;
@@ -2884,7 +3308,7 @@ enum dect_sfmt_error dect_build_sfmt_msg(const struct dect_handle *dh,
 
 			/* Add repeat indicator if more than one element on the list */
 			if (iel->list->next != NULL) {
-				err = __dect_build_sfmt_ie(dh, desc, mb, &iel->common);
+				err = __dect_build_sfmt_ie(dh, desc, mb, &iel->common, iov);
 				if (err != DECT_SFMT_OK)
 					return err;
 			}
@@ -2892,12 +3316,12 @@ enum dect_sfmt_error dect_build_sfmt_msg(const struct dect_handle *dh,
 
 			dect_assert(desc->flags & DECT_SFMT_IE_REPEAT);
 			dect_foreach_ie(rsrc, iel) {
-				err = __dect_build_sfmt_ie(dh, desc, mb, rsrc);
+				err = __dect_build_sfmt_ie(dh, desc, mb, rsrc, iov);
 				if (err != DECT_SFMT_OK)
 					return err;
 			}
 		} else if (*src != NULL) {
-			err = __dect_build_sfmt_ie(dh, desc, mb, *src);
+			err = __dect_build_sfmt_ie(dh, desc, mb, *src, iov);
 			if (err != DECT_SFMT_OK)
 				return err;
 		} else {
@@ -2917,6 +3341,265 @@ err_mandatory:
 	return DECT_SFMT_MANDATORY_IE_MISSING;
 }
 
+enum dect_sfmt_error dect_build_sfmt_msg(const struct dect_handle *dh,
+					 const struct dect_sfmt_msg_desc *mdesc,
+					 const struct dect_msg_common *src,
+					 struct dect_msg_buf *mb)
+{
+	enum dect_sfmt_error err;
+
+	err = __dect_build_sfmt_msg(dh, mdesc, src, mb, NULL);
+	dect_trace(dh, DECT_TRACE_SFMT_BUILD, NULL, NULL, mb->len, err, 0, 0);
+	return err;
+}
+
+/**
+ * dect_sfmt_iov_init - initialize a scatter/gather S-Format message
+ *
+ * @iov:	scatter/gather message
+ * @mb:		message buffer holding the data not referenced directly
+ *
+ * Data already present in the message buffer, like the S-Format header,
+ * forms the start of the message.
+ */
+void dect_sfmt_iov_init(struct dect_sfmt_iov *iov, struct dect_msg_buf *mb)
+{
+	iov->mb  = mb;
+	iov->off = 0;
+	iov->cnt = 0;
+	iov->len = 0;
+}
+
+/**
+ * dect_build_sfmt_msg_iov - construct a S-Format message as scatter/gather list
+ *
+ * @dh:		libdect DECT handle
+ * @mdesc:	message description
+ * @src:	message
+ * @iov:	scatter/gather message
+ *
+ * Construct a message like dect_build_sfmt_msg(), but reference the payload
+ * of large IEs, like display text or IWU data, directly instead of copying it
+ * into the message buffer. The IEs of the message must remain valid until
+ * the message has been transmitted.
+ */
+enum dect_sfmt_error dect_build_sfmt_msg_iov(const struct dect_handle *dh,
+					     const struct dect_sfmt_msg_desc *mdesc,
+					     const struct dect_msg_common *src,
+					     struct dect_sfmt_iov *iov)
+{
+	enum dect_sfmt_error err;
+
+	err = __dect_build_sfmt_msg(dh, mdesc, src, iov->mb, iov);
+	if (err == DECT_SFMT_OK)
+		dect_sfmt_iov_flush(iov);
+	dect_trace(dh, DECT_TRACE_SFMT_BUILD, NULL, NULL, iov->len, err, 0, 0);
+	return err;
+}
+
+/*
+ * Message templates
+ */
+
+void dect_sfmt_msg_tmpl_flush(const struct dect_handle *dh,
+			      struct dect_sfmt_msg_tmpl *tmpl)
+{
+	unsigned int i;
+
+	for (i = 0; i < tmpl->num; i++)
+		__dect_ie_put(dh, tmpl->ie[i].ie);
+	tmpl->mdesc = NULL;
+	tmpl->num   = 0;
+}
+
+static struct dect_ie_common *
+dect_sfmt_msg_tmpl_ie(const struct dect_sfmt_msg_desc *mdesc,
+		      const struct dect_msg_common *src, unsigned int idx)
+{
+	return *(struct dect_ie_common **)((void *)src->ie +
+					   mdesc->tbl->offset[idx]);
+}
+
+/*
+ * Determine the IE descriptions present in a message. Messages containing
+ * IE lists or more IEs than a template can hold are not templated.
+ */
+static int dect_sfmt_msg_tmpl_present(const struct dect_sfmt_msg_desc *mdesc,
+				      const struct dect_msg_common *src,
+				      uint64_t *present)
+{
+	const struct dect_sfmt_msg_tbl *tbl = mdesc->tbl;
+	const struct dect_sfmt_ie_desc *desc;
+	const struct dect_ie_list *iel;
+	unsigned int idx, num = 0;
+
+	*present = 0;
+	for (desc = mdesc->ie, idx = 0; !(desc->flags & DECT_SFMT_IE_END);
+	     desc++, idx++) {
+		if (desc->flags & DECT_SFMT_IE_REPEAT)
+			continue;
+
+		if (tbl->lists & (1ULL << idx)) {
+			iel = (void *)src->ie + tbl->offset[idx];
+			if (iel->list != NULL)
+				return -1;
+		} else if (dect_sfmt_msg_tmpl_ie(mdesc, src, idx) != NULL) {
+			if (++num > DECT_SFMT_MSG_TMPL_MAX_IES)
+				return -1;
+			*present |= 1ULL << idx;
+		}
+	}
+	return 0;
+}
+
+static enum dect_sfmt_error
+dect_sfmt_msg_tmpl_build(const struct dect_handle *dh,
+			 struct dect_sfmt_msg_tmpl *tmpl,
+			 const struct dect_sfmt_msg_desc *mdesc,
+			 const struct dect_msg_common *src,
+			 uint64_t present, struct dect_msg_buf *mb)
+{
+	const struct dect_sfmt_ie_desc *desc;
+	struct dect_ie_common *ie, *clone;
+	unsigned int idx, start = mb->len, offset;
+	enum dect_sfmt_error err;
+
+	dect_sfmt_msg_tmpl_flush(dh, tmpl);
+	sfmt_debug_msg(mdesc, "build");
+
+	for (desc = mdesc->ie, idx = 0; !(desc->flags & DECT_SFMT_IE_END);
+	     desc++, idx++) {
+		if (!(present & (1ULL << idx))) {
+			if ((desc->flags & DECT_SFMT_IE_REPEAT) ||
+			    dect_tx_status(dh, desc) != DECT_SFMT_IE_MANDATORY)
+				continue;
+			sfmt_debug("  IE <%s> id: %x missing\n",
+				   dect_ie_handlers[desc->type].name, desc->type);
+			err = DECT_SFMT_MANDATORY_IE_MISSING;
+			goto err1;
+		}
+
+		if (dect_ie_handlers[desc->type].size == 0)
+			goto err2;
+
+		ie = dect_sfmt_msg_tmpl_ie(mdesc, src, idx);
+		offset = mb->len;
+		err = __dect_build_sfmt_ie(dh, desc, mb, ie, NULL);
+		if (err != DECT_SFMT_OK)
+			goto err1;
+
+		clone = __dect_ie_clone(dh, ie, dect_ie_handlers[desc->type].size);
+		if (clone == NULL)
+			goto err2;
+
+		tmpl->ie[tmpl->num].index  = idx;
+		tmpl->ie[tmpl->num].offset = offset - start;
+		tmpl->ie[tmpl->num].len    = mb->len - offset;
+		tmpl->ie[tmpl->num].ie     = clone;
+		tmpl->num++;
+	}
+
+	if (mb->len - start > sizeof(tmpl->data))
+		goto err2;
+
+	tmpl->mdesc   = mdesc;
+	tmpl->present = present;
+	tmpl->len     = mb->len - start;
+	memcpy(tmpl->data, mb->data + start, tmpl->len);
+	return DECT_SFMT_OK;
+
+err2:
+	/* The message itself is fine, it just can't be cached */
+	dect_sfmt_msg_tmpl_flush(dh, tmpl);
+	mb->len = start;
+	return __dect_build_sfmt_msg(dh, mdesc, src, mb, NULL);
+err1:
+	dect_sfmt_msg_tmpl_flush(dh, tmpl);
+	return err;
+}
+
+static enum dect_sfmt_error
+__dect_build_sfmt_msg_tmpl(const struct dect_handle *dh,
+			   struct dect_sfmt_msg_tmpl *tmpl,
+			   const struct dect_sfmt_msg_desc *mdesc,
+			   const struct dect_msg_common *src,
+			   struct dect_msg_buf *mb)
+{
+	DECT_DEFINE_MSG_BUF_ONSTACK(scratch);
+	const struct dect_sfmt_ie_desc *desc;
+	struct dect_ie_common *ie, *cached;
+	uint64_t present;
+	unsigned int i;
+	size_t size;
+
+	if (dect_sfmt_msg_tmpl_present(mdesc, src, &present) < 0) {
+		dect_sfmt_msg_tmpl_flush(dh, tmpl);
+		return __dect_build_sfmt_msg(dh, mdesc, src, mb, NULL);
+	}
+
+	if (tmpl->mdesc != mdesc || tmpl->present != present)
+		goto rebuild;
+
+	sfmt_debug_msg(mdesc, "build from template");
+	for (i = 0; i < tmpl->num; i++) {
+		desc   = &mdesc->ie[tmpl->ie[i].index];
+		ie     = dect_sfmt_msg_tmpl_ie(mdesc, src, tmpl->ie[i].index);
+		cached = tmpl->ie[i].ie;
+		size   = dect_ie_handlers[desc->type].size - sizeof(*ie);
+
+		if (!memcmp(ie + 1, cached + 1, size))
+			continue;
+
+		scratch.len = 0;
+		if (dect_build_sfmt_ie(dh, desc->type, &scratch, ie) < 0 ||
+		    scratch.len != tmpl->ie[i].len)
+			goto rebuild;
+
+		memcpy(tmpl->data + tmpl->ie[i].offset, scratch.data, scratch.len);
+		memcpy(cached + 1, ie + 1, size);
+	}
+
+	dect_mbuf_release_ext(dh, &scratch);
+	if (dect_mbuf_expand(dh, mb, tmpl->len) < 0)
+		return DECT_SFMT_NO_BUFFER_SPACE;
+	memcpy(dect_mbuf_put(mb, tmpl->len), tmpl->data, tmpl->len);
+	return DECT_SFMT_OK;
+
+rebuild:
+	dect_mbuf_release_ext(dh, &scratch);
+	return dect_sfmt_msg_tmpl_build(dh, tmpl, mdesc, src, present, mb);
+}
+
+/**
+ * dect_build_sfmt_msg_tmpl - construct a S-Format message using a template
+ *
+ * @dh:		libdect DECT handle
+ * @tmpl:	message template
+ * @mdesc:	message description
+ * @src:	message
+ * @mb:		message buffer to append the message to
+ *
+ * Construct a message by copying the template and re-encoding the IEs that
+ * differ from the ones the template was built from. If the template doesn't
+ * match the message's set of IEs or an IE's encoded length changed, the
+ * message is constructed from scratch and the template is rebuilt.
+ *
+ * IEs are compared by content, uninitialized padding in the IEs passed in
+ * only causes unnecessary re-encoding.
+ */
+enum dect_sfmt_error dect_build_sfmt_msg_tmpl(const struct dect_handle *dh,
+					      struct dect_sfmt_msg_tmpl *tmpl,
+					      const struct dect_sfmt_msg_desc *mdesc,
+					      const struct dect_msg_common *src,
+					      struct dect_msg_buf *mb)
+{
+	enum dect_sfmt_error err;
+
+	err = __dect_build_sfmt_msg_tmpl(dh, tmpl, mdesc, src, mb);
+	dect_trace(dh, DECT_TRACE_SFMT_BUILD, NULL, NULL, mb->len, err, 0, 0);
+	return err;
+}
+
 void dect_msg_free(const struct dect_handle *dh,
 		   const struct dect_sfmt_msg_desc *mdesc,
 		   struct dect_msg_common *msg)
@@ -2926,16 +3609,18 @@ void dect_msg_free(const struct dect_handle *dh,
 
 	while (!(desc->flags & DECT_SFMT_IE_END)) {
 		next = dect_next_ie(desc, ie);
-		if (desc->type == DECT_IE_REPEAT_INDICATOR)
+		if (desc->type == DECT_IE_REPEAT_INDICATOR) {
+			dect_ie_list_put(dh, (struct dect_ie_list *)ie);
 			desc++;
-		else if (desc->flags & DECT_SFMT_IE_REPEAT)
-			dect_ie_list_put(dh, (void *)*ie);
-		else if (*ie != NULL)
+		} else if (*ie != NULL)
 			__dect_ie_put(dh, *ie);
 
 		ie = next;
 		desc++;
 	}
+
+	if (msg->arena != NULL)
+		dect_ie_arena_put(dh, msg->arena);
 }
 
 /** @} */
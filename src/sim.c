@@ -0,0 +1,565 @@
+/*
+ * libdect simulated DECT transport
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup sim Simulated transport
+ * @{
+ *
+ * In-process simulation of a DECT cluster.
+ *
+ * The simulated transport connects one FP handle and any number of PP
+ * handles within a process without the DECT kernel stack, allowing the
+ * NWK layer protocols to run on any Linux system:
+ *
+ * - The cluster query returns the mode and PARI of the simulated cluster.
+ * - S-SAP data links are AF_UNIX SEQPACKET connections from the PPs to
+ *   the FP's listener socket.
+ * - B-SAP broadcasts of the FP are delivered to the AF_UNIX DGRAM B-SAP
+ *   sockets of all PPs.
+ * - LU1 sockets connecting to the same ULEI are joined by an AF_UNIX
+ *   STREAM socket pair.
+ *
+ * Handles are opened using dect_sim_open_fp() and dect_sim_open_pp() and
+ * closed using dect_close_handle(). Encryption and MAC connection parameters
+ * are accepted, but have no effect.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <linux/dect.h>
+
+#include <libdect.h>
+#include <dect/sim.h>
+#include <identities.h>
+#include <transport.h>
+#include <utils.h>
+#include <io.h>
+
+/**
+ * struct dect_sim - simulated DECT cluster
+ *
+ * @id:		cluster ID, used to build the socket address namespace
+ * @pari:	FP's PARI
+ * @fpc:	FP capabilities
+ * @fp:		FP node
+ * @pps:	list of PP nodes
+ * @lu_pending:	LU1 sockets waiting for their peer
+ * @seq:	sequence number for node IDs and socket addresses
+ */
+struct dect_sim {
+	unsigned int			id;
+	struct dect_ari			pari;
+	struct dect_fp_capabilities	fpc;
+	struct dect_sim_node		*fp;
+	struct list_head		pps;
+	struct list_head		lu_pending;
+	unsigned int			seq;
+};
+
+/**
+ * struct dect_sim_node - handle attached to a simulated cluster
+ *
+ * @list:	PP list node
+ * @sim:	simulated cluster
+ * @id:		node ID
+ * @bsap:	address of the node's B-SAP socket
+ * @bsap_len:	length of the B-SAP address, zero if unbound
+ */
+struct dect_sim_node {
+	struct list_head		list;
+	struct dect_sim			*sim;
+	unsigned int			id;
+	struct sockaddr_un		bsap;
+	socklen_t			bsap_len;
+};
+
+/**
+ * struct dect_sim_lu - LU1 socket waiting for its peer
+ *
+ * @list:	pending list node
+ * @addr:	ULEI
+ * @fd:		peer end of the socket pair
+ */
+struct dect_sim_lu {
+	struct list_head		list;
+	struct sockaddr_dect_lu		addr;
+	int				fd;
+};
+
+static unsigned int dect_sim_id;
+
+static int dect_sim_prefix(char *buf, size_t size, const struct dect_sim *sim)
+{
+	return snprintf(buf, size, "libdect-sim-%u-%u-", getpid(), sim->id);
+}
+
+/* Build an abstract AF_UNIX address within the cluster's namespace */
+static socklen_t __fmtstring(3, 4)
+dect_sim_addr(struct sockaddr_un *sun, const struct dect_sim *sim,
+	      const char *fmt, ...)
+{
+	size_t size = sizeof(sun->sun_path) - 1;
+	char *path = sun->sun_path + 1;
+	va_list ap;
+	int len;
+
+	memset(sun, 0, sizeof(*sun));
+	sun->sun_family = AF_UNIX;
+
+	len = dect_sim_prefix(path, size, sim);
+	va_start(ap, fmt);
+	len += vsnprintf(path + len, size - len, fmt, ap);
+	va_end(ap);
+
+	return offsetof(struct sockaddr_un, sun_path) + 1 + len;
+}
+
+static int dect_sim_sock_type(const struct dect_fd *dfd)
+{
+	socklen_t len;
+	int type;
+
+	len = sizeof(type);
+	if (getsockopt(dfd->fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0)
+		return -1;
+	return type;
+}
+
+static int dect_sim_socket(const struct dect_handle *dh, int type, int protocol)
+{
+	switch (protocol) {
+	case DECT_S_SAP:
+	case DECT_B_SAP:
+	case DECT_LU1_SAP:
+		return socket(AF_UNIX, type | SOCK_CLOEXEC, 0);
+	default:
+		errno = EPROTONOSUPPORT;
+		return -1;
+	}
+}
+
+static int dect_sim_bind(const struct dect_handle *dh, struct dect_fd *dfd,
+			 const struct sockaddr *addr, socklen_t len)
+{
+	struct dect_sim_node *node = dh->transport_priv;
+	struct dect_sim *sim = node->sim;
+	struct sockaddr_un sun;
+	socklen_t sun_len;
+
+	switch (dect_sim_sock_type(dfd)) {
+	case SOCK_SEQPACKET:
+		sun_len = dect_sim_addr(&sun, sim, "s-sap");
+		return bind(dfd->fd, (struct sockaddr *)&sun, sun_len);
+	case SOCK_DGRAM:
+		/* The FP only transmits broadcasts */
+		if (node == sim->fp)
+			return 0;
+		sun_len = dect_sim_addr(&sun, sim, "b-sap-%u", node->id);
+		if (bind(dfd->fd, (struct sockaddr *)&sun, sun_len) < 0)
+			return -1;
+		node->bsap     = sun;
+		node->bsap_len = sun_len;
+		return 0;
+	default:
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+}
+
+static int dect_sim_connect_ssap(const struct dect_handle *dh,
+				 struct dect_fd *dfd,
+				 const struct sockaddr_dect_ssap *ssap)
+{
+	struct dect_sim_node *node = dh->transport_priv;
+	struct dect_sim *sim = node->sim;
+	struct sockaddr_un sun;
+	socklen_t sun_len;
+
+	/* Only the FP accepts data links */
+	if (node == sim->fp) {
+		errno = ECONNREFUSED;
+		return -1;
+	}
+
+	/* The local address carries the DLEI for the FP's accept() */
+	sun_len = dect_sim_addr(&sun, sim, "dlei-%u-%u-%u",
+				(unsigned int)ssap->dect_pmid,
+				(unsigned int)ssap->dect_lln, sim->seq++);
+	if (bind(dfd->fd, (struct sockaddr *)&sun, sun_len) < 0)
+		return -1;
+
+	sun_len = dect_sim_addr(&sun, sim, "s-sap");
+	return connect(dfd->fd, (struct sockaddr *)&sun, sun_len);
+}
+
+static bool dect_sim_ulei_cmp(const struct sockaddr_dect_lu *a1,
+			      const struct sockaddr_dect_lu *a2)
+{
+	return a1->dect_ari  == a2->dect_ari &&
+	       a1->dect_pmid == a2->dect_pmid &&
+	       a1->dect_lcn  == a2->dect_lcn;
+}
+
+/*
+ * The first LU1 socket connecting to a ULEI is replaced by one end of a
+ * socket pair, the second one by the other end.
+ */
+static int dect_sim_connect_lu(const struct dect_handle *dh,
+			       struct dect_fd *dfd,
+			       const struct sockaddr_dect_lu *addr)
+{
+	struct dect_sim_node *node = dh->transport_priv;
+	struct dect_sim *sim = node->sim;
+	struct dect_sim_lu *lu;
+	int sv[2];
+
+	list_for_each_entry(lu, &sim->lu_pending, list) {
+		if (!dect_sim_ulei_cmp(&lu->addr, addr))
+			continue;
+
+		if (dup3(lu->fd, dfd->fd, O_CLOEXEC) < 0)
+			return -1;
+		close(lu->fd);
+		list_del(&lu->list);
+		free(lu);
+		return 0;
+	}
+
+	lu = malloc(sizeof(*lu));
+	if (lu == NULL)
+		goto err1;
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+		       0, sv) < 0)
+		goto err2;
+	if (dup3(sv[0], dfd->fd, O_CLOEXEC) < 0)
+		goto err3;
+	close(sv[0]);
+
+	lu->addr = *addr;
+	lu->fd   = sv[1];
+	list_add_tail(&lu->list, &sim->lu_pending);
+	return 0;
+
+err3:
+	close(sv[1]);
+	close(sv[0]);
+err2:
+	free(lu);
+err1:
+	return -1;
+}
+
+static int dect_sim_connect(const struct dect_handle *dh, struct dect_fd *dfd,
+			    const struct sockaddr *addr, socklen_t len)
+{
+	switch (dect_sim_sock_type(dfd)) {
+	case SOCK_SEQPACKET:
+		if (len < sizeof(struct sockaddr_dect_ssap))
+			break;
+		return dect_sim_connect_ssap(dh, dfd, (void *)addr);
+	case SOCK_STREAM:
+		if (len < sizeof(struct sockaddr_dect_lu))
+			break;
+		return dect_sim_connect_lu(dh, dfd, (void *)addr);
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+static int dect_sim_listen(const struct dect_handle *dh, struct dect_fd *dfd,
+			   int backlog)
+{
+	return listen(dfd->fd, backlog);
+}
+
+static int dect_sim_accept(const struct dect_handle *dh,
+			   const struct dect_fd *dfd,
+			   struct sockaddr *addr, socklen_t *len)
+{
+	struct dect_sim_node *node = dh->transport_priv;
+	struct dect_sim *sim = node->sim;
+	struct sockaddr_dect_ssap *ssap = (void *)addr;
+	unsigned int pmid, lln, seq;
+	struct sockaddr_un sun;
+	socklen_t sun_len;
+	char path[sizeof(sun.sun_path)];
+	int fd, plen;
+
+	if (*len < sizeof(*ssap)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	sun_len = sizeof(sun);
+	fd = accept4(dfd->fd, (struct sockaddr *)&sun, &sun_len, SOCK_CLOEXEC);
+	if (fd < 0)
+		return -1;
+
+	/* Unnamed peers can't be mapped to a DLEI */
+	if (sun_len <= offsetof(struct sockaddr_un, sun_path) + 1)
+		goto err1;
+
+	sun_len -= offsetof(struct sockaddr_un, sun_path) + 1;
+	memcpy(path, sun.sun_path + 1, sun_len);
+	path[sun_len] = '\0';
+
+	plen = dect_sim_prefix(path, 0, sim);
+	if (sscanf(path + plen, "dlei-%u-%u-%u", &pmid, &lln, &seq) != 3)
+		goto err1;
+
+	memset(ssap, 0, sizeof(*ssap));
+	ssap->dect_family = AF_DECT;
+	ssap->dect_index  = dh->index;
+	ssap->dect_ari    = dect_build_ari(&sim->pari) >> 24;
+	ssap->dect_pmid   = pmid;
+	ssap->dect_lln    = lln;
+	*len = sizeof(*ssap);
+	return fd;
+
+err1:
+	close(fd);
+	errno = EPROTO;
+	return -1;
+}
+
+static int dect_sim_getsockopt(const struct dect_handle *dh,
+			       const struct dect_fd *dfd, int level,
+			       int optname, void *optval, socklen_t *optlen)
+{
+	static const struct dect_mac_conn_params mcp = {
+		.service	= DECT_SERVICE_IN_MIN_DELAY,
+		.slot		= DECT_FULL_SLOT,
+	};
+
+	if (level != SOL_DECT)
+		return getsockopt(dfd->fd, level, optname, optval, optlen);
+
+	switch (optname) {
+	case DECT_DL_MAC_CONN_PARAMS:
+		*optlen = min(*optlen, (socklen_t)sizeof(mcp));
+		memcpy(optval, &mcp, *optlen);
+		return 0;
+	case DECT_LU1_QUEUE_STATS:
+		memset(optval, 0, *optlen);
+		return 0;
+	default:
+		errno = ENOPROTOOPT;
+		return -1;
+	}
+}
+
+static int dect_sim_setsockopt(const struct dect_handle *dh,
+			       const struct dect_fd *dfd, int level,
+			       int optname, const void *optval,
+			       socklen_t optlen)
+{
+	if (level != SOL_DECT)
+		return setsockopt(dfd->fd, level, optname, optval, optlen);
+	return 0;
+}
+
+/*
+ * Broadcasts of the FP are transmitted to each PP's B-SAP socket. Messages
+ * that can't be queued are lost, like on the air interface.
+ */
+static int dect_sim_sendmmsg(const struct dect_handle *dh,
+			     const struct dect_fd *dfd,
+			     struct mmsghdr *msg, unsigned int vlen)
+{
+	struct dect_sim_node *node = dh->transport_priv, *pp;
+	struct dect_sim *sim = node->sim;
+	struct msghdr hdr;
+	unsigned int i;
+
+	if (node != sim->fp || dfd != dh->b_sap)
+		return dect_kernel_sendmmsg(dh, dfd, msg, vlen);
+
+	list_for_each_entry(pp, &sim->pps, list) {
+		if (pp->bsap_len == 0)
+			continue;
+
+		for (i = 0; i < vlen; i++) {
+			hdr = msg[i].msg_hdr;
+			hdr.msg_name	   = &pp->bsap;
+			hdr.msg_namelen	   = pp->bsap_len;
+			hdr.msg_control	   = NULL;
+			hdr.msg_controllen = 0;
+			sendmsg(dfd->fd, &hdr, MSG_NOSIGNAL | MSG_DONTWAIT);
+		}
+	}
+	return vlen;
+}
+
+static int dect_sim_init(struct dect_handle *dh, enum dect_cluster_modes mode)
+{
+	struct dect_sim *sim = dh->transport_priv;
+	struct dect_sim_node *node;
+
+	if (mode == DECT_MODE_FP && sim->fp != NULL) {
+		errno = EBUSY;
+		return -1;
+	}
+
+	node = dect_zalloc(dh, sizeof(*node));
+	if (node == NULL)
+		return -1;
+	node->sim = sim;
+	node->id  = sim->seq++;
+
+	if (mode == DECT_MODE_FP) {
+		init_list_head(&node->list);
+		sim->fp = node;
+	} else
+		list_add_tail(&node->list, &sim->pps);
+	dh->transport_priv = node;
+
+	/* Emulate the cluster query */
+	dh->index = 0;
+	dh->mode  = mode;
+	dh->pari  = sim->pari;
+	dh->fpc   = sim->fpc;
+	return 0;
+}
+
+static int dect_sim_fp_init(struct dect_handle *dh, const char *cluster)
+{
+	return dect_sim_init(dh, DECT_MODE_FP);
+}
+
+static int dect_sim_pp_init(struct dect_handle *dh, const char *cluster)
+{
+	return dect_sim_init(dh, DECT_MODE_PP);
+}
+
+static void dect_sim_exit(struct dect_handle *dh)
+{
+	struct dect_sim_node *node = dh->transport_priv;
+	struct dect_sim *sim = node->sim;
+
+	if (node == sim->fp)
+		sim->fp = NULL;
+	else
+		list_del(&node->list);
+
+	dh->transport_priv = sim;
+	dect_free(dh, node);
+}
+
+const struct dect_transport_ops dect_sim_fp_transport = {
+	.init		= dect_sim_fp_init,
+	.exit		= dect_sim_exit,
+	.socket		= dect_sim_socket,
+	.bind		= dect_sim_bind,
+	.connect	= dect_sim_connect,
+	.listen		= dect_sim_listen,
+	.accept		= dect_sim_accept,
+	.getsockopt	= dect_sim_getsockopt,
+	.setsockopt	= dect_sim_setsockopt,
+	.sendmmsg	= dect_sim_sendmmsg,
+};
+
+const struct dect_transport_ops dect_sim_pp_transport = {
+	.init		= dect_sim_pp_init,
+	.exit		= dect_sim_exit,
+	.socket		= dect_sim_socket,
+	.bind		= dect_sim_bind,
+	.connect	= dect_sim_connect,
+	.listen		= dect_sim_listen,
+	.accept		= dect_sim_accept,
+	.getsockopt	= dect_sim_getsockopt,
+	.setsockopt	= dect_sim_setsockopt,
+	.sendmmsg	= dect_sim_sendmmsg,
+};
+
+/**
+ * Allocate a simulated DECT cluster
+ *
+ * @param pari		FP's PARI
+ * @param fpc		FP capabilities, may be NULL
+ *
+ * @return		a new simulated cluster or NULL on error.
+ */
+struct dect_sim *dect_sim_alloc(const struct dect_ari *pari,
+				const struct dect_fp_capabilities *fpc)
+{
+	struct dect_sim *sim;
+
+	sim = calloc(1, sizeof(*sim));
+	if (sim == NULL)
+		return NULL;
+	sim->id   = dect_sim_id++;
+	sim->pari = *pari;
+	if (fpc != NULL)
+		sim->fpc = *fpc;
+	init_list_head(&sim->pps);
+	init_list_head(&sim->lu_pending);
+	return sim;
+}
+EXPORT_SYMBOL(dect_sim_alloc);
+
+/**
+ * Release a simulated DECT cluster
+ *
+ * @param sim		simulated cluster
+ *
+ * All handles attached to the cluster must have been closed.
+ */
+void dect_sim_free(struct dect_sim *sim)
+{
+	struct dect_sim_lu *lu, *next;
+
+	dect_assert(sim->fp == NULL && list_empty(&sim->pps));
+
+	list_for_each_entry_safe(lu, next, &sim->lu_pending, list) {
+		close(lu->fd);
+		free(lu);
+	}
+	free(sim);
+}
+EXPORT_SYMBOL(dect_sim_free);
+
+/**
+ * Open a FP handle attached to a simulated DECT cluster
+ *
+ * @param sim		simulated cluster
+ * @param ops		DECT ops
+ *
+ * @return		a new libdect DECT handle or NULL on error.
+ */
+struct dect_handle *dect_sim_open_fp(struct dect_sim *sim, struct dect_ops *ops)
+{
+	return __dect_open_handle(ops, &dect_sim_fp_transport, sim, NULL);
+}
+EXPORT_SYMBOL(dect_sim_open_fp);
+
+/**
+ * Open a PP handle attached to a simulated DECT cluster
+ *
+ * @param sim		simulated cluster
+ * @param ops		DECT ops
+ *
+ * @return		a new libdect DECT handle or NULL on error.
+ */
+struct dect_handle *dect_sim_open_pp(struct dect_sim *sim, struct dect_ops *ops)
+{
+	return __dect_open_handle(ops, &dect_sim_pp_transport, sim, NULL);
+}
+EXPORT_SYMBOL(dect_sim_open_pp);
+
+/** @} */
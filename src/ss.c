@@ -28,7 +28,7 @@
 #include <lce.h>
 #include <ss.h>
 
-static DECT_SFMT_MSG_DESC(ciss_register,
+DECT_SFMT_MSG_DESC(ciss_register,
 	DECT_SFMT_IE(DECT_IE_PORTABLE_IDENTITY,		IE_OPTIONAL,  IE_MANDATORY, 0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
@@ -40,7 +40,7 @@ static DECT_SFMT_MSG_DESC(ciss_register,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(ciss_release_com,
+DECT_SFMT_MSG_DESC(ciss_release_com,
 	DECT_SFMT_IE(DECT_IE_RELEASE_REASON,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
@@ -52,7 +52,7 @@ static DECT_SFMT_MSG_DESC(ciss_release_com,
 	DECT_SFMT_IE_END_MSG
 );
 
-static DECT_SFMT_MSG_DESC(ciss_facility,
+DECT_SFMT_MSG_DESC(ciss_facility,
 	DECT_SFMT_IE(DECT_IE_REPEAT_INDICATOR,		IE_OPTIONAL,  IE_OPTIONAL,  0),
 	DECT_SFMT_IE(DECT_IE_FACILITY,			IE_OPTIONAL,  IE_OPTIONAL,  DECT_SFMT_IE_REPEAT),
 	DECT_SFMT_IE(DECT_IE_SINGLE_DISPLAY,		IE_OPTIONAL,  IE_NONE,      0),
@@ -81,15 +81,17 @@ static DECT_SFMT_MSG_DESC(ciss_facility,
 
 void dect_clss_rcv(struct dect_handle *dh, struct dect_msg_buf *mb)
 {
-	struct dect_ciss_facility_msg msg;
+	struct dect_msg_view view;
 
 	if (mb->type != DECT_CISS_FACILITY)
 		return;
 
-	if (dect_parse_sfmt_msg(dh, &ciss_facility_msg_desc, &msg.common, mb) < 0)
+	/* Connectionless {FACILITY} messages are validated, but there is no
+	 * user interface to deliver them to yet. */
+	if (dect_msg_view_init(dh, &view, &ciss_facility_msg_desc, mb) < 0) {
+		dect_debug(DECT_DEBUG_SS, "CLSS: dropping malformed {FACILITY}\n");
 		return;
-
-	dect_msg_free(dh, &ciss_facility_msg_desc, &msg.common);
+	}
 }
 
 /**
@@ -200,8 +202,9 @@ int dect_mnss_facility_req(struct dect_handle *dh, struct dect_ss_endpoint *sse,
 	ss_debug_entry(sse, "MNSS_FACILITY-req");
 
 	if (sse->transaction.link != NULL)
-		return dect_lce_send(dh, &sse->transaction, &ciss_facility_msg_desc,
-				     &msg.common, DECT_CISS_FACILITY);
+		return dect_lce_send_iov(dh, &sse->transaction,
+					 &ciss_facility_msg_desc,
+					 &msg.common, DECT_CISS_FACILITY);
 	else
 		return dect_lce_send_cl(dh, &sse->ipui, &ciss_facility_msg_desc,
 					&msg.common, DECT_PD_CISS,
@@ -27,6 +27,12 @@
  * associate data with the timer. The function dect_timer_priv() returns
  * a pointer to this data area.
  *
+ * When dect_ops::timer_wheel is set, libdect keeps timers with non-zero
+ * timeouts on an internal hashed timer wheel with second granularity and
+ * only registers a single one second tick timer with the application while
+ * timers are pending. Starting and stopping those timers does not involve
+ * the application.
+ *
  * @{
  */
 
@@ -35,6 +41,7 @@
 #include <libdect.h>
 #include <utils.h>
 #include <timer.h>
+#include <io.h>
 
 struct dect_timer *dect_timer_alloc(const struct dect_handle *dh)
 {
@@ -42,8 +49,10 @@ struct dect_timer *dect_timer_alloc(const struct dect_handle *dh)
 
 	timer = dect_zalloc(dh, sizeof(struct dect_timer) +
 			    dh->ops->event_ops->timer_priv_size);
-	if (timer != NULL)
+	if (timer != NULL) {
+		init_list_head(&timer->list);
 		timer->state = DECT_TIMER_STOPPED;
+	}
 
 	return timer;
 }
@@ -84,27 +93,162 @@ void dect_timer_setup(struct dect_timer *timer,
 }
 EXPORT_SYMBOL(dect_timer_setup);
 
-void dect_timer_start(const struct dect_handle *dh,
-		      struct dect_timer *timer, unsigned int timeout)
+static void __dect_timer_start(const struct dect_handle *dh,
+			       struct dect_timer *timer, unsigned int timeout)
 {
 	struct timeval tv = {
 		.tv_sec = timeout,
 	};
 
+	timer->state = DECT_TIMER_RUNNING;
+	dh->ops->event_ops->start_timer(dh, timer, &tv);
+}
+
+static void __dect_timer_stop(const struct dect_handle *dh,
+			      struct dect_timer *timer)
+{
+	dh->ops->event_ops->stop_timer(dh, timer);
+	timer->state = DECT_TIMER_STOPPED;
+}
+
+/*
+ * Timer wheel
+ */
+
+static void dect_timer_wheel_add(const struct dect_handle *dh,
+				 struct dect_timer *timer, unsigned int timeout)
+{
+	struct dect_timer_wheel *wheel = dh->wheel;
+
+	/* A timer started between two ticks is rounded up so it never
+	 * expires early. If the wheel is idle, the tick is (re)started
+	 * aligned to the new timer. */
+	if (dect_timer_running(wheel->tick))
+		timeout++;
+	else
+		__dect_timer_start(dh, wheel->tick, 1);
+
+	timer->expires = wheel->now + timeout;
+	list_add_tail(&timer->list,
+		      &wheel->slots[timer->expires % DECT_TIMER_WHEEL_SIZE]);
+	wheel->pending++;
+}
+
+static void dect_timer_wheel_del(const struct dect_handle *dh,
+				 struct dect_timer *timer)
+{
+	list_del_init(&timer->list);
+	dh->wheel->pending--;
+}
+
+static void dect_timer_wheel_tick(struct dect_handle *dh,
+				  struct dect_timer *tick)
+{
+	struct dect_timer_wheel *wheel = dh->wheel;
+	struct dect_timer *timer, *next;
+	struct list_head *slot;
+	LIST_HEAD(expired);
+
+	wheel->now++;
+	slot = &wheel->slots[wheel->now % DECT_TIMER_WHEEL_SIZE];
+	list_for_each_entry_safe(timer, next, slot, list) {
+		if (timer->expires == wheel->now)
+			list_move_tail(&timer->list, &expired);
+	}
+
+	/* Callbacks may stop other expired timers, which unlinks them
+	 * from the expired list. */
+	while (!list_empty(&expired)) {
+		timer = list_first_entry(&expired, struct dect_timer, list);
+		dect_timer_wheel_del(dh, timer);
+		timer->state = DECT_TIMER_STOPPED;
+		timer->callback(dh, timer);
+	}
+
+	if (wheel->pending > 0 && !dect_timer_running(wheel->tick))
+		__dect_timer_start(dh, wheel->tick, 1);
+}
+
+int dect_timer_wheel_init(struct dect_handle *dh)
+{
+	struct dect_timer_wheel *wheel;
+	unsigned int i;
+
+	if (!dh->ops->timer_wheel)
+		return 0;
+
+	wheel = dect_malloc(dh, sizeof(*wheel));
+	if (wheel == NULL)
+		goto err1;
+	wheel->tick = dect_timer_alloc(dh);
+	if (wheel->tick == NULL)
+		goto err2;
+	dect_timer_setup(wheel->tick, dect_timer_wheel_tick, NULL);
+
+	wheel->now     = 0;
+	wheel->pending = 0;
+	for (i = 0; i < array_size(wheel->slots); i++)
+		init_list_head(&wheel->slots[i]);
+
+	dh->wheel = wheel;
+	return 0;
+
+err2:
+	dect_free(dh, wheel);
+err1:
+	return -1;
+}
+
+void dect_timer_wheel_exit(struct dect_handle *dh)
+{
+	struct dect_timer_wheel *wheel = dh->wheel;
+	struct dect_timer *timer, *next;
+	unsigned int i;
+
+	if (wheel == NULL)
+		return;
+
+	/* Timers still armed when the handle is closed are cancelled, their
+	 * owners may free them afterwards. */
+	for (i = 0; i < array_size(wheel->slots); i++) {
+		list_for_each_entry_safe(timer, next, &wheel->slots[i], list) {
+			dect_timer_wheel_del(dh, timer);
+			timer->state = DECT_TIMER_STOPPED;
+		}
+	}
+
+	if (dect_timer_running(wheel->tick))
+		__dect_timer_stop(dh, wheel->tick);
+	dect_timer_free(dh, wheel->tick);
+	dect_free(dh, wheel);
+	dh->wheel = NULL;
+}
+
+void dect_timer_start(const struct dect_handle *dh,
+		      struct dect_timer *timer, unsigned int timeout)
+{
 	/* Cancel timer if it is already running */
 	if (timer->state == DECT_TIMER_RUNNING)
-		dh->ops->event_ops->stop_timer(dh, timer);
+		dect_timer_stop(dh, timer);
 
-	timer->state = DECT_TIMER_RUNNING;
-	dh->ops->event_ops->start_timer(dh, timer, &tv);
+	/* Zero timeouts are used to defer work to the event loop and are
+	 * passed to the application directly. */
+	if (dh->wheel != NULL && timeout > 0) {
+		timer->state = DECT_TIMER_RUNNING;
+		dect_timer_wheel_add(dh, timer, timeout);
+	} else
+		__dect_timer_start(dh, timer, timeout);
 }
 EXPORT_SYMBOL(dect_timer_start);
 
 void dect_timer_stop(const struct dect_handle *dh, struct dect_timer *timer)
 {
 	dect_assert(timer->state == DECT_TIMER_RUNNING);
-	dh->ops->event_ops->stop_timer(dh, timer);
-	timer->state = DECT_TIMER_STOPPED;
+	if (!list_empty(&timer->list)) {
+		dect_timer_wheel_del(dh, timer);
+		timer->state = DECT_TIMER_STOPPED;
+	} else
+		__dect_timer_stop(dh, timer);
 }
 EXPORT_SYMBOL(dect_timer_stop);
 
@@ -124,7 +268,9 @@ void dect_timer_run(struct dect_handle *dh, struct dect_timer *timer)
 {
 	dect_assert(timer->state == DECT_TIMER_RUNNING);
 	timer->state = DECT_TIMER_STOPPED;
+	dect_event_enter(dh);
 	timer->callback(dh, timer);
+	dect_event_exit(dh);
 }
 EXPORT_SYMBOL(dect_timer_run);
 
@@ -0,0 +1,352 @@
+/*
+ * libdect binary trace ring
+ *
+ * Copyright (c) 2009-2010 Patrick McHardy <kaber@trash.net>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/**
+ * @defgroup trace Tracing
+ * @{
+ *
+ * libdect can record events of the LCE, CC, MM and S-Format code paths in a
+ * per handle ring of fixed size binary records. Recording an event doesn't
+ * involve any formatting, making it cheap enough to leave tracing enabled
+ * permanently. The ring can be rendered to text using dect_trace_print(),
+ * either in process or after the fact from a copy written using
+ * dect_trace_write().
+ *
+ * Tracing is enabled by setting dect_ops::trace_records to the desired
+ * number of records, which is rounded up to a power of two and limited to
+ * #DECT_TRACE_MAX_RECORDS.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libdect.h>
+#include <utils.h>
+#include <io.h>
+#include <lce.h>
+#include <trace.h>
+
+static const struct dect_trace_event {
+	enum dect_debug_subsys	subsys;
+	const char		*name;
+	const char		*args[4];
+} dect_trace_events[DECT_TRACE_MAX + 1] = {
+	[DECT_TRACE_LCE_LINK_ALLOC]	= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "link-alloc",
+	},
+	[DECT_TRACE_LCE_LINK_STATE]	= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "link-state",
+		.args	= { "old", "new" },
+	},
+	[DECT_TRACE_LCE_LINK_DESTROY]	= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "link-destroy",
+	},
+	[DECT_TRACE_LCE_TX]		= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "tx",
+		.args	= { "len", "size" },
+	},
+	[DECT_TRACE_LCE_RX]		= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "rx",
+		.args	= { "len" },
+	},
+	[DECT_TRACE_LCE_TA_OPEN]	= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "ta-open",
+		.args	= { "role" },
+	},
+	[DECT_TRACE_LCE_TA_CONFIRM]	= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "ta-confirm",
+		.args	= { "role" },
+	},
+	[DECT_TRACE_LCE_TA_CLOSE]	= {
+		.subsys	= DECT_DEBUG_LCE,
+		.name	= "ta-close",
+		.args	= { "role", "mode" },
+	},
+	[DECT_TRACE_CC_TX]		= {
+		.subsys	= DECT_DEBUG_CC,
+		.name	= "tx",
+		.args	= { "msg", "state", "err" },
+	},
+	[DECT_TRACE_CC_RX]		= {
+		.subsys	= DECT_DEBUG_CC,
+		.name	= "rx",
+		.args	= { "msg", "state" },
+	},
+	[DECT_TRACE_MM_PROC_INITIATE]	= {
+		.subsys	= DECT_DEBUG_MM,
+		.name	= "proc-initiate",
+		.args	= { "proc", "priority" },
+	},
+	[DECT_TRACE_MM_PROC_RESPOND]	= {
+		.subsys	= DECT_DEBUG_MM,
+		.name	= "proc-respond",
+		.args	= { "proc", "priority" },
+	},
+	[DECT_TRACE_MM_PROC_COMPLETE]	= {
+		.subsys	= DECT_DEBUG_MM,
+		.name	= "proc-complete",
+		.args	= { "proc", "priority" },
+	},
+	[DECT_TRACE_MM_PROC_TIMEOUT]	= {
+		.subsys	= DECT_DEBUG_MM,
+		.name	= "proc-timeout",
+		.args	= { "proc", "retransmissions" },
+	},
+	[DECT_TRACE_SFMT_PARSE]		= {
+		.subsys	= DECT_DEBUG_SFMT,
+		.name	= "parse",
+		.args	= { "len", "err", "ie" },
+	},
+	[DECT_TRACE_SFMT_BUILD]		= {
+		.subsys	= DECT_DEBUG_SFMT,
+		.name	= "build",
+		.args	= { "len", "err" },
+	},
+};
+
+static const char * const dect_trace_subsys[] = {
+	[DECT_DEBUG_UNKNOWN]	= "-",
+	[DECT_DEBUG_LCE]	= "LCE",
+	[DECT_DEBUG_CC]		= "CC",
+	[DECT_DEBUG_SS]		= "SS",
+	[DECT_DEBUG_CLMS]	= "CLMS",
+	[DECT_DEBUG_MM]		= "MM",
+	[DECT_DEBUG_SFMT]	= "SFMT",
+	[DECT_DEBUG_NL]		= "NL",
+};
+
+int dect_trace_init(struct dect_handle *dh)
+{
+	struct dect_trace_ring *ring;
+	unsigned int size;
+
+	if (dh->ops->trace_records == 0)
+		return 0;
+	if (dh->ops->trace_records > DECT_TRACE_MAX_RECORDS) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	for (size = 1; size < dh->ops->trace_records; size <<= 1)
+		;
+
+	ring = dect_zalloc(dh, sizeof(*ring) + size * sizeof(ring->records[0]));
+	if (ring == NULL)
+		return -1;
+	ring->magic	  = DECT_TRACE_MAGIC;
+	ring->version	  = DECT_TRACE_VERSION;
+	ring->record_size = sizeof(ring->records[0]);
+	ring->size	  = size;
+
+	dh->trace = ring;
+	return 0;
+}
+
+void dect_trace_exit(struct dect_handle *dh)
+{
+	dect_free(dh, dh->trace);
+	dh->trace = NULL;
+}
+
+/*
+ * The sequence number of a record is cleared before and set after updating
+ * its contents, allowing readers to detect records that changed while they
+ * were copied.
+ */
+void __dect_trace(const struct dect_handle *dh, enum dect_trace_events event,
+		  const struct dect_data_link *ddl,
+		  const struct dect_transaction *ta,
+		  uint32_t arg0, uint32_t arg1, uint32_t arg2, uint32_t arg3,
+		  const void *data, unsigned int len)
+{
+	struct dect_trace_ring *ring = dh->trace;
+	struct dect_trace_record *rec;
+	struct timespec ts;
+	uint64_t seq;
+
+	if (ddl == NULL && ta != NULL)
+		ddl = ta->link;
+
+	seq = __atomic_fetch_add(&ring->head, 1, __ATOMIC_RELAXED);
+	rec = &ring->records[seq & (ring->size - 1)];
+	__atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	rec->time   = ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+	rec->event  = event;
+	rec->subsys = dect_trace_events[event].subsys;
+	rec->link   = ddl != NULL && ddl->dfd != NULL ? ddl->dfd->fd : -1;
+	rec->pd     = ta != NULL ? ta->pd : DECT_TRACE_NONE;
+	rec->tv     = ta != NULL ? ta->tv : DECT_TRACE_NONE;
+	rec->arg[0] = arg0;
+	rec->arg[1] = arg1;
+	rec->arg[2] = arg2;
+	rec->arg[3] = arg3;
+	rec->len    = min(len, (unsigned int)DECT_TRACE_DATA_SIZE);
+	if (rec->len > 0)
+		memcpy(rec->data, data, rec->len);
+
+	__atomic_store_n(&rec->seq, seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Get the trace ring of a libdect handle
+ *
+ * @param dh	libdect DECT handle
+ *
+ * @return the trace ring or NULL if tracing is disabled.
+ */
+const struct dect_trace_ring *dect_trace_ring(const struct dect_handle *dh)
+{
+	return dh->trace;
+}
+EXPORT_SYMBOL(dect_trace_ring);
+
+/**
+ * Write the trace ring of a libdect handle to a file descriptor
+ *
+ * @param dh	libdect DECT handle
+ * @param fd	file descriptor
+ *
+ * Write a binary copy of the trace ring, which can be rendered to text
+ * using dect_trace_print(). This function is async-signal-safe.
+ *
+ * @return the number of bytes written or -1 on error. errno is set to
+ * ENODATA if tracing is disabled.
+ */
+ssize_t dect_trace_write(const struct dect_handle *dh, int fd)
+{
+	const struct dect_trace_ring *ring = dh->trace;
+	const uint8_t *ptr = (const uint8_t *)ring;
+	size_t size, done = 0;
+	ssize_t len;
+
+	if (ring == NULL) {
+		errno = ENODATA;
+		return -1;
+	}
+
+	size = sizeof(*ring) + ring->size * sizeof(ring->records[0]);
+	while (done < size) {
+		len = write(fd, ptr + done, size - done);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		done += len;
+	}
+	return done;
+}
+EXPORT_SYMBOL(dect_trace_write);
+
+static void dect_trace_print_record(FILE *f, const struct dect_trace_record *rec)
+{
+	const struct dect_trace_event *ev = NULL;
+	const char *subsys = "?";
+	unsigned int i;
+
+	if (rec->event <= DECT_TRACE_MAX)
+		ev = &dect_trace_events[rec->event];
+	if (rec->subsys < array_size(dect_trace_subsys))
+		subsys = dect_trace_subsys[rec->subsys];
+
+	fprintf(f, "%6" PRIu64 ".%06" PRIu64 " %-4s ",
+		rec->time / 1000000000, rec->time % 1000000000 / 1000, subsys);
+	if (ev != NULL)
+		fprintf(f, "%-13s", ev->name);
+	else
+		fprintf(f, "event-%-7u", rec->event);
+
+	if (rec->link >= 0)
+		fprintf(f, " link %d", rec->link);
+	if (rec->pd != DECT_TRACE_NONE)
+		fprintf(f, " pd %u tv %u", rec->pd, rec->tv);
+
+	for (i = 0; i < array_size(rec->arg); i++) {
+		if (ev != NULL && ev->args[i] != NULL)
+			fprintf(f, " %s %d", ev->args[i], (int32_t)rec->arg[i]);
+		else if (ev == NULL)
+			fprintf(f, " %d", (int32_t)rec->arg[i]);
+	}
+
+	if (rec->len > 0) {
+		fprintf(f, " |");
+		for (i = 0; i < min(rec->len, (uint16_t)DECT_TRACE_DATA_SIZE); i++)
+			fprintf(f, " %.2x", rec->data[i]);
+	}
+	fprintf(f, "\n");
+}
+
+/**
+ * Render a trace ring to text
+ *
+ * @param f	output stream
+ * @param ring	trace ring
+ * @param size	size of the memory area containing the ring
+ *
+ * Render the valid records of a trace ring, oldest first. The ring may be
+ * the live ring of a libdect handle or a copy written by dect_trace_write().
+ *
+ * @return the number of records printed or -1 if the ring is invalid.
+ */
+int dect_trace_print(FILE *f, const struct dect_trace_ring *ring, size_t size)
+{
+	const struct dect_trace_record *src;
+	struct dect_trace_record rec;
+	uint64_t seq, first, head, s1, s2;
+	int cnt = 0;
+
+	if (size < sizeof(*ring) ||
+	    ring->magic != DECT_TRACE_MAGIC ||
+	    ring->version != DECT_TRACE_VERSION ||
+	    ring->record_size != sizeof(rec) ||
+	    ring->size == 0 || ring->size & (ring->size - 1) ||
+	    size < sizeof(*ring) + (size_t)ring->size * sizeof(rec)) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	head  = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	first = head > ring->size ? head - ring->size : 0;
+
+	for (seq = first; seq < head; seq++) {
+		src = &ring->records[seq & (ring->size - 1)];
+
+		s1 = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE);
+		memcpy(&rec, src, sizeof(rec));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		s2 = __atomic_load_n(&src->seq, __ATOMIC_RELAXED);
+
+		/* Skip records overwritten or written while copying */
+		if (s1 != seq + 1 || s2 != s1)
+			continue;
+
+		dect_trace_print_record(f, &rec);
+		cnt++;
+	}
+	return cnt;
+}
+EXPORT_SYMBOL(dect_trace_print);
+
+/** @} */